@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <benchmark/benchmark.h>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Recorder of the latency of each benchmark iteration, which reports percentiles as counters.
+     * @details
+     *  Each sample costs two clock reads, which is negligible compared with a round trip to Redis,
+     *  but it should be kept in mind when reading the percentiles of sub-microsecond operations.
+     *  In multi-threaded runs, the samples of all threads are merged before the percentiles are computed.
+     */
+    class LatencyRecorder
+    {
+    private:
+        /// Latency of each iteration.
+        std::vector<std::chrono::steady_clock::duration> Samples;
+        /// Start time of the current iteration.
+        std::chrono::steady_clock::time_point StartTime;
+
+        /// Samples collected from the threads of a multi-threaded run.
+        struct SharedSamples
+        {
+            /// Mutex for the samples and the count of contributed threads.
+            std::mutex Mutex;
+            /// Condition used to notify the first thread that another thread has contributed its samples.
+            std::condition_variable Condition;
+            /// Merged samples of the contributed threads.
+            std::vector<std::chrono::steady_clock::duration> Samples;
+            /// Count of threads which have contributed their samples.
+            int ContributedThreads = 0;
+        };
+
+        /// Get the shared samples, benchmarks run one after another so they can share one instance.
+        static SharedSamples& GetSharedSamples()
+        {
+            static SharedSamples shared_samples;
+            return shared_samples;
+        }
+
+        /// Get the given percentile of the sorted samples, in nanoseconds.
+        [[nodiscard]] double GetPercentile(double percentile) const
+        {
+            auto index = static_cast<std::size_t>(percentile * static_cast<double>(Samples.size() - 1));
+            return static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Samples[index]).count());
+        }
+
+    public:
+        /// Start timing an iteration.
+        void Start() noexcept
+        {
+            StartTime = std::chrono::steady_clock::now();
+        }
+
+        /// Finish timing an iteration.
+        void Stop()
+        {
+            Samples.push_back(std::chrono::steady_clock::now() - StartTime);
+        }
+
+        /**
+         * @brief Report the throughput and the p50 and p99 latency of the recorded iterations.
+         * @param state State of the benchmark.
+         * @param items_per_iteration Count of items processed in each iteration, such as values sent.
+         */
+        void Report(benchmark::State& state, std::int64_t items_per_iteration = 1)
+        {
+            state.SetItemsProcessed(state.iterations() * items_per_iteration);
+            // Percentiles of different threads can not be combined, so the first thread computes them over the
+            // samples of all threads, and it is the only one which reports them.
+            if (state.threads() > 1)
+            {
+                auto& shared_samples = GetSharedSamples();
+                std::unique_lock lock(shared_samples.Mutex);
+                shared_samples.Samples.insert(shared_samples.Samples.end(), Samples.begin(), Samples.end());
+                ++shared_samples.ContributedThreads;
+                if (state.thread_index() != 0)
+                {
+                    shared_samples.Condition.notify_all();
+                    return;
+                }
+                shared_samples.Condition.wait(lock, [&shared_samples, &state]{
+                    return shared_samples.ContributedThreads == state.threads();
+                });
+                Samples = std::move(shared_samples.Samples);
+                shared_samples.Samples.clear();
+                shared_samples.ContributedThreads = 0;
+            }
+            if (Samples.empty()) return;
+            std::sort(Samples.begin(), Samples.end());
+            state.counters["p50_ns"] = GetPercentile(0.50);
+            state.counters["p99_ns"] = GetPercentile(0.99);
+        }
+    };
+}
@@ -0,0 +1,260 @@
+#include <GaiaInspectionClient/GaiaInspectionClient.hpp>
+#include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <optional>
+#include <cstring>
+#include "RedisServer.hpp"
+#include "LatencyRecorder.hpp"
+
+using namespace Gaia::InspectionService;
+
+namespace
+{
+    /// Port of the Redis server to benchmark against.
+    unsigned int RedisPort = 16379;
+    /// Whether benchmarks run on the in-process backend instead of Redis.
+    bool UseMemoryBackend = false;
+    /// Backend shared by the memory benchmarks, so readers see the values written by clients.
+    std::shared_ptr<MemoryBackend> SharedMemoryBackend;
+
+    /// Create the backend for a client or a reader.
+    std::shared_ptr<StorageBackend> CreateBackend()
+    {
+        if (UseMemoryBackend) return SharedMemoryBackend;
+        return std::make_shared<RedisBackend>(
+                std::make_shared<sw::redis::Redis>("tcp://127.0.0.1:" + std::to_string(RedisPort)));
+    }
+
+    /// Send a text value directly.
+    void UpdateValueText(benchmark::State& state)
+    {
+        InspectionClient client("benchmark_update_value_text", CreateBackend());
+        LatencyRecorder recorder;
+        std::size_t counter = 0;
+        for (auto _ : state)
+        {
+            auto text = std::to_string(counter++);
+            recorder.Start();
+            client.UpdateValue("value", text);
+            recorder.Stop();
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(UpdateValueText)->UseRealTime();
+
+    /// Send an arithmetic value directly, which is formatted by the client.
+    void UpdateValueTyped(benchmark::State& state)
+    {
+        InspectionClient client("benchmark_update_value_typed", CreateBackend());
+        LatencyRecorder recorder;
+        double value = 0.0;
+        for (auto _ : state)
+        {
+            value += 0.5;
+            recorder.Start();
+            client.UpdateValue("value", value);
+            recorder.Stop();
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(UpdateValueTyped)->UseRealTime();
+
+    /// Update N probes, of which the given percentage changes in each cycle.
+    void Update(benchmark::State& state)
+    {
+        auto probes_count = static_cast<std::size_t>(state.range(0));
+        auto changed_count = probes_count * static_cast<std::size_t>(state.range(1)) / 100;
+
+        InspectionClient client("benchmark_update", CreateBackend());
+        std::vector<long long> values(probes_count, 0);
+        for (std::size_t index = 0; index < probes_count; ++index)
+        {
+            client.AddProbe("probe_" + std::to_string(index), [&values, index]{
+                return std::to_string(values[index]);
+            });
+        }
+        client.Update(true);
+
+        LatencyRecorder recorder;
+        std::size_t sent_count = 0;
+        for (auto _ : state)
+        {
+            for (std::size_t index = 0; index < changed_count; ++index)
+            {
+                ++values[index];
+            }
+            recorder.Start();
+            sent_count += client.Update().SentCount;
+            recorder.Stop();
+        }
+        recorder.Report(state, static_cast<std::int64_t>(probes_count));
+        state.counters["sent_per_cycle"] = static_cast<double>(sent_count) / static_cast<double>(state.iterations());
+    }
+    BENCHMARK(Update)->ArgsProduct({{16, 256, 4096}, {0, 10, 100}})->ArgNames({"probes", "changed%"})
+        ->UseRealTime();
+
+    /// Update a single probe whose value changes in each call.
+    void UpdateProbe(benchmark::State& state)
+    {
+        InspectionClient client("benchmark_update_probe", CreateBackend());
+        long long value = 0;
+        client.AddProbe("probe", [&value]{ return std::to_string(value); });
+
+        LatencyRecorder recorder;
+        for (auto _ : state)
+        {
+            ++value;
+            recorder.Start();
+            client.UpdateProbe("probe");
+            recorder.Stop();
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(UpdateProbe)->UseRealTime();
+
+    /// Update a changed value from each thread with its own client, with or without merging their flushes.
+    void ConcurrentUpdate(benchmark::State& state)
+    {
+        // Clients of all threads share one connection, like the modules of a process do.
+        static const std::shared_ptr<StorageBackend> plain_backend = CreateBackend();
+        static const std::shared_ptr<StorageBackend> multiplexed_backend =
+                std::make_shared<MultiplexedBackend>(plain_backend);
+        InspectionClient client("benchmark_concurrent_update_" + std::to_string(state.thread_index()),
+                                state.range(0) ? multiplexed_backend : plain_backend);
+
+        LatencyRecorder recorder;
+        std::size_t counter = 0;
+        for (auto _ : state)
+        {
+            auto text = std::to_string(counter++);
+            recorder.Start();
+            client.UpdateValue("value", text);
+            recorder.Stop();
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(ConcurrentUpdate)->Arg(0)->Arg(1)->ArgName("multiplexed")->ThreadRange(1, 16)->UseRealTime();
+
+    /// Query the text of a variable.
+    void QueryText(benchmark::State& state)
+    {
+        InspectionClient client("benchmark_query_text", CreateBackend());
+        client.UpdateValue("value", std::string("3.1415926"));
+        InspectionReader reader("benchmark_query_text", CreateBackend());
+
+        LatencyRecorder recorder;
+        for (auto _ : state)
+        {
+            recorder.Start();
+            auto text = reader.QueryText("value");
+            recorder.Stop();
+            benchmark::DoNotOptimize(text);
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(QueryText)->UseRealTime();
+
+    /// Query and parse the value of a variable.
+    void QueryValue(benchmark::State& state)
+    {
+        InspectionClient client("benchmark_query_value", CreateBackend());
+        client.UpdateValue("value", 3.1415926);
+        InspectionReader reader("benchmark_query_value", CreateBackend());
+
+        LatencyRecorder recorder;
+        for (auto _ : state)
+        {
+            recorder.Start();
+            auto value = reader.QueryValue<double>("value");
+            recorder.Stop();
+            benchmark::DoNotOptimize(value);
+        }
+        recorder.Report(state);
+    }
+    BENCHMARK(QueryValue)->UseRealTime();
+
+    /// List the variables of a unit with N variables.
+    void QueryVariables(benchmark::State& state)
+    {
+        auto variables_count = static_cast<std::size_t>(state.range(0));
+        InspectionClient client("benchmark_query_variables", CreateBackend());
+        for (std::size_t index = 0; index < variables_count; ++index)
+        {
+            client.UpdateValue("variable_" + std::to_string(index), std::string("0"));
+        }
+        InspectionReader reader("benchmark_query_variables", CreateBackend());
+
+        LatencyRecorder recorder;
+        for (auto _ : state)
+        {
+            recorder.Start();
+            auto names = reader.QueryVariables();
+            recorder.Stop();
+            benchmark::DoNotOptimize(names);
+        }
+        recorder.Report(state, static_cast<std::int64_t>(variables_count));
+    }
+    BENCHMARK(QueryVariables)->Arg(16)->Arg(256)->Arg(4096)->ArgName("variables")->UseRealTime();
+}
+
+int main(int arguments_count, char** arguments)
+{
+    std::string server_executable = "redis-server";
+    bool spawn_server = true;
+
+    // Options of this program are removed before the remaining ones are parsed by Google Benchmark.
+    std::vector<char*> benchmark_arguments;
+    for (int index = 0; index < arguments_count; ++index)
+    {
+        std::string_view argument = arguments[index];
+        if (argument == "--memory")
+        {
+            UseMemoryBackend = true;
+        }
+        else if (argument == "--no-spawn")
+        {
+            spawn_server = false;
+        }
+        else if (argument.rfind("--redis-port=", 0) == 0)
+        {
+            RedisPort = static_cast<unsigned int>(std::stoul(std::string(argument.substr(13))));
+        }
+        else if (argument.rfind("--redis-server=", 0) == 0)
+        {
+            server_executable = std::string(argument.substr(15));
+        }
+        else if (argument == "--help")
+        {
+            std::cout << "Options:\n"
+                      << "  --memory              benchmark the in-process backend instead of Redis.\n"
+                      << "  --no-spawn            use the Redis server already listening on the port.\n"
+                      << "  --redis-port=<port>   port of the Redis server, 16379 by default.\n"
+                      << "  --redis-server=<path> redis-server executable to spawn.\n"
+                      << "Other options are passed to Google Benchmark, such as --benchmark_filter=<regex>."
+                      << std::endl;
+            return 0;
+        }
+        else
+        {
+            benchmark_arguments.push_back(arguments[index]);
+        }
+    }
+    int benchmark_arguments_count = static_cast<int>(benchmark_arguments.size());
+    benchmark::Initialize(&benchmark_arguments_count, benchmark_arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmark_arguments_count, benchmark_arguments.data())) return 1;
+
+    std::optional<RedisServer> server;
+    if (UseMemoryBackend)
+    {
+        SharedMemoryBackend = std::make_shared<MemoryBackend>();
+    }
+    else if (spawn_server)
+    {
+        server.emplace(server_executable, RedisPort);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "RedisServer.hpp"
+
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sw/redis++/redis++.h>
+
+namespace Gaia::InspectionService
+{
+    /// Spawn a server and wait until it accepts commands.
+    RedisServer::RedisServer(const std::string &executable, unsigned int port) : Port(port)
+    {
+        auto port_text = std::to_string(port);
+        ProcessID = fork();
+        if (ProcessID < 0) throw std::runtime_error("Failed to fork the Redis server process.");
+        if (ProcessID == 0)
+        {
+            auto null_descriptor = open("/dev/null", O_WRONLY);
+            if (null_descriptor >= 0)
+            {
+                dup2(null_descriptor, STDOUT_FILENO);
+                dup2(null_descriptor, STDERR_FILENO);
+            }
+            execlp(executable.c_str(), executable.c_str(), "--port", port_text.c_str(),
+                   "--save", "", "--appendonly", "no", static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            int status = 0;
+            if (waitpid(ProcessID, &status, WNOHANG) == ProcessID)
+            {
+                ProcessID = -1;
+                throw std::runtime_error("Redis server " + executable + " exited on start.");
+            }
+            try
+            {
+                sw::redis::Redis connection("tcp://127.0.0.1:" + port_text);
+                connection.ping();
+                return;
+            }
+            catch (const sw::redis::Error&)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        kill(ProcessID, SIGKILL);
+        waitpid(ProcessID, nullptr, 0);
+        ProcessID = -1;
+        throw std::runtime_error("Redis server on port " + port_text + " does not respond.");
+    }
+
+    /// Terminate the server.
+    RedisServer::~RedisServer()
+    {
+        if (ProcessID <= 0) return;
+        kill(ProcessID, SIGTERM);
+        waitpid(ProcessID, nullptr, 0);
+    }
+}
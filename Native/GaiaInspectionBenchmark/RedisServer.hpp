@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Redis server process spawned for benchmarks, which will be terminated on destruction.
+     * @details The server runs without persistence, so benchmarks never touch the disk.
+     */
+    class RedisServer
+    {
+    private:
+        /// ID of the server process.
+        pid_t ProcessID {-1};
+
+    public:
+        /// Port of the server.
+        const unsigned int Port;
+
+        /**
+         * @brief Spawn a server and wait until it accepts commands.
+         * @param executable Path or name of the redis-server executable.
+         * @param port Port to listen on.
+         * @throw std::runtime_error If the server can not be spawned or it does not respond in time.
+         */
+        RedisServer(const std::string& executable, unsigned int port);
+
+        RedisServer(const RedisServer&) = delete;
+        RedisServer& operator=(const RedisServer&) = delete;
+
+        /// Terminate the server.
+        ~RedisServer();
+    };
+}
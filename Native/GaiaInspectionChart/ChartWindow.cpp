@@ -10,16 +10,18 @@
 
 #include <QMessageBox>
 #include <algorithm>
+#include <cmath>
 
 namespace Gaia::InspectionChart
 {
     /// Connect to the given reader and build the window.
-    ChartWindow::ChartWindow(std::unique_ptr<InspectionService::InspectionReader>&& reader, QWidget *parent) :
-        Reader(std::move(reader)), QMainWindow(parent), ui(new Ui::ChartWindow)
+    ChartWindow::ChartWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                             std::unique_ptr<InspectionService::InspectionReader>&& reader, QWidget *parent) :
+        Hub(std::move(hub)), Reader(std::move(reader)), QMainWindow(parent), ui(new Ui::ChartWindow)
     {
         ui->setupUi(this);
 
-        if (!Reader)
+        if (!Hub || !Reader)
         {
             QMessageBox::critical(this, "Error", "Can not connect to the inspected variable.");
             QApplication::exit(1);
@@ -71,17 +73,30 @@ namespace Gaia::InspectionChart
                 this, SLOT(OnVariableChanged(QString)));
         connect(UpdateTimer, SIGNAL(timeout()), this, SLOT(OnUpdate()));
 
-        UpdateTimer->start();
+        RenderTimer = new QTimer(this);
+        RenderTimer->setInterval(33);
+        connect(RenderTimer, SIGNAL(timeout()), this, SLOT(OnRender()));
+        RenderTimer->start();
 
         if (!ui->nameCombo->currentText().isEmpty())
         {
             VariableName = ui->nameCombo->currentText().toStdString();
+            LoadHistory();
+            RestartPolling();
         }
     }
 
     /// Release resources.
     ChartWindow::~ChartWindow()
     {
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+        }
+        if (SubscriptionID)
+        {
+            Reader->Unsubscribe(*SubscriptionID);
+        }
         delete ChartModel;
         delete ui;
     }
@@ -89,59 +104,160 @@ namespace Gaia::InspectionChart
     /// Change the interval time of timer.
     void ChartWindow::OnFrequencyChanged(int value)
     {
-        UpdateTimer->stop();
+        if (SubscriptionID) return;
         UpdateTimer->setInterval(1000 / value);
-        UpdateTimer->start();
+        RestartPolling();
+    }
+
+    /// Restart polling the chosen variable at the chosen frequency.
+    void ChartWindow::RestartPolling()
+    {
+        UpdateTimer->stop();
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+            HubSubscriptionID.reset();
+        }
+        auto serial = ++PollingSerial;
+        if (SubscriptionID || VariableName.empty()) return;
+        if (HistoryAvailable)
+        {
+            UpdateTimer->start();
+            return;
+        }
+        HubSubscriptionID = Hub->Subscribe(Reader->GetUnitName(), VariableName, ui->frequencySpin->value(),
+            [this, serial](const std::optional<std::string>& value){
+                // Values arrive on the poller thread of the hub, so the chart is updated in the GUI thread.
+                QMetaObject::invokeMethod(this, [this, serial, value]{
+                    if (serial == PollingSerial) AppendValue(value);
+                }, Qt::QueuedConnection);
+            });
+    }
+
+    /// Switch from timer polling to change notifications.
+    void ChartWindow::SubscribeChanges()
+    {
+        if (SubscriptionID) return;
+        UpdateTimer->stop();
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+            HubSubscriptionID.reset();
+        }
+        ++PollingSerial;
+        ui->frequencySpin->setEnabled(false);
+        OnUpdate();
+        // All variables of the unit are subscribed, so the chosen variable can be changed without resubscribing.
+        SubscriptionID = Reader->Subscribe("*",
+            [this](const std::string& name, const std::optional<std::string>& value){
+                // Notifications arrive on the subscriber thread, so the chart is updated in the GUI thread.
+                QMetaObject::invokeMethod(this, [this, name, value]{
+                    if (name != VariableName) return;
+                    // With history, all entries since the last read are appended, so no sample will be missed.
+                    if (HistoryAvailable) OnUpdate();
+                    else AppendValue(value);
+                }, Qt::QueuedConnection);
+            });
     }
 
     /// Update and add value into the chart.
     void ChartWindow::OnUpdate()
     {
-        auto value_text = Reader->QueryText(VariableName);
-        ui->labelValue->setText(QString::fromStdString(value_text.has_value() ? *value_text : "(Empty)"));
+        if (HistoryAvailable)
+        {
+            for (const auto& entry : Reader->QueryHistorySince(VariableName, HistoryCursor))
+            {
+                AppendValue(entry.Value);
+            }
+            return;
+        }
+        AppendValue(Reader->QueryText(VariableName));
+    }
+
+    /// Fill the chart with the latest history of the variable, if its history is recorded.
+    void ChartWindow::LoadHistory()
+    {
+        HistoryCursor.clear();
+        Samples.Reserve(GetWindowLength());
+        auto entries = Reader->QueryLatestHistory(VariableName, GetWindowLength());
+        HistoryAvailable = !entries.empty();
+        if (!HistoryAvailable) return;
+        HistoryCursor = entries.back().ID;
+        for (const auto& entry : entries)
+        {
+            AppendValue(entry.Value);
+        }
+    }
+
+    /// Record the given value text and append it into the samples, they will be drawn in the next frame.
+    void ChartWindow::AppendValue(const std::optional<std::string>& value_text)
+    {
+        LatestText = value_text.has_value() ? *value_text : "(Empty)";
+        RenderPending = true;
         if (!value_text.has_value()) return;
 
         double current_value;
         try
         {
             current_value = std::stod(*value_text);
-            ChartData->append(static_cast<qreal>(NextRecordIndex), current_value);
+        }
+        catch(std::logic_error& error)
+        {
+            return;
+        }
+        // Non-finite values can not be drawn, and they would break the ordering of the min and max queues.
+        if (!std::isfinite(current_value)) return;
+        Samples.Push(static_cast<double>(NextRecordIndex), current_value);
+        ++NextRecordIndex;
+    }
 
-            ++NextRecordIndex;
+    /// Get the count of samples displayed in the chart.
+    std::size_t ChartWindow::GetWindowLength() const
+    {
+        if (WindowLength > 0) return WindowLength;
+        return std::max(static_cast<std::size_t>(ui->centralwidget->size().width() / 10), std::size_t(1));
+    }
 
-            unsigned int max_records_columns = ui->centralwidget->size().width() / 10;
-            unsigned int current_records = ChartData->count();
-            if (current_records > max_records_columns)
-            {
-                ChartData->removePoints(0,static_cast<int>(current_records - max_records_columns));
-            }
+    /// Change the count of samples displayed in the chart.
+    void ChartWindow::SetWindowLength(std::size_t samples_count)
+    {
+        WindowLength = samples_count;
+        Samples.Reserve(GetWindowLength());
+        RenderPending = true;
+    }
 
-            const auto& data = ChartData->points();
-            auto [min_iterator, max_iterator] = std::minmax_element(data.begin(), data.end(), [](const QPointF& v1, const QPointF& v2)
-            {
-                return v1.y() < v2.y();
-            });
-            auto min_value = min_iterator->y();
-            auto max_value = max_iterator->y();
-            double lower_bound = min_value;
-            double upper_bound = max_value;
-            auto difference = max_value - min_value;
-            if (min_value * (min_value - (difference / 10)) > 0)
-            {
-                lower_bound -= difference / 10 + 1.0;
-            }
-            upper_bound += difference / 10 + 1.0;
-            if (upper_bound < 1.0) upper_bound = 1.0;
-            if (lower_bound < 0.0 && lower_bound * min_value < 0) lower_bound = 0.0f;
-            AxisY->setRange(lower_bound, upper_bound);
-            AxisX->setRange(
-                    NextRecordIndex <= max_records_columns ? 0 : static_cast<qreal>(NextRecordIndex - current_records - 1),
-                    static_cast<qreal>(NextRecordIndex - current_records - 1 + max_records_columns));
-            AxisX->setTickCount(static_cast<int>(max_records_columns / 10));
-        }
-        catch(std::invalid_argument& error)
+    /// Draw the samples appended since the last frame.
+    void ChartWindow::OnRender()
+    {
+        auto window_length = GetWindowLength();
+        if (window_length != Samples.GetCapacity())
         {
+            Samples.Reserve(window_length);
+            RenderPending = true;
         }
+        if (!RenderPending) return;
+        RenderPending = false;
+
+        ui->labelValue->setText(QString::fromStdString(LatestText));
+
+        // Two points per pixel column keep both extremes of each column, more points would be invisible.
+        auto plot_width = std::max(ChartModel->plotArea().width(), 1.0);
+        auto points_limit = static_cast<std::size_t>(plot_width) * 2;
+        QVector<QPointF> points;
+        points.reserve(static_cast<int>(std::min(Samples.GetSize(), points_limit)));
+        DecimateLargestTriangles(Samples, points_limit, [&points](const Sample& sample){
+            points.append(QPointF(sample.X, sample.Y));
+        });
+        // One replace() redraws the series once, while appending and removing points redraws it per call.
+        ChartData->replace(points);
+        if (Samples.IsEmpty()) return;
+
+        auto [lower_bound, upper_bound] = GetDisplayRange(Samples.GetMin(), Samples.GetMax());
+        AxisY->setRange(lower_bound, upper_bound);
+
+        auto first_index = Samples[0].X;
+        AxisX->setRange(first_index, first_index + static_cast<qreal>(window_length));
+        AxisX->setTickCount(std::max(static_cast<int>(plot_width / 100), 2));
     }
 
     /// Change the bound variable name.
@@ -149,6 +265,10 @@ namespace Gaia::InspectionChart
     {
         VariableName = name.toStdString();
         NextRecordIndex = 0;
-        ChartData->clear();
+        Samples.Clear();
+        RenderPending = true;
+        LoadHistory();
+        if (SubscriptionID && !HistoryAvailable) OnUpdate();
+        RestartPolling();
     }
 }
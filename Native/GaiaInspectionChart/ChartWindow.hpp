@@ -6,8 +6,10 @@
 
 #include <string>
 #include <memory>
+#include <optional>
 
 #include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+#include "SampleBuffer.hpp"
 
 namespace Gaia::InspectionChart
 {
@@ -22,15 +24,29 @@ namespace Gaia::InspectionChart
     public:
         /**
          * @brief Connect to the given reader and build the window.
-         * @param reader Reader for the inspected value.
+         * @param hub Hub which polls the inspected value, it can be shared with other windows.
+         * @param reader Reader for the variable list, the history and the change notifications.
          * @param parent Parent widget.
          */
-        explicit ChartWindow(
-                std::unique_ptr<InspectionService::InspectionReader>&& reader, QWidget *parent = nullptr);
+        ChartWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                    std::unique_ptr<InspectionService::InspectionReader>&& reader, QWidget *parent = nullptr);
 
         /// Release resources.
         ~ChartWindow() override;
 
+        /**
+         * @brief Switch from timer polling to change notifications.
+         * @details Values will only be appended when the inspection client publishes a change.
+         */
+        void SubscribeChanges();
+
+        /**
+         * @brief Change the count of samples displayed in the chart.
+         * @param samples_count Count of the latest samples to display, 0 to follow the width of the window.
+         * @details Long windows are downsampled to the width of the plot area when they are drawn.
+         */
+        void SetWindowLength(std::size_t samples_count);
+
     protected slots:
         /// Triggered when frequency spin changed.
         void OnFrequencyChanged(int value);
@@ -38,25 +54,65 @@ namespace Gaia::InspectionChart
         void OnVariableChanged(const QString& name);
         /// Triggered when update timer time out.
         void OnUpdate();
+        /// Triggered when render timer time out, draw the samples appended since the last frame.
+        void OnRender();
+
+    protected:
+        /// Record the given value text and append it into the samples, they will be drawn in the next frame.
+        void AppendValue(const std::optional<std::string>& value_text);
+        /// Get the count of samples displayed in the chart.
+        [[nodiscard]] std::size_t GetWindowLength() const;
+        /// Fill the chart with the latest history of the variable, if its history is recorded.
+        void LoadHistory();
+        /**
+         * @brief Restart polling the chosen variable at the chosen frequency.
+         * @details
+         *  The history is read incrementally by the update timer if it is available,
+         *  otherwise the value is polled by the hub. Nothing is polled with change notifications.
+         */
+        void RestartPolling();
 
     private:
         std::string VariableName;
 
         unsigned long NextRecordIndex {0};
 
+        /// Whether the history of the variable is recorded, values will be read incrementally from it.
+        bool HistoryAvailable {false};
+        /// ID of the last read entry in the history.
+        std::string HistoryCursor;
+
         /// Window resource.
         Ui::ChartWindow *ui;
 
+        /// Hub which polls the inspected value.
+        std::shared_ptr<InspectionService::ReaderHub> Hub;
+        /// ID of the polling subscription in the hub, only valid when the hub is polling.
+        std::optional<std::size_t> HubSubscriptionID;
+        /// Serial of the polling, values polled for a previous variable or frequency are discarded by it.
+        std::size_t PollingSerial {0};
         /// Inspected variable reader.
         std::unique_ptr<InspectionService::InspectionReader> Reader;
         /// Timer for auto update.
         QTimer* UpdateTimer {nullptr};
+        /// ID of the change subscription, only valid when subscribed.
+        std::optional<std::size_t> SubscriptionID;
         /// Chart data for visualization.
         QChart* ChartModel {nullptr};
         /// Chart view for data visualization.
         QChartView* ChartView {nullptr};
         /// Data to visualize in the chart.
         QLineSeries* ChartData {nullptr};
+        /// Latest samples in the window, which are downsampled into the chart data in each frame.
+        SampleBuffer Samples;
+        /// Count of samples in the window, 0 means following the width of the window.
+        std::size_t WindowLength {0};
+        /// Text of the latest value, displayed in the next frame.
+        std::string LatestText {"(Empty)"};
+        /// Whether samples or the value text changed since the last frame.
+        bool RenderPending {false};
+        /// Timer which draws the changes at the frame rate, instead of once per sample.
+        QTimer* RenderTimer {nullptr};
 
         QValueAxis* AxisX {nullptr};
         QValueAxis* AxisY {nullptr};
@@ -1,9 +1,11 @@
 #include <iostream>
 #include <memory>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <GaiaInspectionReader/GaiaInspectionReader.hpp>
 #include <QApplication>
 #include "ChartWindow.hpp"
+#include "OverlayWindow.hpp"
 
 int main(int arguments_count, char** arguments)
 {
@@ -22,7 +24,15 @@ int main(int arguments_count, char** arguments)
             ("unit,u", value<std::string>()->default_value(std::string()),
              "name of the unit to watch")
             ("frequency,f", value<unsigned int>(), "query frequency, aka. query times per second.")
-            ("list,l", "list all inspection variables.");
+            ("window,w", value<std::size_t>(),
+             "count of the latest samples to display, follows the window width by default.")
+            ("list,l", "list all inspection variables.")
+            ("overlay,o", value<std::vector<std::string>>()->multitoken(),
+             "overlay variables in one chart, each one as <unit>/<variable> or <variable> of the given unit.")
+            ("normalize", "scale each overlaid variable into [0, 1] instead of giving it its own axis.")
+            ("hash", "read variables stored in the hash layout.")
+            ("shm", "read values from shared memory when the client runs on this host.")
+            ("push", "receive change notifications instead of polling, the client should enable notifications.");
 
     variables_map variables;
     store(parse_command_line(arguments_count, arguments, options), variables);
@@ -34,8 +44,24 @@ int main(int arguments_count, char** arguments)
         return 0;
     }
 
-    auto reader = std::make_unique<InspectionReader>("*", variables["port"].as<unsigned int>(),
-            variables["host"].as<std::string>());
+    // The reader and the hub share one connection.
+    auto connection = std::make_shared<sw::redis::Redis>(
+            "tcp://" + variables["host"].as<std::string>() + ":" +
+            std::to_string(variables["port"].as<unsigned int>()));
+    auto reader = std::make_unique<InspectionReader>("*", connection);
+    auto hub = std::make_shared<ReaderHub>(std::make_shared<RedisBackend>(connection));
+
+    if (variables.count("hash"))
+    {
+        reader->SetStorageLayout(InspectionReader::StorageLayout::Hash);
+        hub->SetStorageLayout(InspectionReader::StorageLayout::Hash);
+    }
+
+    if (variables.count("shm"))
+    {
+        reader->SetSharedMemory(true);
+        hub->SetSharedMemory(true);
+    }
 
     if (variables.count("list"))
     {
@@ -52,7 +78,43 @@ int main(int arguments_count, char** arguments)
 
     QApplication application(arguments_count, arguments);
 
-    ChartWindow window(std::move(reader));
+    if (variables.count("overlay"))
+    {
+        std::vector<std::pair<std::string, std::string>> overlaid_variables;
+        for (const auto& token : variables["overlay"].as<std::vector<std::string>>())
+        {
+            auto separator = token.find('/');
+            if (separator == std::string::npos)
+            {
+                overlaid_variables.emplace_back(variables["unit"].as<std::string>(), token);
+            }
+            else
+            {
+                overlaid_variables.emplace_back(token.substr(0, separator), token.substr(separator + 1));
+            }
+        }
+        OverlayWindow overlay_window(
+                hub, std::move(overlaid_variables),
+                variables.count("frequency") ? variables["frequency"].as<unsigned int>() : 30,
+                variables.count("normalize") ? OverlayWindow::ScaleMode::Normalized :
+                                               OverlayWindow::ScaleMode::SeparateAxes);
+        if (variables.count("window"))
+        {
+            overlay_window.SetWindowLength(variables["window"].as<std::size_t>());
+        }
+        overlay_window.show();
+        return QApplication::exec();
+    }
+
+    ChartWindow window(hub, std::move(reader));
+    if (variables.count("window"))
+    {
+        window.SetWindowLength(variables["window"].as<std::size_t>());
+    }
+    if (variables.count("push"))
+    {
+        window.SubscribeChanges();
+    }
     window.show();
 
     return QApplication::exec();
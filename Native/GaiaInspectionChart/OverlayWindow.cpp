@@ -0,0 +1,179 @@
+#include "OverlayWindow.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Gaia::InspectionChart
+{
+    /// Subscribe the given variables and build the window.
+    OverlayWindow::OverlayWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                                 std::vector<std::pair<std::string, std::string>> variables,
+                                 unsigned int frequency, ScaleMode mode, QWidget* parent) :
+        QMainWindow(parent), Hub(std::move(hub)), Mode(mode)
+    {
+        setWindowTitle("Gaia Inspection - Overlay");
+        setWindowFlags(windowFlags() | Qt::WindowStaysOnTopHint);
+        resize(800, 400);
+
+        ChartModel = new QtCharts::QChart();
+        ChartView = new QtCharts::QChartView(this);
+        ChartView->setChart(ChartModel);
+        setCentralWidget(ChartView);
+
+        AxisX = new QValueAxis(this);
+        AxisX->setRange(0, 20);
+        AxisX->setTitleText("Frame");
+        ChartModel->addAxis(AxisX, Qt::AlignmentFlag::AlignBottom);
+
+        if (Mode == ScaleMode::Normalized)
+        {
+            AxisY = new QValueAxis(this);
+            AxisY->setRange(-0.05, 1.05);
+            AxisY->setTitleText("Normalized Value");
+            ChartModel->addAxis(AxisY, Qt::AlignmentFlag::AlignLeft);
+        }
+
+        Traces.resize(variables.size());
+        for (std::size_t index = 0; index < variables.size(); ++index)
+        {
+            auto& trace = Traces[index];
+            trace.Name = QString::fromStdString(variables[index].first + "/" + variables[index].second);
+            trace.Samples.Reserve(GetWindowLength());
+            trace.Series = new QtCharts::QLineSeries(this);
+            trace.Series->setName(trace.Name);
+            ChartModel->addSeries(trace.Series);
+            trace.Series->attachAxis(AxisX);
+            if (Mode == ScaleMode::Normalized)
+            {
+                trace.Series->attachAxis(AxisY);
+                continue;
+            }
+            // Axes alternate between both sides, and they are colored like their series to tell them apart.
+            trace.Axis = new QValueAxis(this);
+            trace.Axis->setTitleText(trace.Name);
+            trace.Axis->setLinePenColor(trace.Series->color());
+            trace.Axis->setLabelsColor(trace.Series->color());
+            ChartModel->addAxis(trace.Axis, index % 2 == 0 ? Qt::AlignmentFlag::AlignLeft :
+                                                             Qt::AlignmentFlag::AlignRight);
+            trace.Series->attachAxis(trace.Axis);
+        }
+
+        RenderTimer = new QTimer(this);
+        RenderTimer->setInterval(33);
+        connect(RenderTimer, SIGNAL(timeout()), this, SLOT(OnRender()));
+        RenderTimer->start();
+
+        if (!Hub || Traces.empty()) return;
+        HubSubscriptionID = Hub->SubscribeGroup(std::move(variables), frequency,
+            [this](const std::vector<std::optional<std::string>>& values){
+                // Values arrive on the poller thread of the hub, so the chart is updated in the GUI thread.
+                QMetaObject::invokeMethod(this, [this, values]{
+                    AppendValues(values);
+                }, Qt::QueuedConnection);
+            });
+    }
+
+    /// Cancel the subscription and release resources.
+    OverlayWindow::~OverlayWindow()
+    {
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+        }
+        delete ChartModel;
+    }
+
+    /// Append the values sampled in one tick, in the order of the variables.
+    void OverlayWindow::AppendValues(const std::vector<std::optional<std::string>>& value_texts)
+    {
+        auto count = std::min(value_texts.size(), Traces.size());
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            auto& trace = Traces[index];
+            const auto& value_text = value_texts[index];
+            trace.LatestText = value_text.has_value() ? *value_text : "(Empty)";
+            if (!value_text.has_value()) continue;
+            double current_value;
+            try
+            {
+                current_value = std::stod(*value_text);
+            }
+            catch(std::logic_error& error)
+            {
+                continue;
+            }
+            if (!std::isfinite(current_value)) continue;
+            trace.Samples.Push(static_cast<double>(NextRecordIndex), current_value);
+        }
+        ++NextRecordIndex;
+        RenderPending = true;
+    }
+
+    /// Get the count of samples displayed in the chart.
+    std::size_t OverlayWindow::GetWindowLength() const
+    {
+        if (WindowLength > 0) return WindowLength;
+        return std::max(static_cast<std::size_t>(width() / 10), std::size_t(1));
+    }
+
+    /// Change the count of samples displayed in the chart.
+    void OverlayWindow::SetWindowLength(std::size_t samples_count)
+    {
+        WindowLength = samples_count;
+        RenderPending = true;
+    }
+
+    /// Draw the samples appended since the last frame.
+    void OverlayWindow::OnRender()
+    {
+        auto window_length = GetWindowLength();
+        for (auto& trace : Traces)
+        {
+            if (trace.Samples.GetCapacity() == window_length) continue;
+            trace.Samples.Reserve(window_length);
+            RenderPending = true;
+        }
+        if (!RenderPending) return;
+        RenderPending = false;
+
+        auto plot_width = std::max(ChartModel->plotArea().width(), 1.0);
+        auto points_limit = static_cast<std::size_t>(plot_width) * 2;
+        for (auto& trace : Traces)
+        {
+            trace.Series->setName(trace.Name + ": " + QString::fromStdString(trace.LatestText));
+            QVector<QPointF> points;
+            points.reserve(static_cast<int>(std::min(trace.Samples.GetSize(), points_limit)));
+            if (trace.Samples.IsEmpty())
+            {
+                trace.Series->replace(points);
+                continue;
+            }
+
+            auto min_value = trace.Samples.GetMin();
+            auto max_value = trace.Samples.GetMax();
+            if (Mode == ScaleMode::Normalized)
+            {
+                // Scaling is affine, so the points selected by the decimation are the same as unscaled ones.
+                auto difference = max_value - min_value;
+                DecimateLargestTriangles(trace.Samples, points_limit,
+                    [&points, min_value, difference](const Sample& sample){
+                        points.append(QPointF(sample.X,
+                                              difference > 0.0 ? (sample.Y - min_value) / difference : 0.5));
+                    });
+            }
+            else
+            {
+                DecimateLargestTriangles(trace.Samples, points_limit, [&points](const Sample& sample){
+                    points.append(QPointF(sample.X, sample.Y));
+                });
+                auto [lower_bound, upper_bound] = GetDisplayRange(min_value, max_value);
+                trace.Axis->setRange(lower_bound, upper_bound);
+            }
+            trace.Series->replace(points);
+        }
+
+        auto first_index = NextRecordIndex > window_length ? NextRecordIndex - window_length : 0;
+        AxisX->setRange(static_cast<qreal>(first_index), static_cast<qreal>(first_index + window_length));
+        AxisX->setTickCount(std::max(static_cast<int>(plot_width / 100), 2));
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QMainWindow>
+#include <QTimer>
+#include <QtCharts>
+
+#include <string>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+#include "SampleBuffer.hpp"
+
+namespace Gaia::InspectionChart
+{
+    /**
+     * @brief Window which overlays several variables in one chart, such as a setpoint, a measured value and an
+     *        actuator output.
+     * @details
+     *  All variables are polled by one group subscription of the hub, so they are read in one round trip per tick
+     *  and their samples share the same record index on the X axis.
+     */
+    class OverlayWindow : public QMainWindow
+    {
+        Q_OBJECT
+
+    public:
+        /// How the variables share the vertical space of the chart.
+        enum class ScaleMode
+        {
+            /// Each variable has its own value axis, in the color of its series.
+            SeparateAxes,
+            /// Each variable is scaled into [0, 1] by its min and max values in the window.
+            Normalized
+        };
+
+        /**
+         * @brief Subscribe the given variables and build the window.
+         * @param hub Hub which polls the variables, it can be shared with other windows.
+         * @param variables Pairs of unit names and variable names, the units can differ.
+         * @param frequency Count of samples per second.
+         * @param mode How the variables share the vertical space.
+         * @param parent Parent widget.
+         */
+        OverlayWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                      std::vector<std::pair<std::string, std::string>> variables,
+                      unsigned int frequency = 30, ScaleMode mode = ScaleMode::SeparateAxes,
+                      QWidget* parent = nullptr);
+
+        /// Cancel the subscription and release resources.
+        ~OverlayWindow() override;
+
+        /**
+         * @brief Change the count of samples displayed in the chart.
+         * @param samples_count Count of the latest samples to display, 0 to follow the width of the window.
+         */
+        void SetWindowLength(std::size_t samples_count);
+
+    protected slots:
+        /// Triggered when render timer time out, draw the samples appended since the last frame.
+        void OnRender();
+
+    protected:
+        /// Append the values sampled in one tick, in the order of the variables.
+        void AppendValues(const std::vector<std::optional<std::string>>& value_texts);
+        /// Get the count of samples displayed in the chart.
+        [[nodiscard]] std::size_t GetWindowLength() const;
+
+    private:
+        /// Series of a variable.
+        struct Trace
+        {
+            /// Displayed name of the variable, "<unit>/<variable>".
+            QString Name;
+            /// Latest samples in the window.
+            SampleBuffer Samples;
+            /// Text of the latest value, displayed in the legend.
+            std::string LatestText {"(Empty)"};
+            /// Data to visualize in the chart.
+            QLineSeries* Series {nullptr};
+            /// Value axis of this variable, only used with separate axes.
+            QValueAxis* Axis {nullptr};
+        };
+
+        /// Hub which polls the variables.
+        std::shared_ptr<InspectionService::ReaderHub> Hub;
+        /// ID of the group subscription in the hub.
+        std::optional<std::size_t> HubSubscriptionID;
+        /// How the variables share the vertical space.
+        const ScaleMode Mode;
+        /// Series of the variables, in the order of the subscribed variables.
+        std::vector<Trace> Traces;
+
+        /// Record index of the next tick, shared by all series.
+        unsigned long NextRecordIndex {0};
+        /// Count of samples in the window, 0 means following the width of the window.
+        std::size_t WindowLength {0};
+        /// Whether samples changed since the last frame.
+        bool RenderPending {false};
+
+        /// Timer which draws the changes at the frame rate.
+        QTimer* RenderTimer {nullptr};
+        /// Chart data for visualization.
+        QChart* ChartModel {nullptr};
+        /// Chart view for data visualization.
+        QChartView* ChartView {nullptr};
+        /// Axis of record indexes, shared by all series.
+        QValueAxis* AxisX {nullptr};
+        /// Axis of normalized values, only used in the normalized mode.
+        QValueAxis* AxisY {nullptr};
+    };
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Gaia::InspectionChart
+{
+    /// Sample of a chart, X is the record index and Y is the value.
+    struct Sample
+    {
+        double X;
+        double Y;
+    };
+
+    /**
+     * @brief Fixed-capacity ring buffer of samples, which tracks the min and max values in O(1).
+     * @details
+     *  Pushing a sample into a full buffer evicts the oldest one. The min and max values are kept by two monotonic
+     *  queues of sample sequence numbers, each sample enters and leaves each queue at most once, so pushing costs
+     *  amortized O(1) and querying the bounds costs O(1). No memory is allocated after construction or resizing.
+     */
+    class SampleBuffer
+    {
+    private:
+        /// Fixed-capacity queue of sample sequence numbers, in which the values are monotonic.
+        struct MonotonicQueue
+        {
+            std::vector<std::uint64_t> Sequences;
+            std::size_t Head {0};
+            std::size_t Count {0};
+
+            [[nodiscard]] std::uint64_t Front() const noexcept
+            {
+                return Sequences[Head];
+            }
+
+            [[nodiscard]] std::uint64_t Back() const noexcept
+            {
+                return Sequences[(Head + Count - 1) % Sequences.size()];
+            }
+
+            void PopFront() noexcept
+            {
+                Head = (Head + 1) % Sequences.size();
+                --Count;
+            }
+
+            void PopBack() noexcept
+            {
+                --Count;
+            }
+
+            void PushBack(std::uint64_t sequence) noexcept
+            {
+                Sequences[(Head + Count) % Sequences.size()] = sequence;
+                ++Count;
+            }
+        };
+
+        /// Storage of the samples, the sample with sequence s is at s % capacity.
+        std::vector<Sample> Samples;
+        /// Count of samples pushed since the buffer was cleared, which is the sequence of the next sample.
+        std::uint64_t PushedCount {0};
+        /// Count of samples in the buffer.
+        std::size_t Count {0};
+        /// Queue whose front is the sequence of the min value.
+        MonotonicQueue MinQueue;
+        /// Queue whose front is the sequence of the max value.
+        MonotonicQueue MaxQueue;
+
+        /// Get the sample with the given sequence.
+        [[nodiscard]] const Sample& GetSample(std::uint64_t sequence) const noexcept
+        {
+            return Samples[static_cast<std::size_t>(sequence % Samples.size())];
+        }
+
+    public:
+        /**
+         * @brief Allocate the storage of samples.
+         * @param capacity Max count of samples, at least 1.
+         */
+        explicit SampleBuffer(std::size_t capacity = 1)
+        {
+            Reserve(capacity);
+        }
+
+        /**
+         * @brief Change the capacity, the latest samples which fit in are kept.
+         * @param capacity Max count of samples, at least 1.
+         * @details It costs O(n), so it should only be called when the chart window changes.
+         */
+        void Reserve(std::size_t capacity)
+        {
+            if (capacity == 0) capacity = 1;
+            if (capacity == Samples.size()) return;
+            std::vector<Sample> kept;
+            auto kept_count = Count < capacity ? Count : capacity;
+            kept.reserve(kept_count);
+            for (auto index = Count - kept_count; index < Count; ++index)
+            {
+                kept.push_back((*this)[index]);
+            }
+            Samples.assign(capacity, Sample{0.0, 0.0});
+            MinQueue.Sequences.assign(capacity, 0);
+            MaxQueue.Sequences.assign(capacity, 0);
+            Clear();
+            for (const auto& sample : kept)
+            {
+                Push(sample.X, sample.Y);
+            }
+        }
+
+        /// Remove all samples, the capacity is kept.
+        void Clear() noexcept
+        {
+            PushedCount = 0;
+            Count = 0;
+            MinQueue.Head = MinQueue.Count = 0;
+            MaxQueue.Head = MaxQueue.Count = 0;
+        }
+
+        /**
+         * @brief Append a sample, the oldest sample is evicted if the buffer is full.
+         * @param x Record index of the sample, it should be increasing.
+         * @param y Value of the sample, it should be finite.
+         */
+        void Push(double x, double y) noexcept
+        {
+            if (Count == Samples.size())
+            {
+                auto evicted = PushedCount - Count;
+                if (MinQueue.Front() == evicted) MinQueue.PopFront();
+                if (MaxQueue.Front() == evicted) MaxQueue.PopFront();
+                --Count;
+            }
+            auto sequence = PushedCount++;
+            Samples[static_cast<std::size_t>(sequence % Samples.size())] = Sample{x, y};
+            ++Count;
+
+            // Samples dominated by the new one can never be the bound again, because they will be evicted first.
+            while (MinQueue.Count > 0 && GetSample(MinQueue.Back()).Y >= y) MinQueue.PopBack();
+            MinQueue.PushBack(sequence);
+            while (MaxQueue.Count > 0 && GetSample(MaxQueue.Back()).Y <= y) MaxQueue.PopBack();
+            MaxQueue.PushBack(sequence);
+        }
+
+        /// Get the sample at the given position, 0 is the oldest one.
+        [[nodiscard]] const Sample& operator[](std::size_t index) const noexcept
+        {
+            return GetSample(PushedCount - Count + index);
+        }
+
+        /// Get the count of samples.
+        [[nodiscard]] std::size_t GetSize() const noexcept
+        {
+            return Count;
+        }
+
+        /// Get the max count of samples.
+        [[nodiscard]] std::size_t GetCapacity() const noexcept
+        {
+            return Samples.size();
+        }
+
+        /// Check whether the buffer has no sample.
+        [[nodiscard]] bool IsEmpty() const noexcept
+        {
+            return Count == 0;
+        }
+
+        /// Get the min value, the buffer should not be empty.
+        [[nodiscard]] double GetMin() const noexcept
+        {
+            return GetSample(MinQueue.Front()).Y;
+        }
+
+        /// Get the max value, the buffer should not be empty.
+        [[nodiscard]] double GetMax() const noexcept
+        {
+            return GetSample(MaxQueue.Front()).Y;
+        }
+    };
+
+    /**
+     * @brief Get the axis range which displays values between the given bounds with some margin.
+     * @return Pair of the lower bound and the upper bound of the axis.
+     */
+    inline std::pair<double, double> GetDisplayRange(double min_value, double max_value) noexcept
+    {
+        double lower_bound = min_value;
+        double upper_bound = max_value;
+        auto difference = max_value - min_value;
+        if (min_value * (min_value - (difference / 10)) > 0)
+        {
+            lower_bound -= difference / 10 + 1.0;
+        }
+        upper_bound += difference / 10 + 1.0;
+        if (upper_bound < 1.0) upper_bound = 1.0;
+        if (lower_bound < 0.0 && lower_bound * min_value < 0) lower_bound = 0.0;
+        return {lower_bound, upper_bound};
+    }
+
+    /**
+     * @brief Downsample the buffer with Largest-Triangle-Three-Buckets, which keeps the visual shape of the curve.
+     * @tparam Output Callable type with the signature void(const Sample&).
+     * @param samples Samples to downsample.
+     * @param threshold Max count of output samples, all samples are output if it is less than 3.
+     * @param output Function to receive the selected samples in order.
+     * @details
+     *  The first and the last samples are always kept. The others are divided into threshold - 2 buckets,
+     *  and in each bucket the sample forming the largest triangle with the previously selected sample
+     *  and the average of the next bucket is selected. It costs O(n) without allocation.
+     */
+    template <typename Output>
+    void DecimateLargestTriangles(const SampleBuffer& samples, std::size_t threshold, Output&& output)
+    {
+        auto count = samples.GetSize();
+        if (threshold < 3 || threshold >= count)
+        {
+            for (std::size_t index = 0; index < count; ++index) output(samples[index]);
+            return;
+        }
+
+        auto bucket_size = static_cast<double>(count - 2) / static_cast<double>(threshold - 2);
+        std::size_t selected = 0;
+        output(samples[0]);
+        for (std::size_t bucket = 0; bucket < threshold - 2; ++bucket)
+        {
+            auto range_begin = static_cast<std::size_t>(static_cast<double>(bucket) * bucket_size) + 1;
+            auto range_end = static_cast<std::size_t>(static_cast<double>(bucket + 1) * bucket_size) + 1;
+            auto next_begin = range_end;
+            auto next_end = std::min(static_cast<std::size_t>(static_cast<double>(bucket + 2) * bucket_size) + 1,
+                                     count);
+
+            double average_x = 0.0;
+            double average_y = 0.0;
+            for (auto index = next_begin; index < next_end; ++index)
+            {
+                average_x += samples[index].X;
+                average_y += samples[index].Y;
+            }
+            if (next_end > next_begin)
+            {
+                auto next_count = static_cast<double>(next_end - next_begin);
+                average_x /= next_count;
+                average_y /= next_count;
+            }
+            else
+            {
+                average_x = samples[count - 1].X;
+                average_y = samples[count - 1].Y;
+            }
+
+            const auto& anchor = samples[selected];
+            double max_area = -1.0;
+            auto max_index = range_begin;
+            for (auto index = range_begin; index < range_end; ++index)
+            {
+                const auto& candidate = samples[index];
+                // Twice the triangle area, the factor does not change the comparison.
+                auto area = std::abs((anchor.X - average_x) * (candidate.Y - anchor.Y) -
+                                     (anchor.X - candidate.X) * (average_y - anchor.Y));
+                if (area > max_area)
+                {
+                    max_area = area;
+                    max_index = index;
+                }
+            }
+            output(samples[max_index]);
+            selected = max_index;
+        }
+        output(samples[count - 1]);
+    }
+}
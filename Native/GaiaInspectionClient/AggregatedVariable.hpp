@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Handle of a high-frequency variable, whose samples are aggregated locally and published per window.
+     * @details
+     *  Record(...) only updates the statistics of the current window, which costs a few nanoseconds,
+     *  and the inspection client will publish the min, max, mean, last value and count of each window,
+     *  so the write volume of Redis depends on the window size rather than the sample rate.
+     */
+    class AggregatedVariable
+    {
+    public:
+        /// Statistics of a window.
+        struct Summary
+        {
+            /// Min value of the samples.
+            double Min {0.0};
+            /// Max value of the samples.
+            double Max {0.0};
+            /// Mean value of the samples.
+            double Mean {0.0};
+            /// Value of the last sample.
+            double Last {0.0};
+            /// Count of the samples.
+            std::size_t Count {0};
+        };
+
+        /// Layout of the published statistics.
+        enum class OutputLayout
+        {
+            /// Statistics are published as sibling variables "<name>/min", "<name>/max" and so on.
+            Siblings,
+            /// Statistics are published as one variable with a JSON object text.
+            Structured
+        };
+
+        /// Name of the variable.
+        const std::string Name;
+        /// Length of a window.
+        const std::chrono::steady_clock::duration Window;
+        /// Layout of the published statistics.
+        const OutputLayout Layout;
+
+    private:
+        /// Spin lock between the recording thread and the update cycle, they rarely contend.
+        std::atomic_flag Lock = ATOMIC_FLAG_INIT;
+
+        /// Min value of the samples in the current window.
+        double Min {std::numeric_limits<double>::max()};
+        /// Max value of the samples in the current window.
+        double Max {std::numeric_limits<double>::lowest()};
+        /// Sum of the samples in the current window.
+        double Sum {0.0};
+        /// Value of the last sample.
+        double Last {0.0};
+        /// Count of the samples in the current window.
+        std::size_t Count {0};
+        /// Start time of the current window.
+        std::chrono::steady_clock::time_point WindowStart {std::chrono::steady_clock::now()};
+
+    public:
+        /**
+         * @brief Bind the name and the window of this variable.
+         * @param name Name of the variable.
+         * @param window Length of a window.
+         * @param layout Layout of the published statistics.
+         */
+        AggregatedVariable(std::string name, std::chrono::steady_clock::duration window, OutputLayout layout) :
+            Name(std::move(name)), Window(window), Layout(layout)
+        {}
+
+        /// Record a sample into the current window, NaN and infinite samples are ignored.
+        void Record(double sample) noexcept
+        {
+            // They would poison the min, max and mean of the window, and can not be represented in JSON.
+            if (!std::isfinite(sample)) return;
+            while (Lock.test_and_set(std::memory_order_acquire));
+            Min = std::min(Min, sample);
+            Max = std::max(Max, sample);
+            Sum += sample;
+            Last = sample;
+            ++Count;
+            Lock.clear(std::memory_order_release);
+        }
+
+        /**
+         * @brief Finish the current window if it has elapsed.
+         * @param now Current time.
+         * @param summary Summary to store the statistics of the finished window.
+         * @retval true The window has elapsed and it contains samples.
+         * @retval false The window has not elapsed or it is empty.
+         */
+        bool Collect(std::chrono::steady_clock::time_point now, Summary& summary) noexcept
+        {
+            while (Lock.test_and_set(std::memory_order_acquire));
+            if (now - WindowStart < Window)
+            {
+                Lock.clear(std::memory_order_release);
+                return false;
+            }
+            if (Count == 0)
+            {
+                // Start a new window, otherwise the next sample would be published alone at once.
+                WindowStart = now;
+                Lock.clear(std::memory_order_release);
+                return false;
+            }
+            summary.Min = Min;
+            summary.Max = Max;
+            summary.Mean = Sum / static_cast<double>(Count);
+            summary.Last = Last;
+            summary.Count = Count;
+            Min = std::numeric_limits<double>::max();
+            Max = std::numeric_limits<double>::lowest();
+            Sum = 0.0;
+            Count = 0;
+            WindowStart = now;
+            Lock.clear(std::memory_order_release);
+            return true;
+        }
+    };
+}
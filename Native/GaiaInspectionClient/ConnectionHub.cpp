@@ -0,0 +1,80 @@
+#include "ConnectionHub.hpp"
+#include "RedisBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /// Get the hub of this process.
+    ConnectionHub& ConnectionHub::GetInstance()
+    {
+        static ConnectionHub instance;
+        return instance;
+    }
+
+    /// Change the settings of the connections.
+    void ConnectionHub::Configure(const ConnectionSettings& settings)
+    {
+        std::unique_lock lock(Mutex);
+        Settings = settings;
+        if (Settings.PoolSize == 0) Settings.PoolSize = 1;
+    }
+
+    /// Get the settings of the connections.
+    ConnectionHub::ConnectionSettings ConnectionHub::GetSettings() const
+    {
+        std::unique_lock lock(Mutex);
+        return Settings;
+    }
+
+    /// Get the connection of an endpoint, or create one, with the mutex held.
+    std::shared_ptr<sw::redis::Redis> ConnectionHub::AcquireConnectionLocked(
+            Endpoint& endpoint, const std::string& ip, unsigned int port)
+    {
+        if (auto connection = endpoint.Connection.lock()) return connection;
+
+        sw::redis::ConnectionOptions connection_options;
+        connection_options.host = ip;
+        connection_options.port = static_cast<int>(port);
+        connection_options.connect_timeout = Settings.ConnectTimeout;
+        connection_options.socket_timeout = Settings.SocketTimeout;
+        sw::redis::ConnectionPoolOptions pool_options;
+        pool_options.size = Settings.PoolSize;
+        pool_options.wait_timeout = Settings.WaitTimeout;
+
+        auto connection = std::make_shared<sw::redis::Redis>(connection_options, pool_options);
+        endpoint.Connection = connection;
+        return connection;
+    }
+
+    /// Get the shared connection to a Redis server, it will be created if there is none.
+    std::shared_ptr<sw::redis::Redis> ConnectionHub::AcquireConnection(const std::string& ip, unsigned int port)
+    {
+        std::unique_lock lock(Mutex);
+        return AcquireConnectionLocked(Endpoints[ip + ":" + std::to_string(port)], ip, port);
+    }
+
+    /// Get the shared backend of a Redis server, it will be created if there is none.
+    std::shared_ptr<StorageBackend> ConnectionHub::AcquireBackend(const std::string& ip, unsigned int port)
+    {
+        std::unique_lock lock(Mutex);
+        auto& endpoint = Endpoints[ip + ":" + std::to_string(port)];
+        if (auto backend = endpoint.Backend.lock()) return backend;
+
+        std::shared_ptr<StorageBackend> backend =
+                std::make_shared<RedisBackend>(AcquireConnectionLocked(endpoint, ip, port));
+        if (Settings.Multiplexing) backend = std::make_shared<MultiplexedBackend>(std::move(backend));
+        endpoint.Backend = backend;
+        return backend;
+    }
+
+    /// Get the count of endpoints which have a connection in use.
+    std::size_t ConnectionHub::GetConnectionsCount() const
+    {
+        std::unique_lock lock(Mutex);
+        std::size_t count = 0;
+        for (const auto& [address, endpoint] : Endpoints)
+        {
+            if (!endpoint.Connection.expired()) ++count;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sw/redis++/redis++.h>
+#include "StorageBackend.hpp"
+#include "MultiplexedBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Process-wide registry of connections, which shares one pooled connection per Redis endpoint.
+     * @details
+     *  Clients and readers constructed with an address acquire their connections here, so the count of
+     *  connections of a process depends on the pool size instead of the count of instrumented modules.
+     *  Clients of the same endpoint also share one MultiplexedBackend, which merges their concurrent flushes.
+     *  Endpoints are held weakly, so their connections are closed after the last user is destroyed.
+     */
+    class ConnectionHub
+    {
+    public:
+        /// Settings of the connections created by the hub.
+        struct ConnectionSettings
+        {
+            /// Count of connections in the pool of each endpoint.
+            std::size_t PoolSize {4};
+            /// Timeout of establishing a connection.
+            std::chrono::milliseconds ConnectTimeout {1000};
+            /// Timeout of socket reads and writes, zero means no timeout.
+            std::chrono::milliseconds SocketTimeout {0};
+            /// Timeout of waiting for an idle connection in the pool, zero means waiting forever.
+            std::chrono::milliseconds WaitTimeout {0};
+            /// Whether clients of the same endpoint merge their flushes into common pipelines.
+            bool Multiplexing {true};
+        };
+
+    private:
+        /// Shared objects of an endpoint, held weakly.
+        struct Endpoint
+        {
+            std::weak_ptr<sw::redis::Redis> Connection;
+            std::weak_ptr<StorageBackend> Backend;
+        };
+
+        /// Mutex for the settings and the endpoints.
+        mutable std::mutex Mutex;
+        /// Settings of the connections to create.
+        ConnectionSettings Settings;
+        /// Endpoints indexed by "<ip>:<port>".
+        std::unordered_map<std::string, Endpoint> Endpoints;
+
+        ConnectionHub() = default;
+
+        /// Get the connection of an endpoint, or create one, with the mutex held.
+        std::shared_ptr<sw::redis::Redis> AcquireConnectionLocked(Endpoint& endpoint, const std::string& ip,
+                                                                  unsigned int port);
+
+    public:
+        ConnectionHub(const ConnectionHub&) = delete;
+        ConnectionHub& operator=(const ConnectionHub&) = delete;
+
+        /// Get the hub of this process.
+        static ConnectionHub& GetInstance();
+
+        /**
+         * @brief Change the settings of the connections.
+         * @param settings Settings to use.
+         * @details Only connections created afterwards use the new settings, shared ones are kept.
+         */
+        void Configure(const ConnectionSettings& settings);
+
+        /// Get the settings of the connections.
+        [[nodiscard]] ConnectionSettings GetSettings() const;
+
+        /**
+         * @brief Get the shared connection to a Redis server, it will be created if there is none.
+         * @param ip IP address of the Redis server.
+         * @param port Port of the Redis server.
+         * @return Connection with a pool of the configured size.
+         */
+        std::shared_ptr<sw::redis::Redis> AcquireConnection(const std::string& ip = "127.0.0.1",
+                                                            unsigned int port = 6379);
+
+        /**
+         * @brief Get the shared backend of a Redis server, it will be created if there is none.
+         * @param ip IP address of the Redis server.
+         * @param port Port of the Redis server.
+         * @return Multiplexed backend on the shared connection, or a plain Redis backend if multiplexing is off.
+         */
+        std::shared_ptr<StorageBackend> AcquireBackend(const std::string& ip = "127.0.0.1",
+                                                       unsigned int port = 6379);
+
+        /// Get the count of endpoints which have a connection in use.
+        [[nodiscard]] std::size_t GetConnectionsCount() const;
+    };
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <array>
+#include <charconv>
+#include <type_traits>
+
+namespace Gaia::InspectionService
+{
+    /// Size of the buffer which is enough to hold the text of any arithmetic value.
+    constexpr std::size_t ValueTextBufferSize = 64;
+
+    /**
+     * @brief Format an arithmetic value into the given buffer without allocation.
+     * @tparam ValueType Arithmetic type of the value.
+     * @param value Value to format.
+     * @param buffer Buffer to write the text into.
+     * @return View of the text in the buffer.
+     * @details
+     *  Booleans are formatted into "1" and "0", the same as std::to_string(...);
+     *  floating point values are formatted into the shortest text which can be parsed back losslessly.
+     */
+    template <typename ValueType>
+    std::string_view FormatValue(ValueType value, std::array<char, ValueTextBufferSize>& buffer) noexcept
+    {
+        static_assert(std::is_arithmetic_v<ValueType>, "Only arithmetic values can be formatted.");
+        if constexpr (std::is_same_v<ValueType, bool>)
+        {
+            return value ? "1" : "0";
+        }
+        else
+        {
+            auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            return {buffer.data(), static_cast<std::size_t>(end - buffer.data())};
+        }
+    }
+
+    /**
+     * @brief Base of typed variables registered to the inspection client.
+     */
+    class InspectedVariableBase
+    {
+    public:
+        /// Name of the variable.
+        const std::string Name;
+        /// Precomputed key of the variable in Redis.
+        const std::string Key;
+
+        /**
+         * @brief Bind the name and the key of this variable.
+         * @param name Name of the variable.
+         * @param key Key of the variable in Redis.
+         */
+        InspectedVariableBase(std::string name, std::string key) :
+            Name(std::move(name)), Key(std::move(key))
+        {}
+
+        virtual ~InspectedVariableBase() = default;
+
+        /**
+         * @brief Collect the current value for publishing.
+         * @param force_mode If true, the value will be collected even if it has not changed.
+         * @return View of the formatted text, or an empty view if the value has not changed.
+         * @details
+         *  Change detection compares the raw values, so unchanged values will not be formatted.
+         *  The returned view stays valid until the next call of this function.
+         */
+        virtual std::string_view Collect(bool force_mode) = 0;
+
+        /// Mark the last collected value as published.
+        virtual void Commit() noexcept = 0;
+    };
+
+    /**
+     * @brief Typed handle of a variable registered to the inspection client.
+     * @tparam ValueType Arithmetic type of the value.
+     * @details
+     *  Setting the value only stores it into an atomic cell, it will be sent to Redis in the next Update().
+     *  Collect() and Commit() should only be called by the update cycle of the client.
+     */
+    template <typename ValueType>
+    class InspectedVariable : public InspectedVariableBase
+    {
+        static_assert(std::is_arithmetic_v<ValueType>, "Only arithmetic values can be inspected.");
+
+    private:
+        /// Latest value set by the user.
+        std::atomic<ValueType> Value {};
+        /// Value collected in the current update cycle.
+        ValueType CollectedValue {};
+        /// Value which has been sent to Redis.
+        ValueType PublishedValue {};
+        /// Whether any value has been sent to Redis.
+        bool Published {false};
+        /// Reused buffer for formatting.
+        std::array<char, ValueTextBufferSize> Buffer {};
+
+    public:
+        using InspectedVariableBase::InspectedVariableBase;
+
+        /// Set the value of this variable.
+        void Set(ValueType value) noexcept
+        {
+            Value.store(value, std::memory_order_relaxed);
+        }
+
+        /// Get the latest value of this variable.
+        [[nodiscard]] ValueType Get() const noexcept
+        {
+            return Value.load(std::memory_order_relaxed);
+        }
+
+        /// Set the value of this variable.
+        InspectedVariable& operator=(ValueType value) noexcept
+        {
+            Set(value);
+            return *this;
+        }
+
+        /// Collect the current value for publishing.
+        std::string_view Collect(bool force_mode) override
+        {
+            CollectedValue = Value.load(std::memory_order_relaxed);
+            if (!force_mode && Published && CollectedValue == PublishedValue)
+            {
+                return {};
+            }
+            return FormatValue(CollectedValue, Buffer);
+        }
+
+        /// Mark the last collected value as published.
+        void Commit() noexcept override
+        {
+            PublishedValue = CollectedValue;
+            Published = true;
+        }
+    };
+}
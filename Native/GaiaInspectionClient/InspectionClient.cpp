@@ -1,117 +1,1197 @@
 #include "InspectionClient.hpp"
 
 #include <utility>
+#include <algorithm>
+#include <cmath>
 
 namespace Gaia::InspectionService
 {
-    /// Establish a connection to the Redis server and bind the given name.
+    namespace
+    {
+        /// Append a variable name to a notification message, with its backslashes and line feeds escaped.
+        void AppendNotificationName(std::string& message, std::string_view name)
+        {
+            for (auto character : name)
+            {
+                switch (character)
+                {
+                    case '\\': message.append("\\\\"); break;
+                    case '\n': message.append("\\n"); break;
+                    default: message.push_back(character); break;
+                }
+            }
+        }
+    }
+
+    /// Share the connection of this process to the Redis server and bind the given name.
     InspectionClient::InspectionClient(const std::string &unit_name, unsigned int port, const std::string &ip) :
-        InspectionClient(unit_name, std::make_shared<sw::redis::Redis>("tcp://" + ip + ":" + std::to_string(port)))
+        InspectionClient(unit_name, ConnectionHub::GetInstance().AcquireBackend(ip, port))
     {}
 
     /// Reuse the connection to a Redis server and bind the given unit name.
     InspectionClient::InspectionClient(const std::string& unit_name,
                                        std::shared_ptr<sw::redis::Redis> connection) :
-        UnitName(unit_name), Connection(std::move(connection)),
-        VariableNamePrefix("inspections/" + unit_name + "/")
-    {
-        if (!Connection) throw std::runtime_error("Connection to Redis is null.");
+        InspectionClient(unit_name, std::make_shared<RedisBackend>(std::move(connection)))
+    {}
 
-        Connection->sadd("inspections", UnitName);
+    /// Reuse the connection to a Redis Cluster and bind the given unit name.
+    InspectionClient::InspectionClient(const std::string& unit_name,
+                                       std::shared_ptr<sw::redis::RedisCluster> connection) :
+        InspectionClient(unit_name, std::make_shared<RedisClusterBackend>(std::move(connection)))
+    {}
+
+    /// Store the variables in the given backend and bind the given unit name.
+    InspectionClient::InspectionClient(const std::string& unit_name, std::shared_ptr<StorageBackend> backend) :
+        InspectionClient(unit_name, MakeUnitTag(unit_name, backend.get()), backend)
+    {}
+
+    /// Store the variables in the given backend with keys named after the given unit tag.
+    InspectionClient::InspectionClient(const std::string& unit_name, const std::string& unit_tag,
+                                       std::shared_ptr<StorageBackend> backend) :
+        UnitName(unit_name), Backend(std::make_shared<InstrumentedBackend>(std::move(backend), Counters)),
+        VariableNamePrefix("inspections/" + unit_tag + "/"), VariableIndexKey("inspections/" + unit_tag),
+        ValueHashKey("inspection_values/" + unit_tag),
+        NotificationChannel("inspection_changes/" + unit_tag),
+        HistoryKeyPrefix("inspection_history/" + unit_tag + "/"),
+        GenerationKey("inspection_generation/" + unit_tag),
+        ChangeLogKey("inspection_changelog/" + unit_tag)
+    {
+        Backend->AddMember("inspections", UnitName);
     }
 
+    /// Names of the reserved variables which hold the performance counters.
+    const std::vector<std::string> InspectionClient::CounterVariableNames {
+        "_client/commands", "_client/bytes_sent", "_client/sent", "_client/skipped", "_client/stale",
+        "_client/flushes", "_client/errors", "_client/flush_p50_us", "_client/flush_p99_us",
+        "_client/flush_max_us", "_client/probe_p50_us", "_client/probe_p99_us", "_client/history_rejected"
+    };
+
     /// Destructor which will remove the keys of the registered variables.
     InspectionClient::~InspectionClient()
     {
-        for (const auto& [name, probe_information] : Probes)
+        StopScheduler();
+        StopAsyncMode();
+        // Values pushed by producers racing with a previous StopAsyncMode(), before the keys are removed.
+        DrainPublishQueue();
+        auto batch = Backend->CreateBatch();
+        std::vector<std::string> removed_names;
+        for (const auto& [name, information] : *std::atomic_load(&Probes))
         {
-            Connection->del(VariableNamePrefix + name);
+            batch->Delete(VariableNamePrefix + name);
+            removed_names.push_back(name);
         }
-        Connection->del("inspections/" + UnitName);
-        Connection->srem("inspections", UnitName);
+        for (const auto& [name, variable] : *std::atomic_load(&Variables))
+        {
+            batch->Delete(variable->Key);
+            removed_names.push_back(name);
+        }
+        for (const auto& [name, variable] : *std::atomic_load(&Aggregations))
+        {
+            removed_names.push_back(name);
+            if (variable->Layout == AggregatedVariable::OutputLayout::Structured)
+            {
+                batch->Delete(VariableNamePrefix + name);
+                continue;
+            }
+            for (const auto* suffix : {"/min", "/max", "/mean", "/last", "/count"})
+            {
+                batch->Delete(VariableNamePrefix + name + suffix);
+            }
+        }
+        for (const auto& [name, retention] : HistorySettings)
+        {
+            batch->Delete(HistoryKeyPrefix + name);
+        }
+        if (CounterPublishInterval.load(std::memory_order_relaxed) > std::chrono::steady_clock::duration::zero())
+        {
+            for (const auto& name : CounterVariableNames)
+            {
+                batch->Delete(VariableNamePrefix + name);
+            }
+        }
+        batch->Delete(ValueHashKey);
+        // The generation is kept so it keeps increasing when the client restarts, and the removed variables are
+        // stamped as changed, so readers polling the change log see them gone. The change log holds one entry
+        // per variable name, so it does not grow across restarts.
+        if (ChangeTracking.load(std::memory_order_relaxed) && !removed_names.empty())
+        {
+            batch->StampChanges(GenerationKey, ChangeLogKey, removed_names);
+        }
+        batch->Delete(VariableIndexKey);
+        batch->RemoveMember("inspections", UnitName);
+        batch->Execute();
     }
 
     /// Add a variable probe into the update list.
     void InspectionClient::AddProbe(const std::string &name, InspectionClient::InspectionProbe probe)
     {
-        std::unique_lock lock(ProbesMutex);
-        Probes[name] = std::make_tuple(std::move(probe), "");
-        Connection->sadd("inspections/" + UnitName, name);
+        AddProbe(name, std::move(probe), std::chrono::steady_clock::duration::zero());
+    }
+
+    /// Add a variable probe which will be updated by the scheduler with the given interval.
+    void InspectionClient::AddProbe(const std::string &name, InspectionProbe probe,
+                                    std::chrono::steady_clock::duration interval)
+    {
+        auto serial = NextScheduleSerial++;
+        auto information = std::make_shared<ProbeInformation>(std::move(probe), interval, serial);
+        ModifyRegistry(ProbesMutex, Probes, [&name, &information](ProbeRegistry& probes){
+            probes[name] = std::move(information);
+        });
+        Backend->AddMember(VariableIndexKey, name);
+        if (interval > std::chrono::steady_clock::duration::zero())
+        {
+            std::unique_lock lock(SchedulerMutex);
+            if (SchedulerRunning) ScheduleProbe(name, interval, serial);
+        }
     }
 
     /// Remove a variable probe from the update list.
     void InspectionClient::RemoveProbe(const std::string &name)
     {
-        std::unique_lock lock(ProbesMutex);
-        auto finder = Probes.find(name);
-        if (finder != Probes.end())
+        bool removed = false;
+        ModifyRegistry(ProbesMutex, Probes, [&name, &removed](ProbeRegistry& probes){
+            removed = probes.erase(name) > 0;
+        });
+        if (removed)
         {
-            Probes.erase(finder);
-            Connection->sadd("inspections/" + UnitName, name);
+            Backend->RemoveMember(VariableIndexKey, name);
         }
     }
 
     /// Update the probe with the given name.
     void InspectionClient::UpdateProbe(const std::string &name, bool force_mode)
     {
-        std::shared_lock lock(ProbesMutex);
-        auto finder = Probes.find(name);
-        if (finder == Probes.end()) return;
-        const auto& [probe, last_value] = finder->second;
-        if (probe)
+        UpdateProbes({name}, force_mode);
+    }
+
+    /// Update the value of a inspected value.
+    void InspectionClient::UpdateValue(const std::string &name, const std::string& value)
+    {
+        if (RateLimitEnabled.load(std::memory_order_relaxed) &&
+            !AcquirePublish(name, std::chrono::steady_clock::now(), &value))
+        {
+            return;
+        }
+        if (PublisherRunning.load(std::memory_order_acquire))
         {
-            auto new_value = probe();
-            if (!force_mode && new_value == last_value)
+            PendingValue pending_value{name, value};
+            if (PublisherQueue->TryPush(std::move(pending_value)))
             {
+                // StopAsyncMode() may have done its final drain between the check above and the push,
+                // then this value must be drained here, or it stays in the queue until the next drain.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!PublisherRunning.load(std::memory_order_relaxed)) DrainPublishQueue();
                 return;
             }
-            std::get<1>(finder->second) = new_value;
-            Connection->set(VariableNamePrefix + name, new_value);
+            // The queue is full: drain it here with this value as the latest one,
+            // so older values of the same variable still in the queue can not overwrite it.
+            DrainPublishQueue(&pending_value);
+            return;
         }
+        auto batch = CreateBatch();
+        QueueValue(*batch, name, VariableNamePrefix + name, value);
+        batch->AddMember(VariableIndexKey, name);
+        batch->Execute();
+        Counters->SentValues.fetch_add(1, std::memory_order_relaxed);
+        InvalidateProbe(name);
     }
 
-    /// Update the value of a inspected value.
-    void InspectionClient::UpdateValue(const std::string &name, const std::string& value)
+    /// Mark the last-value cache of the probe with the given name invalid, if the probe exists.
+    void InspectionClient::InvalidateProbe(const std::string &name)
+    {
+        auto probes = std::atomic_load(&Probes);
+        auto finder = probes->find(name);
+        if (finder != probes->end())
+        {
+            finder->second->Invalidated.store(true, std::memory_order_release);
+        }
+    }
+
+    /// Claim the given probes and remove the ones which are owned by other cycles, along with their names.
+    InspectionClient::ProbeClaim::ProbeClaim(std::vector<ProbeInformation*>& probes,
+                                             std::vector<const std::string*>& names)
     {
-        Connection->set(VariableNamePrefix + name, value);
-        Connection->sadd("inspections/" + UnitName, name);
-        std::shared_lock lock(ProbesMutex);
-        auto finder = Probes.find(name);
-        if (finder != Probes.end())
+        Claimed.reserve(probes.size());
+        std::size_t kept_count = 0;
+        for (std::size_t index = 0; index < probes.size(); ++index)
         {
-            std::get<1>(finder->second) = value;
+            if (probes[index]->Updating.test_and_set(std::memory_order_acquire)) continue;
+            Claimed.push_back(probes[index]);
+            probes[kept_count] = probes[index];
+            names[kept_count] = names[index];
+            ++kept_count;
+        }
+        probes.resize(kept_count);
+        names.resize(kept_count);
+    }
+
+    /// Release the claimed probes.
+    InspectionClient::ProbeClaim::~ProbeClaim()
+    {
+        for (auto* information : Claimed)
+        {
+            information->Updating.clear(std::memory_order_release);
         }
     }
 
     /// Delete the key of the variable with the given name from the Redis, and remove the probe for this variable.
     void InspectionClient::RemoveValue(const std::string &name)
     {
-        Connection->del(VariableNamePrefix + name);
-        Connection->srem("inspections/" + UnitName, name);
-        std::unique_lock lock(ProbesMutex);
-        auto finder = Probes.find(name);
-        if (finder != Probes.end())
+        // Pending values should be sent before the deletion, otherwise the key may be brought back.
+        if (PublisherRunning.load(std::memory_order_acquire))
         {
-            Probes.erase(finder);
+            DrainPublishQueue();
         }
+        DisableHistory(name, true);
+        auto batch = CreateBatch();
+        QueueRemoval(*batch, name);
+        batch->RemoveMember(VariableIndexKey, name);
+        // Aggregations with the siblings layout are stored as one variable per statistic.
+        auto aggregations = std::atomic_load(&Aggregations);
+        auto aggregation_finder = aggregations->find(name);
+        if (aggregation_finder != aggregations->end() &&
+            aggregation_finder->second->Layout == AggregatedVariable::OutputLayout::Siblings)
+        {
+            for (const auto* suffix : {"/min", "/max", "/mean", "/last", "/count"})
+            {
+                auto sibling_name = name + suffix;
+                QueueRemoval(*batch, sibling_name);
+                batch->RemoveMember(VariableIndexKey, sibling_name);
+            }
+        }
+        batch->Execute();
+        ModifyRegistry(ProbesMutex, Probes, [&name](ProbeRegistry& probes){
+            probes.erase(name);
+        });
+        ModifyRegistry(VariablesMutex, Variables, [&name](VariableRegistry& variables){
+            variables.erase(name);
+        });
+        ModifyRegistry(VariablesMutex, Aggregations, [&name](AggregationRegistry& aggregations){
+            aggregations.erase(name);
+        });
+        SetRateLimit(name, std::chrono::steady_clock::duration::zero());
     }
 
-    /// Update all probes.
-    void InspectionClient::Update(bool force_mode)
+    /// Queue the write of a variable value into the batch according to the storage layout,
+    /// and the change notification if it is enabled.
+    void InspectionClient::QueueValue(StorageBatch& batch, std::string_view name,
+                                      std::string_view key, std::string_view value)
     {
-        std::shared_lock lock(ProbesMutex);
+        RecordChange(batch, name);
+        if (Layout != StorageLayout::Hash)
+        {
+            batch.Set(key, value);
+        }
+        if (Layout != StorageLayout::Keys)
+        {
+            batch.HashSet(ValueHashKey, name, value);
+        }
+        QueueHistory(batch, name, value);
+        RecordRegionWrite(batch, name, value);
+        if (Notification)
+        {
+            std::string message;
+            message.reserve(name.size() + 1 + value.size());
+            AppendNotificationName(message, name);
+            message.append(1, '\n').append(value);
+            batch.Publish(NotificationChannel, message);
+        }
+    }
 
-        for (auto& [name, probe_information] : Probes)
+    /// Queue the removal of a variable value into the batch according to the storage layout,
+    /// and the change notification if it is enabled.
+    void InspectionClient::QueueRemoval(StorageBatch& batch, const std::string& name)
+    {
+        RecordChange(batch, name);
+        if (Layout != StorageLayout::Hash)
+        {
+            batch.Delete(VariableNamePrefix + name);
+        }
+        if (Layout != StorageLayout::Keys)
+        {
+            batch.HashDelete(ValueHashKey, name);
+        }
+        RecordRegionWrite(batch, name, std::nullopt);
+        if (Notification)
         {
-            const auto& [probe, last_value] = probe_information;
-            if (!probe) continue;
-            const auto& new_value = probe();
-            if (!force_mode && new_value == last_value)
+            std::string message;
+            AppendNotificationName(message, name);
+            batch.Publish(NotificationChannel, message);
+        }
+    }
+
+    /// Create a batch, which tracks the changed variables and the region writes if they are enabled.
+    std::unique_ptr<StorageBatch> InspectionClient::CreateBatch()
+    {
+        auto region = std::atomic_load(&Region);
+        if (!ChangeTracking.load(std::memory_order_relaxed) && !region) return Backend->CreateBatch();
+        return std::make_unique<TrackedBatch>(*this, Backend->CreateBatch(), std::move(region));
+    }
+
+    /// Get the given batch, it will be created on the first use.
+    StorageBatch& InspectionClient::GetBatch(std::unique_ptr<StorageBatch>& batch)
+    {
+        if (!batch) batch = CreateBatch();
+        return *batch;
+    }
+
+    /// Record the write of a variable into the shared memory region, which is done after the batch is executed.
+    void InspectionClient::RecordRegionWrite(StorageBatch& batch, std::string_view name,
+                                             std::optional<std::string_view> value)
+    {
+        auto* tracked_batch = dynamic_cast<TrackedBatch*>(&batch);
+        if (!tracked_batch || !tracked_batch->Region) return;
+        tracked_batch->RegionValues.emplace_back(
+                std::string(name), value ? std::optional<std::string>(std::string(*value)) : std::nullopt);
+    }
+
+    /// Record the change of a variable into the batch, if it tracks changes.
+    void InspectionClient::RecordChange(StorageBatch &batch, std::string_view name)
+    {
+        if (!ChangeTracking.load(std::memory_order_relaxed)) return;
+        // Batches created before the change tracking was enabled are not tracked.
+        if (auto* tracked_batch = dynamic_cast<TrackedBatch*>(&batch))
+        {
+            tracked_batch->ChangedNames.emplace_back(name);
+        }
+    }
+
+    /// Stamp the changed variables with a new generation, execute the inner batch, then write the region.
+    std::size_t InspectionClient::TrackedBatch::Execute()
+    {
+        if (!ChangedNames.empty())
+        {
+            // Stamped after the writes of the batch, so a reader which sees the generation also sees the values.
+            Inner->StampChanges(Client.GenerationKey, Client.ChangeLogKey, ChangedNames);
+            ChangedNames.clear();
+        }
+        auto rejected_count = Inner->Execute();
+        if (!Region) return rejected_count;
+
+        // Not reached if the execution failed, so the region never holds values missing from the backend.
+        // Concurrent batches may return in any order, so the serial is taken after the execution returns,
+        // and the region keeps the value of the batch which returned last, like the backend mostly does.
+        auto serial = Client.RegionSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+        for (const auto& [name, value] : RegionValues)
+        {
+            if (value)
             {
+                Region->Write(name, *value, serial);
+            }
+            else
+            {
+                Region->Remove(name, serial);
+            }
+        }
+        RegionValues.clear();
+        Region->Touch();
+        return rejected_count;
+    }
+
+    /// Enable or disable the change tracking.
+    void InspectionClient::SetChangeTracking(bool enable)
+    {
+        ChangeTracking.store(enable, std::memory_order_relaxed);
+    }
+
+    /// Queue the append of a value into the history stream of the variable, if its history is enabled.
+    void InspectionClient::QueueHistory(StorageBatch& batch, std::string_view name, std::string_view value)
+    {
+        if (!HistoryEnabled.load(std::memory_order_relaxed)) return;
+
+        std::shared_lock lock(HistoryMutex);
+        auto finder = HistorySettings.find(std::string(name));
+        if (finder == HistorySettings.end()) return;
+        const auto& retention = finder->second;
+
+        auto key = HistoryKeyPrefix;
+        key.append(name);
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        auto timestamp = std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+        // Entries are identified by their source time, so readers can query them by the time they are written.
+        auto id = TimedHistoryIDs.value_or(false) ?
+                std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(now).count()) + "-*" :
+                std::string("*");
+        std::string min_id;
+        if (retention.MaxAge.count() > 0)
+        {
+            min_id = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(now - retention.MaxAge)
+                    .count());
+        }
+        batch.AppendStream(key, id, value, timestamp, retention.MaxLength, min_id);
+    }
+
+    /// Mirror the written values into a shared memory region for readers on the same host.
+    void InspectionClient::EnableSharedMemory(std::size_t slots_count, std::size_t value_capacity)
+    {
+        std::shared_ptr<SharedMemoryRegion> region = SharedMemoryRegion::Create(UnitName, slots_count, value_capacity);
+        std::atomic_store(&Region, std::move(region));
+    }
+
+    /// Refresh the heartbeat of the shared memory region if it is enabled, so readers know this client is alive.
+    void InspectionClient::TouchRegion()
+    {
+        if (auto region = std::atomic_load(&Region))
+        {
+            region->Touch();
+        }
+    }
+
+    /// Stop mirroring values into the shared memory region, and remove the region.
+    void InspectionClient::DisableSharedMemory()
+    {
+        std::atomic_store(&Region, std::shared_ptr<SharedMemoryRegion>());
+    }
+
+    /// Record the history of the variable with the given name.
+    void InspectionClient::EnableHistory(const std::string &name, HistoryRetention retention)
+    {
+        std::unique_lock lock(HistoryMutex);
+        if (!TimedHistoryIDs)
+        {
+            TimedHistoryIDs = Backend->SupportsTimedStreamIDs();
+        }
+        HistorySettings[name] = retention;
+        HistoryEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    /// Stop recording the history of the variable with the given name.
+    void InspectionClient::DisableHistory(const std::string &name, bool remove_history)
+    {
+        std::unique_lock lock(HistoryMutex);
+        if (HistorySettings.erase(name) == 0) return;
+        HistoryEnabled.store(!HistorySettings.empty(), std::memory_order_relaxed);
+        lock.unlock();
+        if (remove_history)
+        {
+            Backend->Delete(HistoryKeyPrefix + name);
+        }
+    }
+
+    /// Add a typed variable into the update list.
+    void InspectionClient::AddVariable(std::shared_ptr<InspectedVariableBase> variable)
+    {
+        Backend->AddMember(VariableIndexKey, variable->Name);
+        ModifyRegistry(VariablesMutex, Variables, [&variable](VariableRegistry& variables){
+            auto name = variable->Name;
+            variables[name] = std::move(variable);
+        });
+    }
+
+    /// Register a high-frequency variable, whose samples are aggregated and published per window.
+    std::shared_ptr<AggregatedVariable> InspectionClient::Aggregate(
+            const std::string &name, std::chrono::steady_clock::duration window,
+            AggregatedVariable::OutputLayout layout)
+    {
+        auto variable = std::make_shared<AggregatedVariable>(name, window, layout);
+        if (layout == AggregatedVariable::OutputLayout::Siblings)
+        {
+            std::vector<std::string> names {name + "/min", name + "/max", name + "/mean",
+                                            name + "/last", name + "/count"};
+            Backend->AddMembers(VariableIndexKey, names);
+        }
+        else
+        {
+            Backend->AddMember(VariableIndexKey, name);
+        }
+        ModifyRegistry(VariablesMutex, Aggregations, [&name, &variable](AggregationRegistry& aggregations){
+            aggregations[name] = variable;
+        });
+        return variable;
+    }
+
+    /// Queue the statistics of a finished window into the batch.
+    void InspectionClient::QueueSummary(StorageBatch& batch, const AggregatedVariable& variable,
+                                        const AggregatedVariable::Summary& summary)
+    {
+        std::array<char, ValueTextBufferSize> buffer {};
+        if (variable.Layout == AggregatedVariable::OutputLayout::Siblings)
+        {
+            auto queue_sibling = [&](const char* suffix, auto value){
+                auto name = variable.Name + suffix;
+                QueueValue(batch, name, VariableNamePrefix + name, FormatValue(value, buffer));
+            };
+            queue_sibling("/min", summary.Min);
+            queue_sibling("/max", summary.Max);
+            queue_sibling("/mean", summary.Mean);
+            queue_sibling("/last", summary.Last);
+            queue_sibling("/count", summary.Count);
+            return;
+        }
+        // The mean may still overflow to infinity, which JSON can not represent.
+        auto format_number = [&buffer](double value) -> std::string_view {
+            return std::isfinite(value) ? FormatValue(value, buffer) : "null";
+        };
+        std::string text;
+        text.reserve(128);
+        text.append("{\"min\":").append(format_number(summary.Min));
+        text.append(",\"max\":").append(format_number(summary.Max));
+        text.append(",\"mean\":").append(format_number(summary.Mean));
+        text.append(",\"last\":").append(format_number(summary.Last));
+        text.append(",\"count\":").append(FormatValue(summary.Count, buffer));
+        text.append("}");
+        QueueValue(batch, variable.Name, VariableNamePrefix + variable.Name, text);
+    }
+
+    /// Limit the publish rate of a variable.
+    void InspectionClient::SetRateLimit(const std::string &name, std::chrono::steady_clock::duration min_interval)
+    {
+        std::unique_lock lock(RateLimitsMutex);
+        if (min_interval <= std::chrono::steady_clock::duration::zero())
+        {
+            RateLimits.erase(name);
+        }
+        else
+        {
+            RateLimits[name].Interval = min_interval;
+        }
+        RateLimitEnabled.store(!RateLimits.empty(), std::memory_order_relaxed);
+    }
+
+    /// Check whether the variable can be published now according to its rate limit.
+    bool InspectionClient::AcquirePublish(const std::string &name, std::chrono::steady_clock::time_point now,
+                                          const std::string *value)
+    {
+        std::unique_lock lock(RateLimitsMutex);
+        auto finder = RateLimits.find(name);
+        if (finder == RateLimits.end()) return true;
+        auto& limit = finder->second;
+        if (now - limit.LastPublishTime < limit.Interval)
+        {
+            if (value) limit.PendingValue = *value;
+            return false;
+        }
+        limit.LastPublishTime = now;
+        limit.PendingValue.reset();
+        return true;
+    }
+
+    /// Queue the values held back by rate limits whose interval has elapsed.
+    std::size_t InspectionClient::QueuePendingValues(std::unique_ptr<StorageBatch>& batch,
+                                                     std::chrono::steady_clock::time_point now)
+    {
+        std::size_t count = 0;
+        std::unique_lock lock(RateLimitsMutex);
+        for (auto& [name, limit] : RateLimits)
+        {
+            if (!limit.PendingValue || now - limit.LastPublishTime < limit.Interval) continue;
+            auto& pending_batch = GetBatch(batch);
+            QueueValue(pending_batch, name, VariableNamePrefix + name, *limit.PendingValue);
+            pending_batch.AddMember(VariableIndexKey, name);
+            limit.PendingValue.reset();
+            limit.LastPublishTime = now;
+            ++count;
+        }
+        return count;
+    }
+
+    /// Enable the asynchronous mode, in which values are published by a background thread.
+    void InspectionClient::StartAsyncMode(std::size_t queue_capacity, std::chrono::microseconds interval)
+    {
+        std::unique_lock lock(PublisherMutex);
+        if (PublisherThread.joinable()) return;
+
+        // The queue is kept after the asynchronous mode is stopped,
+        // because producers may still be pushing into it while it is being stopped.
+        if (!PublisherQueue)
+        {
+            PublisherQueue = std::make_unique<PublishQueue<PendingValue>>(queue_capacity);
+        }
+        PublisherInterval = interval;
+        PublisherRunning.store(true, std::memory_order_release);
+        PublisherThread = std::thread([this]{
+            while (PublisherRunning.load(std::memory_order_acquire))
+            {
+                {
+                    std::unique_lock wait_lock(PublisherMutex);
+                    PublisherCondition.wait_for(wait_lock, PublisherInterval, [this]{
+                        return !PublisherRunning.load(std::memory_order_acquire);
+                    });
+                }
+                try
+                {
+                    DrainPublishQueue();
+                }
+                catch (const std::exception&)
+                {
+                    // Drained values are lost, the failure has been recorded into the error counter.
+                }
+            }
+        });
+    }
+
+    /// Disable the asynchronous mode, values still in the queue will be flushed.
+    void InspectionClient::StopAsyncMode()
+    {
+        {
+            std::unique_lock lock(PublisherMutex);
+            if (!PublisherThread.joinable()) return;
+            PublisherRunning.store(false, std::memory_order_release);
+        }
+        PublisherCondition.notify_all();
+        PublisherThread.join();
+        // Values pushed after the last drain of the background thread. Producers which pushed after this drain
+        // will observe the stopped state after their push, and drain the queue themselves.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        DrainPublishQueue();
+    }
+
+    /// Drain all values in the queue to Redis in one batch.
+    void InspectionClient::DrainPublishQueue(PendingValue* latest_value)
+    {
+        std::unique_lock lock(PublisherMutex);
+        if (!PublisherQueue) return;
+
+        std::unordered_map<std::string, std::string> coalesced_values;
+        PendingValue pending_value;
+        while (PublisherQueue->TryPop(pending_value))
+        {
+            coalesced_values[std::move(pending_value.Name)] = std::move(pending_value.Value);
+        }
+        if (latest_value)
+        {
+            coalesced_values[std::move(latest_value->Name)] = std::move(latest_value->Value);
+        }
+        if (coalesced_values.empty()) return;
+
+        auto batch = CreateBatch();
+        for (const auto& [name, value] : coalesced_values)
+        {
+            QueueValue(*batch, name, VariableNamePrefix + name, value);
+            batch->AddMember(VariableIndexKey, name);
+        }
+        batch->Execute();
+        Counters->SentValues.fetch_add(coalesced_values.size(), std::memory_order_relaxed);
+
+        for (const auto& [name, value] : coalesced_values)
+        {
+            InvalidateProbe(name);
+        }
+    }
+
+    /// Update all probes and typed variables.
+    InspectionClient::UpdateStatistics InspectionClient::Update(bool force_mode)
+    {
+        auto registry = std::atomic_load(&Probes);
+        auto variables = std::atomic_load(&Variables);
+        auto aggregations = std::atomic_load(&Aggregations);
+
+        UpdateStatistics statistics;
+        TouchRegion();
+        // Created by the first queued write, most cycles of a quiet process have nothing to send.
+        std::unique_ptr<StorageBatch> batch;
+        auto now = std::chrono::steady_clock::now();
+        bool rate_limited = RateLimitEnabled.load(std::memory_order_relaxed);
+
+        bool scheduled = SchedulerRunning.load(std::memory_order_relaxed);
+        std::vector<const std::string*> probe_names;
+        std::vector<ProbeInformation*> probes;
+        // Probes with intervals are skipped when the scheduler runs, then the registry size would overestimate.
+        if (!scheduled)
+        {
+            probe_names.reserve(registry->size());
+            probes.reserve(registry->size());
+        }
+        for (const auto& [name, information] : *registry)
+        {
+            if (!information->Probe) continue;
+            if (scheduled && information->Interval > std::chrono::steady_clock::duration::zero()) continue;
+            probe_names.push_back(&name);
+            probes.push_back(information.get());
+        }
+        // Probes being updated by another cycle are skipped, so their caches never have two writers.
+        auto candidates_count = probes.size();
+        ProbeClaim claim(probes, probe_names);
+        statistics.SkippedCount += candidates_count - probes.size();
+        auto new_values = EvaluateProbes(probes, statistics);
+
+        std::vector<std::pair<std::string*, std::string>> changed_probes;
+        std::vector<ProbeInformation*> invalidated_probes;
+        for (std::size_t index = 0; index < probes.size(); ++index)
+        {
+            auto& new_value = new_values[index];
+            if (!new_value) continue;
+            const auto& name = *probe_names[index];
+            auto& information = *probes[index];
+            bool invalidated = information.Invalidated.load(std::memory_order_acquire);
+            if ((!force_mode && !invalidated && *new_value == information.LastValue) ||
+                (rate_limited && !AcquirePublish(name, now)))
+            {
+                ++statistics.SkippedCount;
+                continue;
+            }
+            if (information.Invalidated.exchange(false, std::memory_order_acq_rel))
+            {
+                invalidated_probes.push_back(&information);
+            }
+            QueueValue(GetBatch(batch), name, VariableNamePrefix + name, *new_value);
+            changed_probes.emplace_back(&information.LastValue, std::move(*new_value));
+        }
+
+        // Typed variables are collected by one cycle at a time, the others leave them to the next cycle.
+        std::vector<InspectedVariableBase*> changed_variables;
+        std::unique_lock collection_lock(CollectionMutex, std::try_to_lock);
+        if (collection_lock)
+        {
+            for (const auto& [name, variable] : *variables)
+            {
+                auto text = variable->Collect(force_mode);
+                if (text.empty() || (rate_limited && !AcquirePublish(name, now)))
+                {
+                    ++statistics.SkippedCount;
+                    continue;
+                }
+                QueueValue(GetBatch(batch), variable->Name, variable->Key, text);
+                changed_variables.push_back(variable.get());
+            }
+        }
+
+        std::size_t aggregated_count = 0;
+        AggregatedVariable::Summary summary;
+        for (const auto& [name, variable] : *aggregations)
+        {
+            if (!variable->Collect(now, summary)) continue;
+            QueueSummary(GetBatch(batch), *variable, summary);
+            ++aggregated_count;
+        }
+
+        std::size_t pending_count = rate_limited ? QueuePendingValues(batch, now) : 0;
+
+        statistics.SentCount = changed_probes.size() + changed_variables.size() + aggregated_count + pending_count;
+        RecordStatistics(statistics);
+        QueueCounters(batch, now);
+        if (!batch) return statistics;
+        try
+        {
+            batch->Execute();
+        }
+        catch (...)
+        {
+            for (auto* information : invalidated_probes)
+            {
+                information->Invalidated.store(true, std::memory_order_release);
+            }
+            throw;
+        }
+        Counters->SentValues.fetch_add(statistics.SentCount, std::memory_order_relaxed);
+
+        // Cached values are only refreshed after the batch has been executed successfully.
+        for (auto& [last_value, new_value] : changed_probes)
+        {
+            *last_value = std::move(new_value);
+        }
+        for (auto* variable : changed_variables)
+        {
+            variable->Commit();
+        }
+        return statistics;
+    }
+
+    /// Update the probes with the given names in one batch.
+    InspectionClient::UpdateStatistics InspectionClient::UpdateProbes(const std::vector<std::string> &names,
+                                                                      bool force_mode)
+    {
+        auto registry = std::atomic_load(&Probes);
+
+        UpdateStatistics statistics;
+        auto batch = CreateBatch();
+        auto now = std::chrono::steady_clock::now();
+        bool rate_limited = RateLimitEnabled.load(std::memory_order_relaxed);
+
+        std::vector<const std::string*> probe_names;
+        std::vector<ProbeInformation*> probes;
+        for (const auto& name : names)
+        {
+            auto finder = registry->find(name);
+            if (finder == registry->end() || !finder->second->Probe) continue;
+            probe_names.push_back(&finder->first);
+            probes.push_back(finder->second.get());
+        }
+        auto candidates_count = probes.size();
+        ProbeClaim claim(probes, probe_names);
+        statistics.SkippedCount += candidates_count - probes.size();
+        auto new_values = EvaluateProbes(probes, statistics);
+
+        std::vector<std::pair<std::string*, std::string>> changed_probes;
+        std::vector<ProbeInformation*> invalidated_probes;
+        for (std::size_t index = 0; index < probes.size(); ++index)
+        {
+            auto& new_value = new_values[index];
+            if (!new_value) continue;
+            const auto& name = *probe_names[index];
+            auto& information = *probes[index];
+            bool invalidated = information.Invalidated.load(std::memory_order_acquire);
+            if ((!force_mode && !invalidated && *new_value == information.LastValue) ||
+                (rate_limited && !AcquirePublish(name, now)))
+            {
+                ++statistics.SkippedCount;
+                continue;
+            }
+            if (information.Invalidated.exchange(false, std::memory_order_acq_rel))
+            {
+                invalidated_probes.push_back(&information);
+            }
+            QueueValue(*batch, name, VariableNamePrefix + name, *new_value);
+            changed_probes.emplace_back(&information.LastValue, std::move(*new_value));
+        }
+
+        statistics.SentCount = changed_probes.size();
+        RecordStatistics(statistics);
+        if (statistics.SentCount == 0) return statistics;
+        try
+        {
+            batch->Execute();
+        }
+        catch (...)
+        {
+            for (auto* information : invalidated_probes)
+            {
+                information->Invalidated.store(true, std::memory_order_release);
+            }
+            throw;
+        }
+        Counters->SentValues.fetch_add(statistics.SentCount, std::memory_order_relaxed);
+
+        for (auto& [last_value, new_value] : changed_probes)
+        {
+            *last_value = std::move(new_value);
+        }
+        return statistics;
+    }
+
+    /// Evaluate probes in parallel on a worker pool, with a time budget for each probe.
+    void InspectionClient::SetEvaluationPool(std::size_t threads_count, std::chrono::steady_clock::duration budget)
+    {
+        EvaluationBudget.store(budget, std::memory_order_relaxed);
+        // Cycles which are using the previous pool keep it alive until they finish.
+        auto pool = std::atomic_load(&EvaluationPool);
+        if (threads_count == 0)
+        {
+            std::atomic_store(&EvaluationPool, std::shared_ptr<WorkerPool>());
+        }
+        else if (!pool || pool->GetThreadsCount() != threads_count)
+        {
+            std::atomic_store(&EvaluationPool, std::make_shared<WorkerPool>(threads_count));
+        }
+    }
+
+    /// Get the evaluation timings of all probes.
+    std::unordered_map<std::string, InspectionClient::ProbeTiming> InspectionClient::GetProbeTimings()
+    {
+        auto registry = std::atomic_load(&Probes);
+        std::unordered_map<std::string, ProbeTiming> timings;
+        timings.reserve(registry->size());
+        for (const auto& [name, information] : *registry)
+        {
+            const auto& status = *information->Status;
+            auto& timing = timings[name];
+            timing.LastDuration = std::chrono::nanoseconds(status.LastDuration.load(std::memory_order_relaxed));
+            timing.MaxDuration = std::chrono::nanoseconds(status.MaxDuration.load(std::memory_order_relaxed));
+            timing.TotalDuration = std::chrono::nanoseconds(status.TotalDuration.load(std::memory_order_relaxed));
+            timing.Evaluations = status.Evaluations.load(std::memory_order_relaxed);
+            timing.Overruns = status.Overruns.load(std::memory_order_relaxed);
+        }
+        return timings;
+    }
+
+    /// Evaluate the given probes, in the worker pool if it is enabled.
+    std::vector<std::optional<std::string>> InspectionClient::EvaluateProbes(
+            const std::vector<ProbeInformation*>& probes, UpdateStatistics& statistics)
+    {
+        std::vector<std::optional<std::string>> values(probes.size());
+
+        auto pool = std::atomic_load(&EvaluationPool);
+        if (!pool)
+        {
+            for (std::size_t index = 0; index < probes.size(); ++index)
+            {
+                auto start_time = std::chrono::steady_clock::now();
+                values[index] = probes[index]->Probe();
+                auto duration = std::chrono::steady_clock::now() - start_time;
+                probes[index]->Status->Record(duration);
+                Counters->ProbeEvaluation.Record(duration);
+            }
+            return values;
+        }
+
+        // Evaluations may outlive this cycle when they overrun, so their states are shared with the tasks.
+        enum class EvaluationState
+        {
+            Queued,
+            Running,
+            Finished,
+            Failed,
+            Cancelled
+        };
+        struct Evaluation
+        {
+            std::string Value;
+            std::atomic<EvaluationState> State {EvaluationState::Queued};
+            /// Time when the evaluation started, the budget of the probe is counted from it.
+            std::atomic<std::chrono::steady_clock::time_point> StartTime {};
+        };
+        struct Batch
+        {
+            std::mutex Mutex;
+            std::condition_variable Condition;
+            /// Count of evaluations which started or stopped, used to wake up the waiting cycle.
+            std::size_t Events {0};
+        };
+        auto batch = std::make_shared<Batch>();
+        std::vector<std::shared_ptr<Evaluation>> evaluations(probes.size());
+        const auto budget = EvaluationBudget.load(std::memory_order_relaxed);
+        const auto cycle_start_time = std::chrono::steady_clock::now();
+        std::size_t submitted_count = 0;
+
+        for (std::size_t index = 0; index < probes.size(); ++index)
+        {
+            auto& status = probes[index]->Status;
+            if (status->Running.exchange(true, std::memory_order_acq_rel))
+            {
+                status->Overruns.fetch_add(1, std::memory_order_relaxed);
+                ++statistics.StaleCount;
                 continue;
             }
-            std::get<1>(probe_information) = new_value;
-            Connection->set(VariableNamePrefix + name, new_value);
+            auto evaluation = std::make_shared<Evaluation>();
+            evaluations[index] = evaluation;
+            ++submitted_count;
+            pool->Submit([probe = probes[index]->Probe, status, evaluation, batch, counters = Counters]{
+                auto start_time = std::chrono::steady_clock::now();
+                evaluation->StartTime.store(start_time, std::memory_order_relaxed);
+                // A cancelled evaluation has already released the probe.
+                auto expected_state = EvaluationState::Queued;
+                if (!evaluation->State.compare_exchange_strong(expected_state, EvaluationState::Running,
+                                                               std::memory_order_acq_rel))
+                    return;
+                {
+                    std::unique_lock lock(batch->Mutex);
+                    ++batch->Events;
+                }
+                batch->Condition.notify_one();
+                auto state = EvaluationState::Finished;
+                try
+                {
+                    evaluation->Value = probe();
+                }
+                catch (...)
+                {
+                    // A failed probe is treated as an overrun one.
+                    state = EvaluationState::Failed;
+                }
+                auto duration = std::chrono::steady_clock::now() - start_time;
+                status->Record(duration);
+                counters->ProbeEvaluation.Record(duration);
+                evaluation->State.store(state, std::memory_order_release);
+                status->Running.store(false, std::memory_order_release);
+                {
+                    std::unique_lock lock(batch->Mutex);
+                    ++batch->Events;
+                }
+                batch->Condition.notify_one();
+            }, [status, evaluation]{
+                auto expected_state = EvaluationState::Queued;
+                if (evaluation->State.compare_exchange_strong(expected_state, EvaluationState::Cancelled,
+                                                              std::memory_order_acq_rel))
+                {
+                    status->Running.store(false, std::memory_order_release);
+                }
+            });
+        }
+
+        // Each probe has its own budget from the time it starts. Probes queued behind slow ones are given up
+        // once every submitted probe could have used its whole budget on the workers.
+        const auto threads_count = pool->GetThreadsCount();
+        const std::chrono::steady_clock::time_point give_up_time = cycle_start_time +
+                budget * static_cast<long long>((submitted_count + threads_count - 1) / threads_count);
+        {
+            std::unique_lock lock(batch->Mutex);
+            while (true)
+            {
+                auto now = std::chrono::steady_clock::now();
+                auto wake_up_time = std::chrono::steady_clock::time_point::max();
+                for (const auto& evaluation : evaluations)
+                {
+                    if (!evaluation) continue;
+                    auto state = evaluation->State.load(std::memory_order_acquire);
+                    auto deadline = give_up_time;
+                    if (state == EvaluationState::Running)
+                    {
+                        deadline = evaluation->StartTime.load(std::memory_order_relaxed) + budget;
+                    }
+                    else if (state != EvaluationState::Queued)
+                    {
+                        continue;
+                    }
+                    if (deadline > now) wake_up_time = std::min(wake_up_time, deadline);
+                }
+                if (wake_up_time == std::chrono::steady_clock::time_point::max()) break;
+                auto events = batch->Events;
+                batch->Condition.wait_until(lock, wake_up_time, [&batch, events]{ return batch->Events != events; });
+            }
+        }
+
+        for (std::size_t index = 0; index < probes.size(); ++index)
+        {
+            auto& evaluation = evaluations[index];
+            if (!evaluation) continue;
+            auto expected_state = EvaluationState::Queued;
+            if (evaluation->State.compare_exchange_strong(expected_state, EvaluationState::Cancelled,
+                                                          std::memory_order_acq_rel))
+            {
+                // Never started, so it is neither stale nor an overrun, and will be evaluated in the next cycle.
+                probes[index]->Status->Running.store(false, std::memory_order_release);
+                ++statistics.DeferredCount;
+                continue;
+            }
+            if (expected_state == EvaluationState::Finished)
+            {
+                values[index] = std::move(evaluation->Value);
+                continue;
+            }
+            probes[index]->Status->Overruns.fetch_add(1, std::memory_order_relaxed);
+            ++statistics.StaleCount;
+        }
+        return values;
+    }
+
+    /// Add the statistics of an update cycle into the performance counters.
+    void InspectionClient::RecordStatistics(const UpdateStatistics& statistics) noexcept
+    {
+        Counters->SkippedValues.fetch_add(statistics.SkippedCount, std::memory_order_relaxed);
+        Counters->StaleProbes.fetch_add(statistics.StaleCount, std::memory_order_relaxed);
+    }
+
+    /// Publish the performance counters of this client as reserved inspection variables.
+    void InspectionClient::SetCounterPublishing(std::chrono::steady_clock::duration interval)
+    {
+        if (interval > std::chrono::steady_clock::duration::zero())
+        {
+            Backend->AddMembers(VariableIndexKey, CounterVariableNames);
+        }
+        std::unique_lock lock(CounterPublishMutex);
+        CounterPublishInterval.store(interval, std::memory_order_relaxed);
+        LastCounterPublishTime = std::chrono::steady_clock::time_point();
+    }
+
+    /// Queue the performance counters as reserved variables, if their publish interval has elapsed.
+    std::size_t InspectionClient::QueueCounters(std::unique_ptr<StorageBatch>& batch,
+                                                std::chrono::steady_clock::time_point now)
+    {
+        auto interval = CounterPublishInterval.load(std::memory_order_relaxed);
+        if (interval <= std::chrono::steady_clock::duration::zero()) return 0;
+        std::unique_lock lock(CounterPublishMutex, std::try_to_lock);
+        if (!lock || now - LastCounterPublishTime < interval) return 0;
+        LastCounterPublishTime = now;
+
+        auto snapshot = Counters->TakeSnapshot();
+        auto to_microseconds = [](std::chrono::nanoseconds duration){
+            return static_cast<double>(duration.count()) / 1000.0;
+        };
+        std::array<char, ValueTextBufferSize> buffer {};
+        auto& counters_batch = GetBatch(batch);
+        auto queue_counter = [&](std::size_t index, auto value){
+            const auto& name = CounterVariableNames[index];
+            QueueValue(counters_batch, name, VariableNamePrefix + name, FormatValue(value, buffer));
+        };
+        queue_counter(0, snapshot.Commands);
+        queue_counter(1, snapshot.BytesSent);
+        queue_counter(2, snapshot.SentValues);
+        queue_counter(3, snapshot.SkippedValues);
+        queue_counter(4, snapshot.StaleProbes);
+        queue_counter(5, snapshot.Flushes);
+        queue_counter(6, snapshot.Errors);
+        queue_counter(7, to_microseconds(snapshot.FlushLatency.GetPercentile(0.50)));
+        queue_counter(8, to_microseconds(snapshot.FlushLatency.GetPercentile(0.99)));
+        queue_counter(9, to_microseconds(snapshot.FlushLatency.Max));
+        queue_counter(10, to_microseconds(snapshot.ProbeEvaluation.GetPercentile(0.50)));
+        queue_counter(11, to_microseconds(snapshot.ProbeEvaluation.GetPercentile(0.99)));
+        queue_counter(12, snapshot.RejectedStreamEntries);
+        return CounterVariableNames.size();
+    }
+
+    /// Put a probe into the timer wheel according to its interval.
+    void InspectionClient::ScheduleProbe(const std::string &name, std::chrono::steady_clock::duration interval,
+                                         std::size_t serial)
+    {
+        auto ticks = (interval + SchedulerTick - std::chrono::steady_clock::duration(1)) / SchedulerTick;
+        Scheduler.Schedule(ScheduledProbe{name, serial}, static_cast<std::size_t>(ticks));
+    }
+
+    /// Start the scheduler thread, which evaluates the probes added with intervals.
+    void InspectionClient::StartScheduler(std::chrono::steady_clock::duration tick)
+    {
+        std::unique_lock lock(SchedulerMutex);
+        if (SchedulerThread.joinable()) return;
+
+        SchedulerTick = tick > std::chrono::steady_clock::duration::zero() ? tick : std::chrono::milliseconds(1);
+        Scheduler = TimerWheel<ScheduledProbe>();
+        for (const auto& [name, information] : *std::atomic_load(&Probes))
+        {
+            if (information->Interval <= std::chrono::steady_clock::duration::zero()) continue;
+            ScheduleProbe(name, information->Interval, information->ScheduleSerial);
+        }
+
+        SchedulerRunning = true;
+        SchedulerThread = std::thread([this]{
+            std::vector<std::string> due_names;
+            auto deadline = std::chrono::steady_clock::now();
+            std::unique_lock scheduler_lock(SchedulerMutex);
+            while (SchedulerRunning)
+            {
+                deadline += SchedulerTick;
+                if (SchedulerCondition.wait_until(scheduler_lock, deadline, [this]{ return !SchedulerRunning; }))
+                    break;
+
+                // Ticks missed because of a slow update are caught up, so probes never drift.
+                due_names.clear();
+                {
+                    auto registry = std::atomic_load(&Probes);
+                    auto handler = [&registry, &due_names](ScheduledProbe& timer){
+                        auto finder = registry->find(timer.Name);
+                        if (finder == registry->end() || finder->second->ScheduleSerial != timer.Serial)
+                            return false;
+                        due_names.push_back(timer.Name);
+                        return true;
+                    };
+                    Scheduler.Advance(handler);
+                    auto now = std::chrono::steady_clock::now();
+                    while (deadline + SchedulerTick <= now)
+                    {
+                        deadline += SchedulerTick;
+                        Scheduler.Advance(handler);
+                    }
+                }
+                TouchRegion();
+                if (due_names.empty()) continue;
+
+                // Probes in the same tick may be due several times after catching up.
+                std::sort(due_names.begin(), due_names.end());
+                due_names.erase(std::unique(due_names.begin(), due_names.end()), due_names.end());
+
+                scheduler_lock.unlock();
+                try
+                {
+                    UpdateProbes(due_names);
+                }
+                catch (...)
+                {
+                    // Values will be sent again in the next period, because the cached values are not refreshed.
+                    // Failures of the storage, whatever their type, have been recorded into the error counter.
+                }
+                scheduler_lock.lock();
+            }
+        });
+    }
+
+    /// Stop the scheduler thread.
+    void InspectionClient::StopScheduler()
+    {
+        {
+            std::unique_lock lock(SchedulerMutex);
+            if (!SchedulerThread.joinable()) return;
+            SchedulerRunning = false;
         }
+        SchedulerCondition.notify_all();
+        SchedulerThread.join();
     }
-}
\ No newline at end of file
+}
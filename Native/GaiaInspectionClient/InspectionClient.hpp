@@ -6,6 +6,29 @@
 #include <sw/redis++/redis++.h>
 #include <functional>
 #include <shared_mutex>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+#include <optional>
+#include "PublishQueue.hpp"
+#include "InspectedVariable.hpp"
+#include "AggregatedVariable.hpp"
+#include "TimerWheel.hpp"
+#include "WorkerPool.hpp"
+#include "SharedMemoryRegion.hpp"
+#include "StorageBackend.hpp"
+#include "RedisBackend.hpp"
+#include "RedisClusterBackend.hpp"
+#include "MemoryBackend.hpp"
+#include "PerformanceCounters.hpp"
+#include "InstrumentedBackend.hpp"
+#include "MultiplexedBackend.hpp"
+#include "ConnectionHub.hpp"
 
 #ifndef TEXT
 #define TEXT(Expression) #Expression
@@ -21,15 +44,41 @@ namespace Gaia::InspectionService
     protected:
         /// Name prefix for variables in Redis.
         const std::string VariableNamePrefix;
+        /// Key of the set of variable names of this unit in Redis.
+        const std::string VariableIndexKey;
+        /// Key of the hash which holds the values of this unit in the hash layout.
+        const std::string ValueHashKey;
+        /// Channel to publish change notifications of this unit.
+        const std::string NotificationChannel;
+        /// Name prefix for history streams of variables in Redis.
+        const std::string HistoryKeyPrefix;
+        /// Key of the change generation of this unit.
+        const std::string GenerationKey;
+        /// Key of the sorted set which maps the variable names of this unit to the generation they last changed at.
+        const std::string ChangeLogKey;
     public:
         /// Unit name of this client.
         const std::string UnitName;
 
+        /// Layout of the variables stored in Redis.
+        enum class StorageLayout
+        {
+            /// Each variable is stored in its own string key "inspections/<unit>/<name>".
+            Keys,
+            /// Variables are stored as fields of the hash "inspection_values/<unit>".
+            Hash,
+            /// Variables are written into both layouts, used to migrate without breaking older readers.
+            Both
+        };
+
         /**
-         * @brief Establish a connection to the Redis server and bind the given name.
+         * @brief Share the connection of this process to the Redis server and bind the given name.
          * @param unit_name Name for the unit, will effect the variables name prefix.
          * @param port Port of the Redis server.
          * @param ip IP address of the Redis server.
+         * @details
+         *  The connection and the backend are acquired from the ConnectionHub, so clients of the same server
+         *  share one connection pool, and their concurrent flushes are merged into common pipelines.
          */
         explicit InspectionClient(const std::string& unit_name,
                          unsigned int port = 6379, const std::string& ip = "127.0.0.1");
@@ -39,7 +88,32 @@ namespace Gaia::InspectionService
          * @param connection Connection to the Redis server.
          */
         InspectionClient(const std::string&  unit_name, std::shared_ptr<sw::redis::Redis> connection);
+        /**
+         * @brief Reuse the connection to a Redis Cluster and bind the given unit name.
+         * @param unit_name Name for the unit, will effect the variables name prefix.
+         * @param connection Connection to the Redis Cluster.
+         * @details Keys of the unit are hash-tagged as "inspections/{<unit>}/<name>", so they share a slot.
+         */
+        InspectionClient(const std::string& unit_name, std::shared_ptr<sw::redis::RedisCluster> connection);
+        /**
+         * @brief Store the variables in the given backend and bind the given unit name.
+         * @param unit_name Name for the unit, will effect the variables name prefix.
+         * @param backend Backend which stores the variables, such as a MemoryBackend for tests without Redis.
+         * @details Notifications and history are only available on the Redis backend.
+         */
+        InspectionClient(const std::string& unit_name, std::shared_ptr<StorageBackend> backend);
 
+    protected:
+        /**
+         * @brief Store the variables in the given backend with keys named after the given unit tag.
+         * @param unit_name Name for the unit.
+         * @param unit_tag Tag of the unit used in its keys, see MakeUnitTag(...).
+         * @param backend Backend which stores the variables.
+         */
+        InspectionClient(const std::string& unit_name, const std::string& unit_tag,
+                         std::shared_ptr<StorageBackend> backend);
+
+    public:
         /// Destructor which will remove the keys of the reigstered variables.
         virtual ~InspectionClient();
 
@@ -50,15 +124,561 @@ namespace Gaia::InspectionService
          */
         using InspectionProbe = std::function<std::string()>;
 
-        /// Connection to the Redis.
-        std::shared_ptr<sw::redis::Redis> Connection;
+        /// Performance counters of this client, shared with the instrumented backend and the evaluation tasks.
+        const std::shared_ptr<PerformanceCounters> Counters {std::make_shared<PerformanceCounters>()};
+        /// Backend which stores the variables, wrapped to record the performance counters.
+        std::shared_ptr<StorageBackend> Backend;
 
-        /// Mutex for probes.
-        std::shared_mutex ProbesMutex;
-        /// Registered probes.
-        std::unordered_map<std::string, std::tuple<InspectionProbe, std::string>> Probes;
+        /**
+         * @brief Replace a copy-on-write registry with a modified copy.
+         * @tparam Registry Type of the registry.
+         * @tparam Modifier Callable type with the signature void(Registry&).
+         * @param mutex Mutex which serializes the modifications of this registry.
+         * @param registry Registry to modify, it is read with std::atomic_load(...) by the update cycles.
+         * @param modifier Function to modify the copy.
+         * @details
+         *  Readers keep using the snapshot they have loaded, and they never wait for the registry mutex.
+         *  The atomic operations on the shared pointer are not lock-free, they only take a short internal lock.
+         */
+        template <typename Registry, typename Modifier>
+        static void ModifyRegistry(std::mutex& mutex, std::shared_ptr<const Registry>& registry, Modifier&& modifier)
+        {
+            std::unique_lock lock(mutex);
+            auto copy = std::make_shared<Registry>(*std::atomic_load(&registry));
+            modifier(*copy);
+            std::atomic_store(&registry, std::shared_ptr<const Registry>(std::move(copy)));
+        }
 
     public:
+        /// Statistics of an update cycle.
+        struct UpdateStatistics
+        {
+            /// Count of values sent to Redis.
+            std::size_t SentCount {0};
+            /// Count of values skipped because they have not changed.
+            std::size_t SkippedCount {0};
+            /// Count of probes skipped because they overran the time budget or were still running.
+            std::size_t StaleCount {0};
+            /// Count of probes skipped because they were still queued behind slow probes when the cycle gave up.
+            std::size_t DeferredCount {0};
+        };
+
+        /// Evaluation timings of a probe.
+        struct ProbeTiming
+        {
+            /// Duration of the last finished evaluation.
+            std::chrono::nanoseconds LastDuration {0};
+            /// Max duration of finished evaluations.
+            std::chrono::nanoseconds MaxDuration {0};
+            /// Total duration of finished evaluations.
+            std::chrono::nanoseconds TotalDuration {0};
+            /// Count of finished evaluations.
+            std::size_t Evaluations {0};
+            /// Count of evaluations which overran the time budget or were skipped because the probe was still running.
+            std::size_t Overruns {0};
+        };
+
+    protected:
+        /// Evaluation status of a probe, shared with the tasks in the worker pool.
+        struct ProbeStatus
+        {
+            /// Whether an evaluation of this probe is running in the worker pool.
+            std::atomic<bool> Running {false};
+            /// Duration of the last finished evaluation in nanoseconds.
+            std::atomic<long long> LastDuration {0};
+            /// Max duration of finished evaluations in nanoseconds.
+            std::atomic<long long> MaxDuration {0};
+            /// Total duration of finished evaluations in nanoseconds.
+            std::atomic<long long> TotalDuration {0};
+            /// Count of finished evaluations.
+            std::atomic<std::size_t> Evaluations {0};
+            /// Count of overrun evaluations.
+            std::atomic<std::size_t> Overruns {0};
+
+            /// Record the duration of a finished evaluation.
+            void Record(std::chrono::steady_clock::duration duration) noexcept
+            {
+                auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+                LastDuration.store(nanoseconds, std::memory_order_relaxed);
+                TotalDuration.fetch_add(nanoseconds, std::memory_order_relaxed);
+                Evaluations.fetch_add(1, std::memory_order_relaxed);
+                auto max_duration = MaxDuration.load(std::memory_order_relaxed);
+                while (nanoseconds > max_duration &&
+                       !MaxDuration.compare_exchange_weak(max_duration, nanoseconds, std::memory_order_relaxed));
+            }
+        };
+
+        /// Information of a registered probe, which is immutable except for its last-value cache.
+        struct ProbeInformation
+        {
+            /// Probe to get the value.
+            const InspectionProbe Probe;
+            /// Interval of this probe in the scheduler, zero if it is only updated in Update().
+            const std::chrono::steady_clock::duration Interval;
+            /// Serial of the schedule, used to discard the timers of replaced probes.
+            const std::size_t ScheduleSerial;
+            /// Evaluation status of this probe.
+            const std::shared_ptr<ProbeStatus> Status {std::make_shared<ProbeStatus>()};
+
+            /// Flag held by the update cycle which currently owns the last-value cache.
+            std::atomic_flag Updating = ATOMIC_FLAG_INIT;
+            /// Value which has been sent to Redis, only accessed by the owner of the flag above.
+            std::string LastValue;
+            /// Whether the value in Redis has been overwritten by UpdateValue(...), so the cache is invalid.
+            std::atomic<bool> Invalidated {false};
+
+            ProbeInformation(InspectionProbe probe, std::chrono::steady_clock::duration interval,
+                             std::size_t schedule_serial) :
+                Probe(std::move(probe)), Interval(interval), ScheduleSerial(schedule_serial)
+            {}
+        };
+        /// Registry of probes indexed by their names.
+        using ProbeRegistry = std::unordered_map<std::string, std::shared_ptr<ProbeInformation>>;
+        /// Mutex which serializes the modifications of the probe registry.
+        std::mutex ProbesMutex;
+        /// Copy-on-write registry of probes, update cycles load it without taking the probes mutex.
+        std::shared_ptr<const ProbeRegistry> Probes {std::make_shared<ProbeRegistry>()};
+
+        /**
+         * @brief Claim the last-value caches of the given probes for an update cycle.
+         * @details
+         *  Probes claimed by another cycle are removed from the list, and claimed probes are released
+         *  when this object is destroyed, so each cache always has a single writer.
+         */
+        class ProbeClaim
+        {
+        private:
+            /// Claimed probes.
+            std::vector<ProbeInformation*> Claimed;
+
+        public:
+            /// Claim the given probes and remove the ones which are owned by other cycles, along with their names.
+            ProbeClaim(std::vector<ProbeInformation*>& probes, std::vector<const std::string*>& names);
+            /// Release the claimed probes.
+            ~ProbeClaim();
+
+            ProbeClaim(const ProbeClaim&) = delete;
+            ProbeClaim& operator=(const ProbeClaim&) = delete;
+        };
+
+        /// Mark the last-value cache of the probe with the given name invalid, if the probe exists.
+        void InvalidateProbe(const std::string& name);
+
+        /// Timer of a scheduled probe.
+        struct ScheduledProbe
+        {
+            /// Name of the probe.
+            std::string Name;
+            /// Serial of the schedule when this timer was created.
+            std::size_t Serial;
+        };
+        /// Timer wheel of scheduled probes.
+        TimerWheel<ScheduledProbe> Scheduler;
+        /// Mutex for the scheduler.
+        std::mutex SchedulerMutex;
+        /// Condition used to notify the scheduler thread to stop.
+        std::condition_variable SchedulerCondition;
+        /// Thread which advances the timer wheel.
+        std::thread SchedulerThread;
+        /// Whether the scheduler thread should keep running.
+        std::atomic<bool> SchedulerRunning {false};
+        /// Length of a tick of the scheduler.
+        std::chrono::steady_clock::duration SchedulerTick {std::chrono::milliseconds(1)};
+        /// Serial for the next scheduled probe.
+        std::atomic<std::size_t> NextScheduleSerial {1};
+
+        /// Worker pool to evaluate probes in parallel, null if probes are evaluated serially; accessed atomically.
+        std::shared_ptr<WorkerPool> EvaluationPool;
+        /// Time budget of each probe evaluation in the worker pool.
+        std::atomic<std::chrono::steady_clock::duration> EvaluationBudget {std::chrono::milliseconds(10)};
+
+        /**
+         * @brief Evaluate the given probes, in the worker pool if it is enabled.
+         * @param probes Probes to evaluate, they should be kept alive by the caller.
+         * @param statistics Statistics to record overrun probes into.
+         * @return Values of the probes, std::nullopt for probes which overran the time budget.
+         */
+        std::vector<std::optional<std::string>> EvaluateProbes(const std::vector<ProbeInformation*>& probes,
+                                                               UpdateStatistics& statistics);
+
+        /// Put a probe into the timer wheel according to its interval, the scheduler mutex should be held.
+        void ScheduleProbe(const std::string& name, std::chrono::steady_clock::duration interval,
+                           std::size_t serial);
+
+        /**
+         * @brief Batch which records the names of the changed variables,
+         *        and stamps them with a new generation when it is executed.
+         * @details
+         *  It also holds the values to mirror into the shared memory region, which are only written
+         *  after the inner batch is executed, so readers of the region never see values which failed to be stored.
+         */
+        class TrackedBatch : public StorageBatch
+        {
+        private:
+            /// Client which owns the generation.
+            InspectionClient& Client;
+            /// Batch which executes the operations.
+            std::unique_ptr<StorageBatch> Inner;
+
+        public:
+            /// Names of the variables changed by this batch.
+            std::vector<std::string> ChangedNames;
+            /// Shared memory region to mirror the values into, null if it is disabled.
+            const std::shared_ptr<SharedMemoryRegion> Region;
+            /// Names and values to write into the region, std::nullopt for removed variables.
+            std::vector<std::pair<std::string, std::optional<std::string>>> RegionValues;
+
+            TrackedBatch(InspectionClient& client, std::unique_ptr<StorageBatch> inner,
+                         std::shared_ptr<SharedMemoryRegion> region) :
+                Client(client), Inner(std::move(inner)), Region(std::move(region))
+            {}
+
+            void Set(std::string_view key, std::string_view value) override
+            {
+                Inner->Set(key, value);
+            }
+
+            void Delete(std::string_view key) override
+            {
+                Inner->Delete(key);
+            }
+
+            void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+            {
+                Inner->HashSet(key, field, value);
+            }
+
+            void HashDelete(std::string_view key, std::string_view field) override
+            {
+                Inner->HashDelete(key, field);
+            }
+
+            void AddMember(std::string_view key, std::string_view member) override
+            {
+                Inner->AddMember(key, member);
+            }
+
+            void RemoveMember(std::string_view key, std::string_view member) override
+            {
+                Inner->RemoveMember(key, member);
+            }
+
+            void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+            {
+                Inner->AddScoredMember(key, member, score);
+            }
+
+            void Publish(std::string_view channel, std::string_view message) override
+            {
+                Inner->Publish(channel, message);
+            }
+
+            void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                              std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+            {
+                Inner->AppendStream(key, id, value, timestamp, max_length, min_id);
+            }
+
+            void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                              const std::vector<std::string>& members) override
+            {
+                Inner->StampChanges(generation_key, change_log_key, members);
+            }
+
+            /// Stamp the changed variables with a new generation, execute the inner batch, then write the region.
+            std::size_t Execute() override;
+        };
+
+        /// Whether the changed variables are stamped with generations.
+        std::atomic<bool> ChangeTracking {false};
+
+        /// Create a batch, which tracks the changed variables and the region writes if they are enabled.
+        std::unique_ptr<StorageBatch> CreateBatch();
+        /// Get the given batch, it will be created on the first use, so idle cycles never allocate one.
+        StorageBatch& GetBatch(std::unique_ptr<StorageBatch>& batch);
+        /// Record the write of a variable into the shared memory region, which is done after the batch is executed.
+        static void RecordRegionWrite(StorageBatch& batch, std::string_view name,
+                                      std::optional<std::string_view> value);
+        /// Record the change of a variable into the batch, if it tracks changes.
+        void RecordChange(StorageBatch& batch, std::string_view name);
+
+        /// Layout of the variables stored in Redis.
+        StorageLayout Layout {StorageLayout::Keys};
+        /// Whether change notifications will be published.
+        bool Notification {false};
+        /// Shared memory region for readers on the same host, null if it is disabled; accessed atomically.
+        std::shared_ptr<SharedMemoryRegion> Region;
+        /// Serial of the latest batch mirrored into the region, which orders the writes of concurrent batches.
+        std::atomic<std::uint64_t> RegionSerial {0};
+        /// Refresh the heartbeat of the shared memory region if it is enabled, so readers know this client is alive.
+        void TouchRegion();
+
+    public:
+        /// Retention limits of the history of a variable.
+        struct HistoryRetention
+        {
+            /// Max count of entries to keep, 0 means no limit on the count.
+            std::size_t MaxLength {1000};
+            /// Max age of entries to keep, 0 means no limit on the age.
+            std::chrono::milliseconds MaxAge {0};
+        };
+
+    protected:
+        /// Mutex for history settings.
+        std::shared_mutex HistoryMutex;
+        /// Retention limits of variables whose history is recorded.
+        std::unordered_map<std::string, HistoryRetention> HistorySettings;
+        /// Whether any variable records its history, used to skip the lookup of history settings.
+        std::atomic<bool> HistoryEnabled {false};
+        /// Whether history entries are identified by their source time, detected when the history is first enabled.
+        std::optional<bool> TimedHistoryIDs;
+
+        /**
+         * @brief Queue the append of a value into the history stream of the variable, if its history is enabled.
+         * @param batch Batch to queue the operations into.
+         * @param name Name of the variable.
+         * @param value Value text of the variable.
+         */
+        void QueueHistory(StorageBatch& batch, std::string_view name, std::string_view value);
+
+        /**
+         * @brief Queue the write of a variable value into the batch according to the storage layout,
+         *        and the change notification if it is enabled.
+         * @param batch Batch to queue the operations into.
+         * @param name Name of the variable.
+         * @param key Key of the variable, only used in the keys layout.
+         * @param value Value text of the variable.
+         */
+        void QueueValue(StorageBatch& batch, std::string_view name,
+                        std::string_view key, std::string_view value);
+
+        /**
+         * @brief Queue the removal of a variable value into the batch according to the storage layout,
+         *        and the change notification if it is enabled.
+         * @param batch Batch to queue the operations into.
+         * @param name Name of the variable.
+         */
+        void QueueRemoval(StorageBatch& batch, const std::string& name);
+
+        /// Registry of typed variables indexed by their names.
+        using VariableRegistry = std::unordered_map<std::string, std::shared_ptr<InspectedVariableBase>>;
+        /// Mutex which serializes the modifications of the registries of typed and aggregated variables.
+        std::mutex VariablesMutex;
+        /// Copy-on-write registry of typed variables.
+        std::shared_ptr<const VariableRegistry> Variables {std::make_shared<VariableRegistry>()};
+        /// Mutex which serializes the collection of typed variables in concurrent update cycles.
+        std::mutex CollectionMutex;
+
+        /**
+         * @brief Add a typed variable into the update list.
+         * @param variable Variable to add, previous variable with the same name will be replaced.
+         */
+        void AddVariable(std::shared_ptr<InspectedVariableBase> variable);
+
+        /// Registry of aggregated variables indexed by their names.
+        using AggregationRegistry = std::unordered_map<std::string, std::shared_ptr<AggregatedVariable>>;
+        /// Copy-on-write registry of aggregated variables, modifications are serialized by the variables mutex.
+        std::shared_ptr<const AggregationRegistry> Aggregations {std::make_shared<AggregationRegistry>()};
+
+        /**
+         * @brief Queue the statistics of a finished window into the batch.
+         * @param batch Batch to queue the operations into.
+         * @param variable Aggregated variable which owns the window.
+         * @param summary Statistics of the window.
+         */
+        void QueueSummary(StorageBatch& batch, const AggregatedVariable& variable,
+                          const AggregatedVariable::Summary& summary);
+
+        /// Publish rate limit of a variable.
+        struct RateLimit
+        {
+            /// Min interval between two publishes.
+            std::chrono::steady_clock::duration Interval;
+            /// Time of the last publish.
+            std::chrono::steady_clock::time_point LastPublishTime;
+            /// Latest value which has been held back by this limit.
+            std::optional<std::string> PendingValue;
+        };
+
+        /// Mutex for rate limits.
+        std::mutex RateLimitsMutex;
+        /// Rate limits of variables.
+        std::unordered_map<std::string, RateLimit> RateLimits;
+        /// Whether any variable has a rate limit, used to skip the lookup of rate limits.
+        std::atomic<bool> RateLimitEnabled {false};
+
+        /**
+         * @brief Check whether the variable can be published now according to its rate limit.
+         * @param name Name of the variable.
+         * @param now Current time.
+         * @param value Value to hold back if the variable can not be published now, can be null.
+         * @retval true The variable can be published, and the publish time has been recorded.
+         * @retval false The variable has been published within the limited interval.
+         */
+        bool AcquirePublish(const std::string& name, std::chrono::steady_clock::time_point now,
+                            const std::string* value = nullptr);
+
+        /**
+         * @brief Queue the values held back by rate limits whose interval has elapsed.
+         * @param batch Batch to queue the operations into, created by the first queued operation.
+         * @param now Current time.
+         * @return Count of queued values.
+         */
+        std::size_t QueuePendingValues(std::unique_ptr<StorageBatch>& batch, std::chrono::steady_clock::time_point now);
+
+        /// Value waiting in the queue of the asynchronous publisher.
+        struct PendingValue
+        {
+            /// Name of the variable.
+            std::string Name;
+            /// Value text of the variable.
+            std::string Value;
+        };
+
+        /// Queue of values to publish, only exists when the asynchronous mode is enabled.
+        std::unique_ptr<PublishQueue<PendingValue>> PublisherQueue;
+        /// Background thread which drains the queue to Redis.
+        std::thread PublisherThread;
+        /// Whether the background publisher should keep running.
+        std::atomic<bool> PublisherRunning {false};
+        /// Interval between two drains of the queue.
+        std::chrono::microseconds PublisherInterval {1000};
+        /// Mutex used to wake up the background publisher and to serialize drains.
+        std::mutex PublisherMutex;
+        /// Condition used to notify the background publisher to stop.
+        std::condition_variable PublisherCondition;
+
+        /**
+         * @brief Drain all values in the queue to Redis in one batch.
+         * @param latest_value Value to send after the queued ones, used by producers which found the queue full.
+         * @details Values of the same variable are coalesced, only the latest one will be sent.
+         */
+        void DrainPublishQueue(PendingValue* latest_value = nullptr);
+
+        /// Names of the reserved variables which hold the performance counters, under the prefix "_client/".
+        static const std::vector<std::string> CounterVariableNames;
+        /// Mutex for the publishing of performance counters, cycles which fail to lock it skip the publishing.
+        std::mutex CounterPublishMutex;
+        /// Interval between two publishes of the performance counters, zero if they are not published.
+        std::atomic<std::chrono::steady_clock::duration> CounterPublishInterval {
+            std::chrono::steady_clock::duration::zero()};
+        /// Time of the last publish of the performance counters.
+        std::chrono::steady_clock::time_point LastCounterPublishTime;
+
+        /**
+         * @brief Queue the performance counters as reserved variables, if their publish interval has elapsed.
+         * @param batch Batch to queue the operations into, created by the first queued operation.
+         * @param now Current time.
+         * @return Count of queued values.
+         */
+        std::size_t QueueCounters(std::unique_ptr<StorageBatch>& batch, std::chrono::steady_clock::time_point now);
+
+        /// Add the skipped and stale counts of an update cycle into the performance counters.
+        void RecordStatistics(const UpdateStatistics& statistics) noexcept;
+
+    public:
+        /**
+         * @brief Change the layout of the variables stored in Redis.
+         * @param layout Layout to use.
+         * @details
+         *  This function should be called before any value is written,
+         *  values written in the previous layout will not be moved.
+         */
+        void SetStorageLayout(StorageLayout layout) noexcept
+        {
+            Layout = layout;
+        }
+
+        /// Get the layout of the variables stored in Redis.
+        [[nodiscard]] StorageLayout GetStorageLayout() const noexcept
+        {
+            return Layout;
+        }
+
+        /**
+         * @brief Enable or disable the change notifications.
+         * @param enable If true, a notification will be published whenever a value is written or removed.
+         * @details
+         *  Notifications are published to the channel "inspection_changes/<unit>" in the same pipeline as the writes,
+         *  the message is "<name>\n<value>" for a written value, and "<name>" for a removed value;
+         *  backslashes and line feeds in the name are escaped as "\\\\" and "\\n".
+         */
+        void SetNotification(bool enable) noexcept
+        {
+            Notification = enable;
+        }
+
+        /// Check whether change notifications will be published.
+        [[nodiscard]] bool IsNotificationEnabled() const noexcept
+        {
+            return Notification;
+        }
+
+        /**
+         * @brief Enable or disable the change tracking, which allows readers to poll only the changed variables.
+         * @param enable If true, each batch of writes stamps the changed variables with a new generation.
+         * @details
+         *  The generation of this unit is stored in "inspection_generation/<unit>", and the sorted set
+         *  "inspection_changelog/<unit>" maps each variable name to the generation it last changed at,
+         *  both are written in the same batch as the values, after them. The storage increments the generation
+         *  and stamps the changes atomically, so batches are not serialized by the client, and writers of
+         *  the same unit, such as a restarted client overlapping the old one, never share a generation.
+         *  Both keys outlive the client, its destructor stamps the removed variables as changed instead.
+         */
+        void SetChangeTracking(bool enable);
+
+        /// Check whether the changed variables are stamped with generations.
+        [[nodiscard]] bool IsChangeTrackingEnabled() const noexcept
+        {
+            return ChangeTracking.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Mirror the written values into a shared memory region for readers on the same host.
+         * @param slots_count Max count of variables in the region.
+         * @param value_capacity Max length of a value text, longer values are only available in Redis.
+         * @throw std::runtime_error If the region can not be created.
+         * @details
+         *  The region "/gaia_inspection.<unit>" is written along with Redis, and readers with shared memory
+         *  enabled read it without any round trip to Redis. Values written before are not in the region,
+         *  so a forced Update() is recommended after enabling it.
+         *  The heartbeat of the region is refreshed by writes, Update() and the scheduler ticks; readers fall back
+         *  to Redis if it expires, or if this process dies without removing the region.
+         */
+        void EnableSharedMemory(std::size_t slots_count = 1024, std::size_t value_capacity = 256);
+        /// Stop mirroring values into the shared memory region, and remove the region.
+        void DisableSharedMemory();
+        /// Check whether values are mirrored into the shared memory region.
+        [[nodiscard]] bool IsSharedMemoryEnabled() const
+        {
+            return std::atomic_load(&Region) != nullptr;
+        }
+
+        /**
+         * @brief Record the history of the variable with the given name.
+         * @param name Name of the variable.
+         * @param retention Retention limits of the history.
+         * @details
+         *  Each written value will be appended to the capped stream "inspection_history/<unit>/<name>",
+         *  with the fields "value" and "timestamp", which is the source time in microseconds since the epoch.
+         *  Entry IDs are the source time in milliseconds if the server is Redis 7.0 or later, otherwise the time
+         *  when the server received the entry. A value whose source time is older than the latest entry,
+         *  such as after the clock is set back, is not recorded, and it is counted in "_client/history_rejected".
+         *  Calling this function on a variable whose history is already enabled will change its retention limits.
+         */
+        void EnableHistory(const std::string& name, HistoryRetention retention);
+        /// Record the history of the variable with the given name with the default retention limits.
+        void EnableHistory(const std::string& name)
+        {
+            EnableHistory(name, HistoryRetention{});
+        }
+        /**
+         * @brief Stop recording the history of the variable with the given name.
+         * @param name Name of the variable.
+         * @param remove_history If true, the recorded history stream will be deleted.
+         */
+        void DisableHistory(const std::string& name, bool remove_history = false);
+
         /**
          * @brief Add a variable probe into the update list.
          * @param name Name of the variable.
@@ -66,8 +686,21 @@ namespace Gaia::InspectionService
          * @details
          *  Added probe will be used in function Update().
          *  Previous probe with the same name will be replaced silently.
+         *  Adding and removing probes never blocks a running update cycle, and vice versa.
          */
         void AddProbe(const std::string& name, InspectionProbe probe);
+        /**
+         * @brief Add a variable probe which will be updated by the scheduler with the given interval.
+         * @param name Name of the variable.
+         * @param probe Probe for the variable.
+         * @param interval Interval between two evaluations of this probe.
+         * @details
+         *  The probe is evaluated by the scheduler thread once it is started by StartScheduler(...),
+         *  probes due in the same tick are sent in one pipeline;
+         *  when the scheduler is not running, this probe will be used in function Update().
+         *  Previous probe with the same name will be replaced silently.
+         */
+        void AddProbe(const std::string& name, InspectionProbe probe, std::chrono::steady_clock::duration interval);
         /**
          * @brief Remove a variable probe from the update list.
          * @param name Name of the variable.
@@ -85,7 +718,7 @@ namespace Gaia::InspectionService
         void UpdateProbe(const std::string& name, bool force_mode = false);
         /**
          * @brief Directly update the value of a inspected value,
-         *        and it will update the last value for its probe if the probe exists.
+         *        and it will invalidate the last value for its probe if the probe exists.
          * @param name Name of the variable.
          * @param value Value to update.
          */
@@ -93,7 +726,7 @@ namespace Gaia::InspectionService
 
         /**
          * @brief Directly update the value of a inspected value,
-         *        and it will update the last value for its probe if the probe exists.
+         *        and it will invalidate the last value for its probe if the probe exists.
          * @tparam ValueType Type of the given value.
          * @param name Name of the variable.
          * @param value Value to pass to std::to_string(...) and then used to update.
@@ -101,24 +734,168 @@ namespace Gaia::InspectionService
         template <typename ValueType>
         void UpdateValue(const std::string& name, const ValueType& value)
         {
-            UpdateValue(name, std::to_string(value));
+            if constexpr (std::is_arithmetic_v<ValueType>)
+            {
+                std::array<char, ValueTextBufferSize> buffer;
+                UpdateValue(name, std::string(FormatValue(value, buffer)));
+            }
+            else
+            {
+                UpdateValue(name, std::to_string(value));
+            }
+        }
+
+        /**
+         * @brief Register a typed variable, whose value will be sent to Redis in Update().
+         * @tparam ValueType Arithmetic type of the variable.
+         * @param name Name of the variable.
+         * @return Handle of the variable, which holds the precomputed key and the raw value.
+         * @details
+         *  Setting the value through the handle only stores it into an atomic cell,
+         *  Update() compares the raw value with the published one and formats it only if it has changed.
+         *  Previous variable with the same name will be replaced silently.
+         */
+        template <typename ValueType>
+        std::shared_ptr<InspectedVariable<ValueType>> Register(const std::string& name)
+        {
+            auto variable = std::make_shared<InspectedVariable<ValueType>>(name, VariableNamePrefix + name);
+            AddVariable(variable);
+            return variable;
         }
 
+        /**
+         * @brief Evaluate probes in parallel on a worker pool, with a time budget for each probe.
+         * @param threads_count Count of worker threads, 0 to evaluate probes serially on the calling thread.
+         * @param budget Time budget of each probe to finish, counted from the time the probe starts.
+         * @details
+         *  Probes which do not finish within their budget are marked stale and skipped in this cycle,
+         *  and a probe whose previous evaluation is still running will not be evaluated again.
+         *  Probes still queued behind slow ones when every probe could have used its budget are deferred
+         *  to the next cycle without being counted as overruns.
+         *  Probes should be thread-safe when they are evaluated in the worker pool.
+         */
+        void SetEvaluationPool(std::size_t threads_count,
+                               std::chrono::steady_clock::duration budget = std::chrono::milliseconds(10));
+
+        /**
+         * @brief Get the evaluation timings of all probes.
+         * @return Timings indexed by the probe names.
+         */
+        std::unordered_map<std::string, ProbeTiming> GetProbeTimings();
+
+        /**
+         * @brief Get the performance counters of this client.
+         * @return Snapshot of the counters, which are monotonic since this client was constructed.
+         * @details
+         *  Counters are relaxed atomics updated along the hot paths, so they are always on,
+         *  and taking a snapshot never blocks the update cycles.
+         */
+        [[nodiscard]] PerformanceCounters::Snapshot GetPerformanceCounters() const noexcept
+        {
+            return Counters->TakeSnapshot();
+        }
+
+        /**
+         * @brief Publish the performance counters of this client as reserved inspection variables.
+         * @param interval Min interval between two publishes, zero to stop publishing.
+         * @details
+         *  Counters are published in Update() as the variables "_client/commands", "_client/bytes_sent",
+         *  "_client/sent", "_client/skipped", "_client/stale", "_client/flushes", "_client/errors",
+         *  "_client/flush_p50_us", "_client/flush_p99_us", "_client/flush_max_us",
+         *  "_client/probe_p50_us", "_client/probe_p99_us" and "_client/history_rejected", so tools such as
+         *  the Tile and the Chart can show the overhead of the inspection itself.
+         *  They are not counted in the update statistics.
+         */
+        void SetCounterPublishing(std::chrono::steady_clock::duration interval = std::chrono::seconds(1));
+
+        /**
+         * @brief Start the scheduler thread, which evaluates the probes added with intervals.
+         * @param tick Length of a tick, intervals of probes will be rounded up to ticks.
+         * @details
+         *  The scheduler keeps an absolute deadline for each tick, so it does not drift with the update latency.
+         *  Calling this function when the scheduler is already running does nothing.
+         */
+        void StartScheduler(std::chrono::steady_clock::duration tick = std::chrono::milliseconds(1));
+        /**
+         * @brief Stop the scheduler thread.
+         * @details This function will be automatically invoked in the destructor.
+         */
+        void StopScheduler();
+
+        /**
+         * @brief Enable the asynchronous mode, in which values are published by a background thread.
+         * @param queue_capacity Max count of values waiting to be published,
+         *                       only takes effect when the asynchronous mode is enabled for the first time.
+         * @param interval Interval between two batches sent by the background thread.
+         * @details
+         *  In asynchronous mode, UpdateValue(...) only pushes the value into a lock-free queue,
+         *  and the background thread will coalesce the values of the same variable and send them in batches.
+         *  If the queue is full, the caller drains the queue and sends the value with it synchronously,
+         *  so a value is never overwritten by older ones still in the queue.
+         *  Calling this function when the asynchronous mode is already enabled does nothing.
+         */
+        void StartAsyncMode(std::size_t queue_capacity = 4096,
+                            std::chrono::microseconds interval = std::chrono::milliseconds(1));
+        /**
+         * @brief Disable the asynchronous mode, values still in the queue will be flushed.
+         * @details This function will be automatically invoked in the destructor.
+         */
+        void StopAsyncMode();
+
+        /**
+         * @brief Register a high-frequency variable, whose samples are aggregated and published per window.
+         * @param name Name of the variable.
+         * @param window Length of a window, statistics will be published in the first Update() after it elapsed.
+         * @param layout Layout of the published statistics.
+         * @return Handle to record samples into.
+         * @details
+         *  The min, max, mean, last value and count of each window are published,
+         *  as sibling variables "<name>/min", "<name>/max", "<name>/mean", "<name>/last" and "<name>/count",
+         *  or as one variable "<name>" with a JSON object text in the structured layout.
+         *  Previous aggregated variable with the same name will be replaced silently.
+         */
+        std::shared_ptr<AggregatedVariable> Aggregate(
+                const std::string& name, std::chrono::steady_clock::duration window,
+                AggregatedVariable::OutputLayout layout = AggregatedVariable::OutputLayout::Siblings);
+
+        /**
+         * @brief Limit the publish rate of a variable.
+         * @param name Name of the variable.
+         * @param min_interval Min interval between two publishes, zero to remove the limit.
+         * @details
+         *  Values updated within the interval are held back, and the latest one will be published
+         *  in the first Update() after the interval elapsed; changed probes and typed variables are
+         *  simply published in a later Update().
+         */
+        void SetRateLimit(const std::string& name, std::chrono::steady_clock::duration min_interval);
+
         /**
          * @brief Delete the key of the variable with the given name from the Redis,
-         *        and remove the probe for this variable.
+         *        and remove the probe, the typed variable, the aggregation and the history of this name.
          * @param name Name of the variable.
          */
         void RemoveValue(const std::string& name);
 
     public:
+
         /**
-         * @brief Update all probes.
+         * @brief Update all probes and typed variables.
          * @param force_mode If true, all values will be sent to Redis, ignoring the previous value.
+         * @return Count of the values sent and skipped in this update.
          * @details
          *  Normally, this function will check the cached previous value,
          *  if the current value has not changed, the value will not be sent to Redis.
+         *  All changed values are gathered and sent in one pipeline, which costs only one round trip.
+         *  Probes added with intervals are skipped when the scheduler is running.
+         */
+        UpdateStatistics Update(bool force_mode = false);
+
+        /**
+         * @brief Update the probes with the given names in one pipeline.
+         * @param names Names of the probes to update, names without probes will be ignored.
+         * @param force_mode If true, all values will be sent to Redis, ignoring the previous value.
+         * @return Count of the values sent and skipped in this update.
          */
-        void Update(bool force_mode = false);
+        UpdateStatistics UpdateProbes(const std::vector<std::string>& names, bool force_mode = false);
     };
 }
\ No newline at end of file
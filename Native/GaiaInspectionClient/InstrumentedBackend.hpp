@@ -0,0 +1,295 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include "StorageBackend.hpp"
+#include "PerformanceCounters.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Batch which forwards operations to another batch and records them into performance counters.
+     * @details Each operation counts as one command, and its keys, fields and values count as bytes sent.
+     */
+    class InstrumentedBatch : public StorageBatch
+    {
+    private:
+        /// Batch which executes the operations.
+        std::unique_ptr<StorageBatch> Inner;
+        /// Counters to record into.
+        PerformanceCounters& Counters;
+        /// Count of recorded operations, added to the counters at once when the batch is executed.
+        std::uint64_t CommandsCount {0};
+        /// Bytes of recorded operations, added to the counters at once when the batch is executed.
+        std::uint64_t BytesCount {0};
+
+        /// Record an operation with the given payload size.
+        void Count(std::size_t bytes) noexcept
+        {
+            ++CommandsCount;
+            BytesCount += bytes;
+        }
+
+    public:
+        InstrumentedBatch(std::unique_ptr<StorageBatch> inner, PerformanceCounters& counters) :
+            Inner(std::move(inner)), Counters(counters)
+        {}
+
+        void Set(std::string_view key, std::string_view value) override
+        {
+            Count(key.size() + value.size());
+            Inner->Set(key, value);
+        }
+
+        void Delete(std::string_view key) override
+        {
+            Count(key.size());
+            Inner->Delete(key);
+        }
+
+        void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+        {
+            Count(key.size() + field.size() + value.size());
+            Inner->HashSet(key, field, value);
+        }
+
+        void HashDelete(std::string_view key, std::string_view field) override
+        {
+            Count(key.size() + field.size());
+            Inner->HashDelete(key, field);
+        }
+
+        void AddMember(std::string_view key, std::string_view member) override
+        {
+            Count(key.size() + member.size());
+            Inner->AddMember(key, member);
+        }
+
+        void RemoveMember(std::string_view key, std::string_view member) override
+        {
+            Count(key.size() + member.size());
+            Inner->RemoveMember(key, member);
+        }
+
+        void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+        {
+            Count(key.size() + member.size() + sizeof(score));
+            Inner->AddScoredMember(key, member, score);
+        }
+
+        void Publish(std::string_view channel, std::string_view message) override
+        {
+            Count(channel.size() + message.size());
+            Inner->Publish(channel, message);
+        }
+
+        void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                          std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+        {
+            Count(key.size() + id.size() + value.size() + timestamp.size() + min_id.size());
+            Inner->AppendStream(key, id, value, timestamp, max_length, min_id);
+        }
+
+        /// Execute the inner batch, and record its latency, or the error if it fails.
+        void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                          const std::vector<std::string>& members) override
+        {
+            std::size_t bytes = generation_key.size() + change_log_key.size();
+            for (const auto& member : members) bytes += member.size();
+            Count(bytes);
+            Inner->StampChanges(generation_key, change_log_key, members);
+        }
+
+        std::size_t Execute() override
+        {
+            Counters.Commands.fetch_add(CommandsCount, std::memory_order_relaxed);
+            Counters.BytesSent.fetch_add(BytesCount, std::memory_order_relaxed);
+            CommandsCount = 0;
+            BytesCount = 0;
+            auto start_time = std::chrono::steady_clock::now();
+            std::size_t rejected_count = 0;
+            try
+            {
+                rejected_count = Inner->Execute();
+            }
+            catch (...)
+            {
+                Counters.Errors.fetch_add(1, std::memory_order_relaxed);
+                throw;
+            }
+            Counters.FlushLatency.Record(std::chrono::steady_clock::now() - start_time);
+            Counters.Flushes.fetch_add(1, std::memory_order_relaxed);
+            Counters.RejectedStreamEntries.fetch_add(rejected_count, std::memory_order_relaxed);
+            return rejected_count;
+        }
+    };
+
+    /**
+     * @brief Backend which forwards calls to another backend and records them into performance counters.
+     * @details
+     *  It is used by the inspection client to count its own traffic without touching the backends,
+     *  so the counters work the same on Redis and in process.
+     */
+    class InstrumentedBackend : public StorageBackend
+    {
+    private:
+        /// Backend which stores the variables.
+        std::shared_ptr<StorageBackend> Inner;
+        /// Counters to record into, shared with the owner.
+        std::shared_ptr<PerformanceCounters> Counters;
+
+        /// Record a command with the given payload size.
+        void Count(std::size_t bytes) noexcept
+        {
+            Counters->Commands.fetch_add(1, std::memory_order_relaxed);
+            Counters->BytesSent.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        /// Invoke a call on the inner backend, and record the error if it fails.
+        template <typename Function>
+        decltype(auto) Invoke(Function&& function)
+        {
+            try
+            {
+                return function();
+            }
+            catch (...)
+            {
+                Counters->Errors.fetch_add(1, std::memory_order_relaxed);
+                throw;
+            }
+        }
+
+    public:
+        /**
+         * @brief Wrap the given backend.
+         * @param inner Backend to forward calls to.
+         * @param counters Counters to record into.
+         * @throw std::runtime_error If the given backend is null.
+         */
+        InstrumentedBackend(std::shared_ptr<StorageBackend> inner, std::shared_ptr<PerformanceCounters> counters) :
+            Inner(std::move(inner)), Counters(std::move(counters))
+        {
+            if (!Inner) throw std::runtime_error("Storage backend is null.");
+        }
+
+        /// Get the wrapped backend.
+        [[nodiscard]] const std::shared_ptr<StorageBackend>& GetInner() const noexcept
+        {
+            return Inner;
+        }
+
+        std::unique_ptr<StorageBatch> CreateBatch() override
+        {
+            return std::make_unique<InstrumentedBatch>(Inner->CreateBatch(), *Counters);
+        }
+
+        std::optional<std::string> Get(const std::string& key) override
+        {
+            Count(key.size());
+            return Invoke([&]{ return Inner->Get(key); });
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) override
+        {
+            std::size_t bytes = 0;
+            for (const auto& key : keys) bytes += key.size();
+            Count(bytes);
+            return Invoke([&]{ return Inner->MultiGet(keys); });
+        }
+
+        std::optional<std::string> HashGet(const std::string& key, const std::string& field) override
+        {
+            Count(key.size() + field.size());
+            return Invoke([&]{ return Inner->HashGet(key, field); });
+        }
+
+        std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                             const std::vector<std::string>& fields) override
+        {
+            std::size_t bytes = key.size();
+            for (const auto& field : fields) bytes += field.size();
+            Count(bytes);
+            return Invoke([&]{ return Inner->HashMultiGet(key, fields); });
+        }
+
+        std::vector<std::vector<std::optional<std::string>>> MultiHashMultiGet(
+                const std::vector<std::string>& keys, const std::vector<std::vector<std::string>>& fields) override
+        {
+            std::size_t bytes = 0;
+            for (const auto& key : keys) bytes += key.size();
+            for (const auto& hash_fields : fields)
+            {
+                for (const auto& field : hash_fields) bytes += field.size();
+            }
+            Counters->Commands.fetch_add(keys.size(), std::memory_order_relaxed);
+            Counters->BytesSent.fetch_add(bytes, std::memory_order_relaxed);
+            return Invoke([&]{ return Inner->MultiHashMultiGet(keys, fields); });
+        }
+
+        std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) override
+        {
+            Count(key.size());
+            return Invoke([&]{ return Inner->HashGetAll(key); });
+        }
+
+        std::unordered_set<std::string> Members(const std::string& key) override
+        {
+            Count(key.size());
+            return Invoke([&]{ return Inner->Members(key); });
+        }
+
+        std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) override
+        {
+            std::size_t bytes = 0;
+            for (const auto& key : keys) bytes += key.size();
+            Counters->Commands.fetch_add(keys.size(), std::memory_order_relaxed);
+            Counters->BytesSent.fetch_add(bytes, std::memory_order_relaxed);
+            return Invoke([&]{ return Inner->MultiMembers(keys); });
+        }
+
+        long long ScanMembers(const std::string& key, long long cursor, std::size_t count,
+                              std::vector<std::string>& members) override
+        {
+            Count(key.size());
+            return Invoke([&]{ return Inner->ScanMembers(key, cursor, count, members); });
+        }
+
+        std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                          long long min_score) override
+        {
+            Count(key.size() + sizeof(min_score));
+            return Invoke([&]{ return Inner->ScoredMembersAbove(key, min_score); });
+        }
+
+        void AddMembers(const std::string& key, const std::vector<std::string>& members) override
+        {
+            std::size_t bytes = key.size();
+            for (const auto& member : members) bytes += member.size();
+            Count(bytes);
+            Invoke([&]{ Inner->AddMembers(key, members); });
+        }
+
+        void RemoveMember(const std::string& key, const std::string& member) override
+        {
+            Count(key.size() + member.size());
+            Invoke([&]{ Inner->RemoveMember(key, member); });
+        }
+
+        void Delete(const std::string& key) override
+        {
+            Count(key.size());
+            Invoke([&]{ Inner->Delete(key); });
+        }
+
+        [[nodiscard]] bool IsClustered() const noexcept override
+        {
+            return Inner->IsClustered();
+        }
+
+        [[nodiscard]] bool SupportsTimedStreamIDs() override
+        {
+            return Invoke([&]{ return Inner->SupportsTimedStreamIDs(); });
+        }
+    };
+}
@@ -0,0 +1,569 @@
+#pragma once
+
+#include <mutex>
+#include <algorithm>
+#include <variant>
+#include <functional>
+#include <deque>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include "StorageBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief In-process storage backend, used by tests, benchmarks and embedded inspection without Redis.
+     * @details
+     *  Keys are distributed over stripes by their hash, and each stripe has its own mutex,
+     *  so operations on different keys rarely contend.
+     *  Writing a key with another type replaces it, instead of failing like Redis does.
+     *  Published messages are delivered to the handlers subscribed in this process after their batch is applied,
+     *  and streams get IDs of the form "<milliseconds>-<sequence>" in ascending order like Redis streams.
+     *  Operations in a batch are applied one by one, they are not atomic as a whole.
+     */
+    class MemoryBackend : public StorageBackend
+    {
+    public:
+        /// Entry of a stream.
+        struct StreamEntry
+        {
+            /// ID of the entry, as "<milliseconds>-<sequence>".
+            std::string ID;
+            /// Value field of the entry.
+            std::string Value;
+            /// Timestamp field of the entry.
+            std::string Timestamp;
+        };
+
+        /// Handler of the messages published to a channel, invoked with the channel and the message.
+        using MessageHandler = std::function<void(const std::string& channel, const std::string& message)>;
+
+    private:
+        /// Sorted set, which maps members to their scores.
+        using ScoredSet = std::unordered_map<std::string, long long>;
+        /// Numeric form of a stream ID, the milliseconds and the sequence.
+        using StreamID = std::pair<unsigned long long, unsigned long long>;
+        /// Stream, whose entries are in ascending order of their IDs.
+        struct Stream
+        {
+            std::deque<std::pair<StreamID, StreamEntry>> Entries;
+            /// ID of the last appended entry, new IDs are always greater than it.
+            StreamID LastID {0, 0};
+        };
+        /// Value of a key, which is a string, a hash, a set, a sorted set or a stream.
+        using Value = std::variant<std::string, std::unordered_map<std::string, std::string>,
+                                   std::unordered_set<std::string>, ScoredSet, Stream>;
+
+        /// Part of the keys guarded by one mutex.
+        struct alignas(64) Stripe
+        {
+            std::mutex Mutex;
+            std::unordered_map<std::string, Value> Entries;
+        };
+
+        /// Count of stripes.
+        const std::size_t StripesCount;
+        /// Stripes of keys.
+        std::unique_ptr<Stripe[]> Stripes;
+
+        /// Get the stripe of the given key.
+        Stripe& GetStripe(std::string_view key) const noexcept
+        {
+            return Stripes[std::hash<std::string_view>()(key) % StripesCount];
+        }
+
+        /// Get the value of the given type of a key, the key will be created or replaced if its type differs.
+        template <typename ValueType>
+        static ValueType& Access(Stripe& stripe, std::string_view key)
+        {
+            auto& value = stripe.Entries[std::string(key)];
+            if (!std::holds_alternative<ValueType>(value)) value = ValueType();
+            return std::get<ValueType>(value);
+        }
+
+        /// Find the value of the given type of a key, null if the key is missing or its type differs.
+        template <typename ValueType>
+        static const ValueType* Find(const Stripe& stripe, const std::string& key)
+        {
+            auto finder = stripe.Entries.find(key);
+            if (finder == stripe.Entries.end()) return nullptr;
+            return std::get_if<ValueType>(&finder->second);
+        }
+
+        /// Erase an element from a hash or a set, and delete the key if it becomes empty like Redis does.
+        template <typename ContainerType>
+        static void Erase(Stripe& stripe, const std::string& key, const std::string& element)
+        {
+            auto finder = stripe.Entries.find(key);
+            if (finder == stripe.Entries.end()) return;
+            auto* container = std::get_if<ContainerType>(&finder->second);
+            if (!container) return;
+            container->erase(element);
+            if (container->empty()) stripe.Entries.erase(finder);
+        }
+
+        /**
+         * @brief Parse a stream ID such as "1700000000000-1", or "1700000000000" with the given sequence.
+         * @details "-" and "+" are the smallest and the greatest IDs, like in range queries of Redis.
+         */
+        static StreamID ParseStreamID(std::string_view text, unsigned long long default_sequence)
+        {
+            constexpr auto max_value = std::numeric_limits<unsigned long long>::max();
+            if (text == "-") return {0, 0};
+            if (text == "+") return {max_value, max_value};
+            auto separator = text.find('-');
+            auto milliseconds = std::stoull(std::string(text.substr(0, separator)));
+            if (separator == std::string_view::npos) return {milliseconds, default_sequence};
+            return {milliseconds, std::stoull(std::string(text.substr(separator + 1)))};
+        }
+
+        /**
+         * @brief Resolve the ID of an entry to append to a stream.
+         * @param stream Stream to append the entry to.
+         * @param text "*" for an ID from the current time, "<milliseconds>-*" for an ID from the given time,
+         *             or a complete ID.
+         * @return The ID, or nothing if it is not greater than the last ID of the stream.
+         */
+        static std::optional<StreamID> NextStreamID(const Stream& stream, std::string_view text)
+        {
+            StreamID id;
+            if (text == "*")
+            {
+                id.first = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count());
+                id.first = std::max(id.first, stream.LastID.first);
+            }
+            else if (text.size() > 2 && text.substr(text.size() - 2) == "-*")
+            {
+                id.first = std::stoull(std::string(text.substr(0, text.size() - 2)));
+            }
+            else
+            {
+                id = ParseStreamID(text, 0);
+                if (id <= stream.LastID) return std::nullopt;
+                return id;
+            }
+            if (id.first < stream.LastID.first) return std::nullopt;
+            if (id.first == stream.LastID.first) id.second = stream.LastID.second + 1;
+            return id;
+        }
+
+        /// Mutex for the message handlers.
+        std::mutex HandlersMutex;
+        /// Message handlers indexed by their IDs, along with their channels.
+        std::unordered_map<std::size_t, std::pair<std::string, MessageHandler>> Handlers;
+        /// ID of the next subscribed handler.
+        std::size_t NextHandlerID {1};
+
+        /// Invoke the handlers of the channel, outside of any lock so handlers can use this backend.
+        void Deliver(const std::string& channel, const std::string& message)
+        {
+            std::vector<MessageHandler> handlers;
+            {
+                std::unique_lock lock(HandlersMutex);
+                for (const auto& [id, subscription] : Handlers)
+                {
+                    if (subscription.first == channel) handlers.push_back(subscription.second);
+                }
+            }
+            for (const auto& handler : handlers)
+            {
+                handler(channel, message);
+            }
+        }
+
+        /// Batch which records operations and applies them in order.
+        class MemoryBatch : public StorageBatch
+        {
+        private:
+            /// Kind of a recorded operation.
+            enum class OperationKind
+            {
+                Set, Delete, HashSet, HashDelete, AddMember, RemoveMember, AddScoredMember,
+                Publish, AppendStream, StampChanges
+            };
+            /// Recorded operation.
+            struct Operation
+            {
+                OperationKind Kind;
+                std::string Key;
+                std::string Field;
+                std::string Value;
+                /// Score of a sorted set member, or max length of a stream.
+                long long Score {0};
+                /// ID of a stream entry.
+                std::string StreamID {};
+                /// Min ID of the entries kept in a stream.
+                std::string StreamMinID {};
+                /// Members stamped with a new generation.
+                std::vector<std::string> Members {};
+            };
+
+            /// Backend to apply operations on.
+            MemoryBackend& Backend;
+            /// Recorded operations.
+            std::vector<Operation> Operations;
+
+        public:
+            explicit MemoryBatch(MemoryBackend& backend) : Backend(backend)
+            {}
+
+            void Set(std::string_view key, std::string_view value) override
+            {
+                Operations.push_back({OperationKind::Set, std::string(key), {}, std::string(value)});
+            }
+
+            void Delete(std::string_view key) override
+            {
+                Operations.push_back({OperationKind::Delete, std::string(key), {}, {}});
+            }
+
+            void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+            {
+                Operations.push_back({OperationKind::HashSet, std::string(key), std::string(field),
+                                      std::string(value)});
+            }
+
+            void HashDelete(std::string_view key, std::string_view field) override
+            {
+                Operations.push_back({OperationKind::HashDelete, std::string(key), std::string(field), {}});
+            }
+
+            void AddMember(std::string_view key, std::string_view member) override
+            {
+                Operations.push_back({OperationKind::AddMember, std::string(key), {}, std::string(member)});
+            }
+
+            void RemoveMember(std::string_view key, std::string_view member) override
+            {
+                Operations.push_back({OperationKind::RemoveMember, std::string(key), {}, std::string(member)});
+            }
+
+            void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+            {
+                Operations.push_back({OperationKind::AddScoredMember, std::string(key), {}, std::string(member),
+                                      score});
+            }
+
+            void Publish(std::string_view channel, std::string_view message) override
+            {
+                Operations.push_back({OperationKind::Publish, std::string(channel), {}, std::string(message)});
+            }
+
+            void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                              std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+            {
+                Operations.push_back({OperationKind::AppendStream, std::string(key), std::string(timestamp),
+                                      std::string(value), static_cast<long long>(max_length),
+                                      std::string(id), std::string(min_id)});
+            }
+
+            void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                              const std::vector<std::string>& members) override
+            {
+                Operations.push_back({OperationKind::StampChanges, std::string(generation_key),
+                                      std::string(change_log_key), {}, 0, {}, {}, members});
+            }
+
+            /// Increment the generation and stamp the members, with both stripes locked so readers see them together.
+            void ApplyStampChanges(Operation& operation)
+            {
+                auto& generation_stripe = Backend.GetStripe(operation.Key);
+                auto& change_log_stripe = Backend.GetStripe(operation.Field);
+                std::unique_lock generation_lock(generation_stripe.Mutex, std::defer_lock);
+                std::unique_lock change_log_lock(change_log_stripe.Mutex, std::defer_lock);
+                if (&generation_stripe == &change_log_stripe)
+                {
+                    generation_lock.lock();
+                }
+                else
+                {
+                    std::lock(generation_lock, change_log_lock);
+                }
+                auto& generation_text = Access<std::string>(generation_stripe, operation.Key);
+                auto generation = std::strtoll(generation_text.c_str(), nullptr, 10) + 1;
+                generation_text = std::to_string(generation);
+                auto& change_log = Access<ScoredSet>(change_log_stripe, operation.Field);
+                for (auto& member : operation.Members)
+                {
+                    change_log[std::move(member)] = generation;
+                }
+            }
+
+            std::size_t Execute() override
+            {
+                // Messages are delivered after all operations are applied, like a Redis pipeline replies.
+                std::vector<std::pair<std::string, std::string>> messages;
+                std::size_t rejected_count = 0;
+                for (auto& operation : Operations)
+                {
+                    if (operation.Kind == OperationKind::Publish)
+                    {
+                        messages.emplace_back(std::move(operation.Key), std::move(operation.Value));
+                        continue;
+                    }
+                    if (operation.Kind == OperationKind::StampChanges)
+                    {
+                        ApplyStampChanges(operation);
+                        continue;
+                    }
+                    auto& stripe = Backend.GetStripe(operation.Key);
+                    std::unique_lock lock(stripe.Mutex);
+                    switch (operation.Kind)
+                    {
+                        case OperationKind::Set:
+                            stripe.Entries[operation.Key] = std::move(operation.Value);
+                            break;
+                        case OperationKind::Delete:
+                            stripe.Entries.erase(operation.Key);
+                            break;
+                        case OperationKind::HashSet:
+                            Access<std::unordered_map<std::string, std::string>>(stripe, operation.Key)
+                                    [operation.Field] = std::move(operation.Value);
+                            break;
+                        case OperationKind::HashDelete:
+                            Erase<std::unordered_map<std::string, std::string>>(stripe, operation.Key,
+                                                                                operation.Field);
+                            break;
+                        case OperationKind::AddMember:
+                            Access<std::unordered_set<std::string>>(stripe, operation.Key)
+                                    .insert(std::move(operation.Value));
+                            break;
+                        case OperationKind::RemoveMember:
+                            Erase<std::unordered_set<std::string>>(stripe, operation.Key, operation.Value);
+                            break;
+                        case OperationKind::AddScoredMember:
+                            Access<ScoredSet>(stripe, operation.Key)[std::move(operation.Value)] = operation.Score;
+                            break;
+                        case OperationKind::AppendStream:
+                        {
+                            auto& stream = Access<Stream>(stripe, operation.Key);
+                            auto id = NextStreamID(stream, operation.StreamID);
+                            // Like Redis, an entry whose ID is not greater than the last one is rejected.
+                            if (!id)
+                            {
+                                ++rejected_count;
+                                break;
+                            }
+                            stream.LastID = *id;
+                            stream.Entries.emplace_back(*id, StreamEntry{
+                                std::to_string(id->first) + "-" + std::to_string(id->second),
+                                std::move(operation.Value), std::move(operation.Field)});
+                            auto max_length = static_cast<std::size_t>(operation.Score);
+                            while (max_length > 0 && stream.Entries.size() > max_length)
+                            {
+                                stream.Entries.pop_front();
+                            }
+                            if (!operation.StreamMinID.empty())
+                            {
+                                auto min_id = ParseStreamID(operation.StreamMinID, 0);
+                                while (!stream.Entries.empty() && stream.Entries.front().first < min_id)
+                                {
+                                    stream.Entries.pop_front();
+                                }
+                            }
+                            break;
+                        }
+                        case OperationKind::Publish:
+                        case OperationKind::StampChanges:
+                            break;
+                    }
+                }
+                Operations.clear();
+                for (const auto& [channel, message] : messages)
+                {
+                    Backend.Deliver(channel, message);
+                }
+                return rejected_count;
+            }
+        };
+
+    public:
+        /**
+         * @brief Allocate the stripes.
+         * @param stripes_count Count of stripes, more stripes reduce the contention between threads.
+         */
+        explicit MemoryBackend(std::size_t stripes_count = 64) :
+            StripesCount(stripes_count > 0 ? stripes_count : 1),
+            Stripes(std::make_unique<Stripe[]>(StripesCount))
+        {}
+
+        std::unique_ptr<StorageBatch> CreateBatch() override
+        {
+            return std::make_unique<MemoryBatch>(*this);
+        }
+
+        std::optional<std::string> Get(const std::string& key) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            if (const auto* value = Find<std::string>(stripe, key)) return *value;
+            return std::nullopt;
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::optional<std::string>> values;
+            values.reserve(keys.size());
+            for (const auto& key : keys)
+            {
+                values.emplace_back(Get(key));
+            }
+            return values;
+        }
+
+        std::optional<std::string> HashGet(const std::string& key, const std::string& field) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* hash = Find<std::unordered_map<std::string, std::string>>(stripe, key);
+            if (!hash) return std::nullopt;
+            auto finder = hash->find(field);
+            if (finder == hash->end()) return std::nullopt;
+            return finder->second;
+        }
+
+        std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                             const std::vector<std::string>& fields) override
+        {
+            std::vector<std::optional<std::string>> values(fields.size());
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* hash = Find<std::unordered_map<std::string, std::string>>(stripe, key);
+            if (!hash) return values;
+            for (std::size_t index = 0; index < fields.size(); ++index)
+            {
+                auto finder = hash->find(fields[index]);
+                if (finder != hash->end()) values[index] = finder->second;
+            }
+            return values;
+        }
+
+        std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* hash = Find<std::unordered_map<std::string, std::string>>(stripe, key);
+            if (!hash) return {};
+            return *hash;
+        }
+
+        std::unordered_set<std::string> Members(const std::string& key) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* set = Find<std::unordered_set<std::string>>(stripe, key);
+            if (!set) return {};
+            return *set;
+        }
+
+        std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::unordered_set<std::string>> members;
+            members.reserve(keys.size());
+            for (const auto& key : keys)
+            {
+                members.emplace_back(Members(key));
+            }
+            return members;
+        }
+
+        /// All members are returned in one call, which Redis also does for small sets.
+        long long ScanMembers(const std::string& key, long long, std::size_t,
+                              std::vector<std::string>& members) override
+        {
+            auto set = Members(key);
+            members.insert(members.end(), set.begin(), set.end());
+            return 0;
+        }
+
+        /// Members are scanned linearly, which is fine for the small sorted sets used by the inspection.
+        std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                          long long min_score) override
+        {
+            std::vector<std::pair<std::string, long long>> members;
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* set = Find<ScoredSet>(stripe, key);
+            if (!set) return members;
+            for (const auto& [member, score] : *set)
+            {
+                if (score > min_score) members.emplace_back(member, score);
+            }
+            std::sort(members.begin(), members.end(), [](const auto& left, const auto& right){
+                return left.second < right.second;
+            });
+            return members;
+        }
+
+        void AddMembers(const std::string& key, const std::vector<std::string>& members) override
+        {
+            if (members.empty()) return;
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            auto& set = Access<std::unordered_set<std::string>>(stripe, key);
+            set.insert(members.begin(), members.end());
+        }
+
+        void RemoveMember(const std::string& key, const std::string& member) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            Erase<std::unordered_set<std::string>>(stripe, key, member);
+        }
+
+        void Delete(const std::string& key) override
+        {
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            stripe.Entries.erase(key);
+        }
+
+        /**
+         * @brief Get the entries of a stream whose IDs are in the given range, like XRANGE of Redis.
+         * @param key Key of the stream.
+         * @param start Smallest ID, "-" for the first entry, or milliseconds without a sequence.
+         * @param end Greatest ID, "+" for the last entry, or milliseconds without a sequence.
+         * @return Entries in ascending order of their IDs.
+         */
+        std::vector<StreamEntry> StreamRange(const std::string& key, std::string_view start, std::string_view end)
+        {
+            std::vector<StreamEntry> entries;
+            auto start_id = ParseStreamID(start, 0);
+            auto end_id = ParseStreamID(end, std::numeric_limits<unsigned long long>::max());
+            auto& stripe = GetStripe(key);
+            std::unique_lock lock(stripe.Mutex);
+            const auto* stream = Find<Stream>(stripe, key);
+            if (!stream) return entries;
+            for (const auto& [id, entry] : stream->Entries)
+            {
+                if (id >= start_id && id <= end_id) entries.push_back(entry);
+            }
+            return entries;
+        }
+
+        /**
+         * @brief Subscribe a channel in this process.
+         * @param channel Name of the channel.
+         * @param handler Handler invoked with each message published to the channel, on the publishing thread.
+         * @return ID of the subscription, used to unsubscribe.
+         */
+        std::size_t Subscribe(const std::string& channel, MessageHandler handler)
+        {
+            std::unique_lock lock(HandlersMutex);
+            auto id = NextHandlerID++;
+            Handlers.emplace(id, std::make_pair(channel, std::move(handler)));
+            return id;
+        }
+
+        /// Cancel the subscription with the given ID.
+        void Unsubscribe(std::size_t id)
+        {
+            std::unique_lock lock(HandlersMutex);
+            Handlers.erase(id);
+        }
+    };
+}
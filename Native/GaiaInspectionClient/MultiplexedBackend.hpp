@@ -0,0 +1,367 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include "StorageBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Backend shared by many clients, which merges their concurrent batches into common batches.
+     * @details
+     *  Batches record their operations, and executing a batch enqueues it as a commit. The first thread which
+     *  finds no flush in flight becomes the leader: it takes all queued commits, replays them into one batch of
+     *  the inner backend, and executes it, while later commits queue up for the next flush. So clients updating
+     *  at the same time share round trips, and a lone client pays no extra latency.
+     *  Operations of one batch stay contiguous and in order. Reads are forwarded to the inner backend directly.
+     */
+    class MultiplexedBackend : public StorageBackend
+    {
+    private:
+        /// Kind of a recorded operation.
+        enum class OperationKind
+        {
+            Set, Delete, HashSet, HashDelete, AddMember, RemoveMember, AddScoredMember,
+            Publish, AppendStream, StampChanges
+        };
+        /// Recorded operation.
+        struct Operation
+        {
+            OperationKind Kind;
+            std::string Key;
+            std::string Field;
+            std::string Value;
+            /// Score of a scored member, or the max length of a stream.
+            long long Number {0};
+            /// ID of a stream entry.
+            std::string StreamID {};
+            /// Min ID of the entries kept in a stream.
+            std::string StreamMinID {};
+            /// Members stamped with a new generation.
+            std::vector<std::string> Members {};
+        };
+
+        /// Operations of an executed batch waiting to be flushed.
+        struct QueuedCommit
+        {
+            std::vector<Operation>& Operations;
+            /// Whether this commit has been flushed, guarded by the commit mutex.
+            bool Done {false};
+            /// Error of the flush which contained this commit.
+            std::exception_ptr Error;
+            /// Count of stream entries rejected in the flush, only given to the leader's commit so it is counted once.
+            std::size_t RejectedCount {0};
+        };
+
+        /// Batch which records operations and commits them through the owner backend.
+        class MultiplexedBatch : public StorageBatch
+        {
+        private:
+            /// Backend to commit to.
+            MultiplexedBackend& Backend;
+            /// Recorded operations.
+            std::vector<Operation> Operations;
+
+        public:
+            explicit MultiplexedBatch(MultiplexedBackend& backend) : Backend(backend)
+            {}
+
+            void Set(std::string_view key, std::string_view value) override
+            {
+                Operations.push_back({OperationKind::Set, std::string(key), {}, std::string(value)});
+            }
+
+            void Delete(std::string_view key) override
+            {
+                Operations.push_back({OperationKind::Delete, std::string(key), {}, {}});
+            }
+
+            void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+            {
+                Operations.push_back({OperationKind::HashSet, std::string(key), std::string(field),
+                                      std::string(value)});
+            }
+
+            void HashDelete(std::string_view key, std::string_view field) override
+            {
+                Operations.push_back({OperationKind::HashDelete, std::string(key), std::string(field), {}});
+            }
+
+            void AddMember(std::string_view key, std::string_view member) override
+            {
+                Operations.push_back({OperationKind::AddMember, std::string(key), {}, std::string(member)});
+            }
+
+            void RemoveMember(std::string_view key, std::string_view member) override
+            {
+                Operations.push_back({OperationKind::RemoveMember, std::string(key), {}, std::string(member)});
+            }
+
+            void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+            {
+                Operations.push_back({OperationKind::AddScoredMember, std::string(key), {}, std::string(member),
+                                      score});
+            }
+
+            void Publish(std::string_view channel, std::string_view message) override
+            {
+                Operations.push_back({OperationKind::Publish, std::string(channel), {}, std::string(message)});
+            }
+
+            void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                              std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+            {
+                Operations.push_back({OperationKind::AppendStream, std::string(key), std::string(timestamp),
+                                      std::string(value), static_cast<long long>(max_length),
+                                      std::string(id), std::string(min_id)});
+            }
+
+            void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                              const std::vector<std::string>& members) override
+            {
+                Operations.push_back({OperationKind::StampChanges, std::string(generation_key),
+                                      std::string(change_log_key), {}, 0, {}, {}, members});
+            }
+
+            std::size_t Execute() override
+            {
+                if (Operations.empty()) return 0;
+                auto rejected_count = Backend.Commit(Operations);
+                Operations.clear();
+                return rejected_count;
+            }
+        };
+
+        /// Backend which executes the merged batches.
+        const std::shared_ptr<StorageBackend> Inner;
+
+        /// Mutex for the commit queue.
+        std::mutex CommitMutex;
+        /// Condition used to notify the waiting commits that a flush has finished.
+        std::condition_variable CommitCondition;
+        /// Commits waiting for the next flush.
+        std::vector<QueuedCommit*> PendingCommits;
+        /// Whether a leader is flushing.
+        bool Flushing {false};
+
+        /// Count of committed batches.
+        std::atomic<std::size_t> CommitsCount {0};
+        /// Count of batches executed on the inner backend.
+        std::atomic<std::size_t> FlushesCount {0};
+
+        /// Replay a recorded operation into a batch of the inner backend.
+        static void Replay(StorageBatch& batch, const Operation& operation)
+        {
+            switch (operation.Kind)
+            {
+                case OperationKind::Set:
+                    batch.Set(operation.Key, operation.Value);
+                    break;
+                case OperationKind::Delete:
+                    batch.Delete(operation.Key);
+                    break;
+                case OperationKind::HashSet:
+                    batch.HashSet(operation.Key, operation.Field, operation.Value);
+                    break;
+                case OperationKind::HashDelete:
+                    batch.HashDelete(operation.Key, operation.Field);
+                    break;
+                case OperationKind::AddMember:
+                    batch.AddMember(operation.Key, operation.Value);
+                    break;
+                case OperationKind::RemoveMember:
+                    batch.RemoveMember(operation.Key, operation.Value);
+                    break;
+                case OperationKind::AddScoredMember:
+                    batch.AddScoredMember(operation.Key, operation.Value, operation.Number);
+                    break;
+                case OperationKind::Publish:
+                    batch.Publish(operation.Key, operation.Value);
+                    break;
+                case OperationKind::AppendStream:
+                    batch.AppendStream(operation.Key, operation.StreamID, operation.Value, operation.Field,
+                                       static_cast<std::size_t>(operation.Number), operation.StreamMinID);
+                    break;
+                case OperationKind::StampChanges:
+                    batch.StampChanges(operation.Key, operation.Field, operation.Members);
+                    break;
+            }
+        }
+
+        /**
+         * @brief Commit the operations of a batch, and wait until they are flushed.
+         * @return Count of stream entries rejected in the flush if this thread executed it, otherwise 0.
+         * @throw The error of the flush which contained these operations.
+         */
+        std::size_t Commit(std::vector<Operation>& operations)
+        {
+            CommitsCount.fetch_add(1, std::memory_order_relaxed);
+            QueuedCommit commit {operations, false, nullptr};
+            std::unique_lock lock(CommitMutex);
+            PendingCommits.push_back(&commit);
+            while (!commit.Done)
+            {
+                if (Flushing)
+                {
+                    CommitCondition.wait(lock);
+                    continue;
+                }
+                // This thread becomes the leader, and flushes all commits queued so far, including its own.
+                Flushing = true;
+                auto commits = std::move(PendingCommits);
+                PendingCommits.clear();
+                lock.unlock();
+
+                std::exception_ptr error;
+                std::size_t rejected_count = 0;
+                try
+                {
+                    auto batch = Inner->CreateBatch();
+                    for (const auto* pending_commit : commits)
+                    {
+                        for (const auto& operation : pending_commit->Operations)
+                        {
+                            Replay(*batch, operation);
+                        }
+                    }
+                    rejected_count = batch->Execute();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                FlushesCount.fetch_add(1, std::memory_order_relaxed);
+
+                lock.lock();
+                for (auto* pending_commit : commits)
+                {
+                    pending_commit->Error = error;
+                    pending_commit->Done = true;
+                }
+                commit.RejectedCount = rejected_count;
+                Flushing = false;
+                CommitCondition.notify_all();
+            }
+            lock.unlock();
+            if (commit.Error) std::rethrow_exception(commit.Error);
+            return commit.RejectedCount;
+        }
+
+    public:
+        /**
+         * @brief Wrap the given backend.
+         * @param inner Backend to execute the merged batches and the reads.
+         * @throw std::runtime_error If the given backend is null.
+         */
+        explicit MultiplexedBackend(std::shared_ptr<StorageBackend> inner) : Inner(std::move(inner))
+        {
+            if (!Inner) throw std::runtime_error("Storage backend is null.");
+        }
+
+        /// Get the wrapped backend.
+        [[nodiscard]] const std::shared_ptr<StorageBackend>& GetInner() const noexcept
+        {
+            return Inner;
+        }
+
+        /// Get the count of committed batches.
+        [[nodiscard]] std::size_t GetCommitsCount() const noexcept
+        {
+            return CommitsCount.load(std::memory_order_relaxed);
+        }
+
+        /// Get the count of batches executed on the inner backend, at most the count of committed batches.
+        [[nodiscard]] std::size_t GetFlushesCount() const noexcept
+        {
+            return FlushesCount.load(std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<StorageBatch> CreateBatch() override
+        {
+            return std::make_unique<MultiplexedBatch>(*this);
+        }
+
+        std::optional<std::string> Get(const std::string& key) override
+        {
+            return Inner->Get(key);
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) override
+        {
+            return Inner->MultiGet(keys);
+        }
+
+        std::optional<std::string> HashGet(const std::string& key, const std::string& field) override
+        {
+            return Inner->HashGet(key, field);
+        }
+
+        std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                             const std::vector<std::string>& fields) override
+        {
+            return Inner->HashMultiGet(key, fields);
+        }
+
+        std::vector<std::vector<std::optional<std::string>>> MultiHashMultiGet(
+                const std::vector<std::string>& keys, const std::vector<std::vector<std::string>>& fields) override
+        {
+            return Inner->MultiHashMultiGet(keys, fields);
+        }
+
+        std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) override
+        {
+            return Inner->HashGetAll(key);
+        }
+
+        std::unordered_set<std::string> Members(const std::string& key) override
+        {
+            return Inner->Members(key);
+        }
+
+        std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) override
+        {
+            return Inner->MultiMembers(keys);
+        }
+
+        long long ScanMembers(const std::string& key, long long cursor, std::size_t count,
+                              std::vector<std::string>& members) override
+        {
+            return Inner->ScanMembers(key, cursor, count, members);
+        }
+
+        std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                          long long min_score) override
+        {
+            return Inner->ScoredMembersAbove(key, min_score);
+        }
+
+        void AddMembers(const std::string& key, const std::vector<std::string>& members) override
+        {
+            Inner->AddMembers(key, members);
+        }
+
+        void RemoveMember(const std::string& key, const std::string& member) override
+        {
+            Inner->RemoveMember(key, member);
+        }
+
+        void Delete(const std::string& key) override
+        {
+            Inner->Delete(key);
+        }
+
+        [[nodiscard]] bool IsClustered() const noexcept override
+        {
+            return Inner->IsClustered();
+        }
+
+        [[nodiscard]] bool SupportsTimedStreamIDs() override
+        {
+            return Inner->SupportsTimedStreamIDs();
+        }
+    };
+}
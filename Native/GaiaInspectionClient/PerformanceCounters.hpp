@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Histogram of durations with power-of-two buckets, which can be recorded concurrently.
+     * @details
+     *  Bucket 0 counts durations shorter than 1 microsecond, bucket i counts durations in [2^(i-1), 2^i) microseconds,
+     *  and the last bucket also counts all longer durations. Recording costs a few relaxed atomic additions.
+     */
+    class LatencyHistogram
+    {
+    public:
+        /// Count of buckets, the last one starts from about 16 milliseconds.
+        static constexpr std::size_t BucketsCount = 16;
+
+        /// Snapshot of a histogram.
+        struct Snapshot
+        {
+            /// Counts of durations in each bucket.
+            std::array<std::uint64_t, BucketsCount> Buckets {};
+            /// Count of all durations.
+            std::uint64_t Count {0};
+            /// Sum of all durations.
+            std::chrono::nanoseconds Total {0};
+            /// Longest duration.
+            std::chrono::nanoseconds Max {0};
+
+            /**
+             * @brief Estimate a percentile with the upper bound of the bucket where it falls.
+             * @param percentile Percentile in [0, 1].
+             * @return Estimated duration, or the max duration if it falls in the last bucket.
+             */
+            [[nodiscard]] std::chrono::nanoseconds GetPercentile(double percentile) const noexcept
+            {
+                if (Count == 0) return std::chrono::nanoseconds(0);
+                auto target = static_cast<std::uint64_t>(percentile * static_cast<double>(Count - 1)) + 1;
+                std::uint64_t accumulated = 0;
+                for (std::size_t index = 0; index + 1 < BucketsCount; ++index)
+                {
+                    accumulated += Buckets[index];
+                    if (accumulated >= target)
+                    {
+                        return std::min(std::chrono::nanoseconds(std::chrono::microseconds(1LL << index)), Max);
+                    }
+                }
+                return Max;
+            }
+        };
+
+    private:
+        std::array<std::atomic<std::uint64_t>, BucketsCount> Buckets {};
+        std::atomic<std::uint64_t> Count {0};
+        std::atomic<std::uint64_t> TotalNanoseconds {0};
+        std::atomic<std::uint64_t> MaxNanoseconds {0};
+
+    public:
+        /// Record a duration.
+        void Record(std::chrono::steady_clock::duration duration) noexcept
+        {
+            auto nanoseconds = static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+            std::size_t index = 0;
+            for (auto microseconds = nanoseconds / 1000; microseconds > 0 && index + 1 < BucketsCount;
+                 microseconds >>= 1)
+            {
+                ++index;
+            }
+            Buckets[index].fetch_add(1, std::memory_order_relaxed);
+            Count.fetch_add(1, std::memory_order_relaxed);
+            TotalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+            auto max = MaxNanoseconds.load(std::memory_order_relaxed);
+            while (nanoseconds > max &&
+                   !MaxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed));
+        }
+
+        /// Take a snapshot, which may be slightly inconsistent while durations are being recorded.
+        [[nodiscard]] Snapshot TakeSnapshot() const noexcept
+        {
+            Snapshot snapshot;
+            for (std::size_t index = 0; index < BucketsCount; ++index)
+            {
+                snapshot.Buckets[index] = Buckets[index].load(std::memory_order_relaxed);
+            }
+            snapshot.Count = Count.load(std::memory_order_relaxed);
+            snapshot.Total = std::chrono::nanoseconds(TotalNanoseconds.load(std::memory_order_relaxed));
+            snapshot.Max = std::chrono::nanoseconds(MaxNanoseconds.load(std::memory_order_relaxed));
+            return snapshot;
+        }
+    };
+
+    /**
+     * @brief Performance counters of an inspection client, cheap enough to be always on.
+     * @details All counters are relaxed atomics, they are monotonic since the client was constructed.
+     */
+    struct PerformanceCounters
+    {
+        /// Count of storage commands issued, such as SET, HSET, SADD and PUBLISH.
+        std::atomic<std::uint64_t> Commands {0};
+        /// Bytes of keys, fields and values sent, excluding the protocol overhead.
+        std::atomic<std::uint64_t> BytesSent {0};
+        /// Count of values sent.
+        std::atomic<std::uint64_t> SentValues {0};
+        /// Count of values skipped because they have not changed or they are rate limited.
+        std::atomic<std::uint64_t> SkippedValues {0};
+        /// Count of probes skipped because they overran the time budget or were still running.
+        std::atomic<std::uint64_t> StaleProbes {0};
+        /// Count of batches flushed to the storage.
+        std::atomic<std::uint64_t> Flushes {0};
+        /// Count of failed flushes and commands.
+        std::atomic<std::uint64_t> Errors {0};
+        /// Count of history entries rejected by the storage because they were not newer than the latest entries.
+        std::atomic<std::uint64_t> RejectedStreamEntries {0};
+        /// Durations of probe evaluations.
+        LatencyHistogram ProbeEvaluation;
+        /// Durations of flushes, which are round trips for Redis.
+        LatencyHistogram FlushLatency;
+
+        /// Snapshot of the counters.
+        struct Snapshot
+        {
+            std::uint64_t Commands {0};
+            std::uint64_t BytesSent {0};
+            std::uint64_t SentValues {0};
+            std::uint64_t SkippedValues {0};
+            std::uint64_t StaleProbes {0};
+            std::uint64_t Flushes {0};
+            std::uint64_t Errors {0};
+            std::uint64_t RejectedStreamEntries {0};
+            LatencyHistogram::Snapshot ProbeEvaluation;
+            LatencyHistogram::Snapshot FlushLatency;
+        };
+
+        /// Take a snapshot of the counters.
+        [[nodiscard]] Snapshot TakeSnapshot() const noexcept
+        {
+            Snapshot snapshot;
+            snapshot.Commands = Commands.load(std::memory_order_relaxed);
+            snapshot.BytesSent = BytesSent.load(std::memory_order_relaxed);
+            snapshot.SentValues = SentValues.load(std::memory_order_relaxed);
+            snapshot.SkippedValues = SkippedValues.load(std::memory_order_relaxed);
+            snapshot.StaleProbes = StaleProbes.load(std::memory_order_relaxed);
+            snapshot.Flushes = Flushes.load(std::memory_order_relaxed);
+            snapshot.Errors = Errors.load(std::memory_order_relaxed);
+            snapshot.RejectedStreamEntries = RejectedStreamEntries.load(std::memory_order_relaxed);
+            snapshot.ProbeEvaluation = ProbeEvaluation.TakeSnapshot();
+            snapshot.FlushLatency = FlushLatency.TakeSnapshot();
+            return snapshot;
+        }
+    };
+}
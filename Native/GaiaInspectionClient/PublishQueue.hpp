@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Bounded lock-free queue for multiple producers and a single consumer.
+     * @tparam ElementType Type of the elements, should be default constructible and movable.
+     * @details
+     *  Each cell carries a sequence number which tells whether it is ready to be written or read,
+     *  so producers only contend on one atomic counter and never take a lock.
+     *  The capacity will be rounded up to a power of 2.
+     */
+    template <typename ElementType>
+    class PublishQueue
+    {
+    private:
+        /// Slot of the ring buffer.
+        struct Cell
+        {
+            /// Sequence number used to synchronize producers and the consumer.
+            std::atomic<std::size_t> Sequence;
+            /// Stored element.
+            ElementType Element;
+        };
+
+        /// Size of a cache line, used to avoid false sharing between the counters.
+        static constexpr std::size_t CacheLineSize = 64;
+
+        /// Mask for the index of cells.
+        const std::size_t Mask;
+        /// Ring buffer of cells.
+        std::unique_ptr<Cell[]> Cells;
+
+        /// Position of the next cell to push into.
+        alignas(CacheLineSize) std::atomic<std::size_t> PushPosition {0};
+        /// Position of the next cell to pop from.
+        alignas(CacheLineSize) std::atomic<std::size_t> PopPosition {0};
+
+        /// Round the given capacity up to a power of 2.
+        static std::size_t RoundCapacity(std::size_t capacity) noexcept
+        {
+            std::size_t result = 2;
+            while (result < capacity) result <<= 1;
+            return result;
+        }
+
+    public:
+        /**
+         * @brief Allocate the ring buffer.
+         * @param capacity Max count of elements that can be stored in this queue.
+         */
+        explicit PublishQueue(std::size_t capacity) :
+            Mask(RoundCapacity(capacity) - 1), Cells(new Cell[Mask + 1])
+        {
+            for (std::size_t index = 0; index <= Mask; ++index)
+            {
+                Cells[index].Sequence.store(index, std::memory_order_relaxed);
+            }
+        }
+
+        PublishQueue(const PublishQueue&) = delete;
+        PublishQueue& operator=(const PublishQueue&) = delete;
+
+        /// Get the max count of elements that can be stored in this queue.
+        [[nodiscard]] std::size_t GetCapacity() const noexcept
+        {
+            return Mask + 1;
+        }
+
+        /**
+         * @brief Try to push an element into the queue, can be called from any thread.
+         * @param element Element to move into the queue.
+         * @retval true The element has been moved into the queue.
+         * @retval false The queue is full, and the element is left untouched.
+         */
+        bool TryPush(ElementType&& element)
+        {
+            auto position = PushPosition.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true)
+            {
+                cell = &Cells[position & Mask];
+                auto sequence = cell->Sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0)
+                {
+                    if (PushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = PushPosition.load(std::memory_order_relaxed);
+                }
+            }
+            cell->Element = std::move(element);
+            cell->Sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Try to pop an element from the queue, should only be called from the consumer thread.
+         * @param element Element to move the popped element into.
+         * @retval true An element has been popped.
+         * @retval false The queue is empty.
+         */
+        bool TryPop(ElementType& element)
+        {
+            auto position = PopPosition.load(std::memory_order_relaxed);
+            auto& cell = Cells[position & Mask];
+            auto sequence = cell.Sequence.load(std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1) < 0)
+            {
+                return false;
+            }
+            PopPosition.store(position + 1, std::memory_order_relaxed);
+            element = std::move(cell.Element);
+            cell.Sequence.store(position + Mask + 1, std::memory_order_release);
+            return true;
+        }
+    };
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <sw/redis++/redis++.h>
+#include <stdexcept>
+#include <cstdlib>
+#include "StorageBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Storage backend on a Redis server.
+     * @details Batches are sent in one round trip with a pipeline.
+     */
+    class RedisBackend : public StorageBackend
+    {
+    private:
+        /// Batch which records operations into a pipeline.
+        class RedisBatch : public StorageBatch
+        {
+        private:
+            /// Pipeline to record operations.
+            sw::redis::Pipeline Pipeline;
+
+        public:
+            explicit RedisBatch(sw::redis::Pipeline pipeline) : Pipeline(std::move(pipeline))
+            {}
+
+            void Set(std::string_view key, std::string_view value) override
+            {
+                Pipeline.set(key, value);
+            }
+
+            void Delete(std::string_view key) override
+            {
+                Pipeline.del(key);
+            }
+
+            void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+            {
+                Pipeline.hset(key, field, value);
+            }
+
+            void HashDelete(std::string_view key, std::string_view field) override
+            {
+                Pipeline.hdel(key, field);
+            }
+
+            void AddMember(std::string_view key, std::string_view member) override
+            {
+                Pipeline.sadd(key, member);
+            }
+
+            void RemoveMember(std::string_view key, std::string_view member) override
+            {
+                Pipeline.srem(key, member);
+            }
+
+            void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+            {
+                Pipeline.command("ZADD", key, std::to_string(score), member);
+            }
+
+            void Publish(std::string_view channel, std::string_view message) override
+            {
+                Pipeline.publish(channel, message);
+            }
+
+            void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                              std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+            {
+                QueueAppendStream(Pipeline, key, id, value, timestamp, max_length, min_id);
+            }
+
+            void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                              const std::vector<std::string>& members) override
+            {
+                QueueStampChanges(Pipeline, generation_key, change_log_key, members);
+            }
+
+            std::size_t Execute() override
+            {
+                auto replies = Pipeline.exec();
+                return CheckReplies(replies);
+            }
+        };
+
+        /// Connection to the Redis server.
+        const std::shared_ptr<sw::redis::Redis> Connection;
+
+    public:
+        /**
+         * @brief Queue the XADD of a stream entry, see StorageBatch::AppendStream(...).
+         * @details XADD accepts one trimming strategy, so the age limit falls back to XTRIM when both are given.
+         */
+        static void QueueAppendStream(sw::redis::Pipeline& pipeline, std::string_view key, std::string_view id,
+                                      std::string_view value, std::string_view timestamp, std::size_t max_length,
+                                      std::string_view min_id)
+        {
+            if (max_length > 0)
+            {
+                pipeline.command("XADD", key, "MAXLEN", "~", std::to_string(max_length),
+                                 id, "value", value, "timestamp", timestamp);
+                if (!min_id.empty()) pipeline.command("XTRIM", key, "MINID", "~", min_id);
+            }
+            else if (!min_id.empty())
+            {
+                pipeline.command("XADD", key, "MINID", "~", min_id, id, "value", value, "timestamp", timestamp);
+            }
+            else
+            {
+                pipeline.command("XADD", key, id, "value", value, "timestamp", timestamp);
+            }
+        }
+
+        /**
+         * @brief Queue the script which stamps changes, see StorageBatch::StampChanges(...).
+         * @details Both keys of a unit share its hash tag, so the script can also run on a cluster.
+         */
+        static void QueueStampChanges(sw::redis::Pipeline& pipeline, std::string_view generation_key,
+                                      std::string_view change_log_key, const std::vector<std::string>& members)
+        {
+            static constexpr std::string_view script =
+                    "local generation = redis.call('INCR', KEYS[1]) "
+                    "for _, member in ipairs(ARGV) do redis.call('ZADD', KEYS[2], generation, member) end "
+                    "return generation";
+            std::vector<std::string_view> arguments {"EVAL", script, "2", generation_key, change_log_key};
+            arguments.insert(arguments.end(), members.begin(), members.end());
+            pipeline.command(arguments.begin(), arguments.end());
+        }
+
+        /**
+         * @brief Check the replies of an executed pipeline.
+         * @return Count of XADD commands rejected because their IDs were not greater than the last ones.
+         * @throw sw::redis::Error The first other error reply, such as WRONGTYPE or OOM.
+         * @details Error replies of a pipeline are only raised when they are accessed, so each reply is accessed.
+         */
+        static std::size_t CheckReplies(sw::redis::QueuedReplies& replies)
+        {
+            std::size_t rejected_count = 0;
+            for (std::size_t index = 0; index < replies.size(); ++index)
+            {
+                try
+                {
+                    replies.get(index);
+                }
+                catch (const sw::redis::ReplyError& error)
+                {
+                    if (std::string_view(error.what()).find("The ID specified in XADD") == std::string_view::npos)
+                    {
+                        throw;
+                    }
+                    ++rejected_count;
+                }
+            }
+            return rejected_count;
+        }
+
+        /**
+         * @brief Check whether the INFO text of a server reports Redis 7.0 or later.
+         * @param info Text of the "server" section of INFO.
+         */
+        static bool IsVersionSupportingTimedStreamIDs(const std::string& info)
+        {
+            constexpr std::string_view version_field = "redis_version:";
+            auto position = info.find(version_field);
+            if (position == std::string::npos) return false;
+            return std::strtol(info.c_str() + position + version_field.size(), nullptr, 10) >= 7;
+        }
+
+        /**
+         * @brief Use the given connection.
+         * @param connection Connection to the Redis server.
+         * @throw std::runtime_error If the connection is null.
+         */
+        explicit RedisBackend(std::shared_ptr<sw::redis::Redis> connection) : Connection(std::move(connection))
+        {
+            if (!Connection) throw std::runtime_error("Connection to Redis is null.");
+        }
+
+        /// Get the connection, used by the features which only Redis provides, such as streams and messaging.
+        [[nodiscard]] const std::shared_ptr<sw::redis::Redis>& GetConnection() const noexcept
+        {
+            return Connection;
+        }
+
+        std::unique_ptr<StorageBatch> CreateBatch() override
+        {
+            return std::make_unique<RedisBatch>(Connection->pipeline(false));
+        }
+
+        [[nodiscard]] bool SupportsTimedStreamIDs() override
+        {
+            return IsVersionSupportingTimedStreamIDs(Connection->info("server"));
+        }
+
+        std::optional<std::string> Get(const std::string& key) override
+        {
+            return Connection->get(key);
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::optional<std::string>> values;
+            if (keys.empty()) return values;
+            values.reserve(keys.size());
+            Connection->mget(keys.begin(), keys.end(), std::back_inserter(values));
+            return values;
+        }
+
+        std::optional<std::string> HashGet(const std::string& key, const std::string& field) override
+        {
+            return Connection->hget(key, field);
+        }
+
+        std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                             const std::vector<std::string>& fields) override
+        {
+            std::vector<std::optional<std::string>> values;
+            if (fields.empty()) return values;
+            values.reserve(fields.size());
+            Connection->hmget(key, fields.begin(), fields.end(), std::back_inserter(values));
+            return values;
+        }
+
+        std::vector<std::vector<std::optional<std::string>>> MultiHashMultiGet(
+                const std::vector<std::string>& keys, const std::vector<std::vector<std::string>>& fields) override
+        {
+            std::vector<std::vector<std::optional<std::string>>> values(keys.size());
+            auto pipeline = Connection->pipeline(false);
+            std::size_t commands_count = 0;
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                if (fields[index].empty()) continue;
+                pipeline.hmget(keys[index], fields[index].begin(), fields[index].end());
+                ++commands_count;
+            }
+            if (commands_count == 0) return values;
+            auto replies = pipeline.exec();
+            std::size_t reply_index = 0;
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                if (fields[index].empty()) continue;
+                replies.get(reply_index++, std::back_inserter(values[index]));
+            }
+            return values;
+        }
+
+        std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) override
+        {
+            std::unordered_map<std::string, std::string> values;
+            Connection->hgetall(key, std::inserter(values, values.end()));
+            return values;
+        }
+
+        std::unordered_set<std::string> Members(const std::string& key) override
+        {
+            std::unordered_set<std::string> members;
+            Connection->smembers(key, std::inserter(members, members.end()));
+            return members;
+        }
+
+        std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::unordered_set<std::string>> members;
+            if (keys.empty()) return members;
+            auto pipeline = Connection->pipeline(false);
+            for (const auto& key : keys)
+            {
+                pipeline.smembers(key);
+            }
+            auto replies = pipeline.exec();
+            members.reserve(keys.size());
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                members.emplace_back(replies.get<std::unordered_set<std::string>>(index));
+            }
+            return members;
+        }
+
+        long long ScanMembers(const std::string& key, long long cursor, std::size_t count,
+                              std::vector<std::string>& members) override
+        {
+            return Connection->sscan(key, cursor, static_cast<long long>(count), std::back_inserter(members));
+        }
+
+        std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                          long long min_score) override
+        {
+            std::vector<std::string> arguments {"ZRANGEBYSCORE", key, "(" + std::to_string(min_score), "+inf",
+                                                "WITHSCORES"};
+            std::vector<std::string> replies;
+            Connection->command(arguments.begin(), arguments.end(), std::back_inserter(replies));
+            std::vector<std::pair<std::string, long long>> members;
+            members.reserve(replies.size() / 2);
+            for (std::size_t index = 0; index + 1 < replies.size(); index += 2)
+            {
+                members.emplace_back(std::move(replies[index]), std::stoll(replies[index + 1]));
+            }
+            return members;
+        }
+
+        void AddMembers(const std::string& key, const std::vector<std::string>& members) override
+        {
+            if (members.empty()) return;
+            Connection->sadd(key, members.begin(), members.end());
+        }
+
+        void RemoveMember(const std::string& key, const std::string& member) override
+        {
+            Connection->srem(key, member);
+        }
+
+        void Delete(const std::string& key) override
+        {
+            Connection->del(key);
+        }
+    };
+}
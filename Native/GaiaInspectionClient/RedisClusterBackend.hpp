@@ -0,0 +1,373 @@
+#pragma once
+
+#include <sw/redis++/redis++.h>
+#include <functional>
+#include <stdexcept>
+#include <exception>
+#include "StorageBackend.hpp"
+#include "RedisBackend.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Storage backend on a Redis Cluster.
+     * @details
+     *  Keys of a unit carry the hash tag "{<unit>}", so they live in one slot. Operations of a batch are grouped
+     *  by the hash tags of their keys, and each group is sent in one pipeline to the node which owns its slot,
+     *  so a batch of one unit still costs one round trip.
+     */
+    class RedisClusterBackend : public StorageBackend
+    {
+    public:
+        /**
+         * @brief Get the hash tag of a key, which decides its slot like Redis Cluster does.
+         * @return Text in the first braces if it is not empty, otherwise the whole key.
+         */
+        static std::string_view GetHashTag(std::string_view key) noexcept
+        {
+            auto begin = key.find('{');
+            if (begin == std::string_view::npos) return key;
+            auto end = key.find('}', begin + 1);
+            if (end == std::string_view::npos || end == begin + 1) return key;
+            return key.substr(begin + 1, end - begin - 1);
+        }
+
+    private:
+        /// Batch which records operations and sends them in one pipeline per hash tag.
+        class ClusterBatch : public StorageBatch
+        {
+        private:
+            /// Recorded operation, which is replayed into the pipeline of its hash tag.
+            using Operation = std::function<void(sw::redis::Pipeline&)>;
+
+            /// Operations of one hash tag.
+            struct Group
+            {
+                std::string HashTag;
+                std::vector<Operation> Operations;
+            };
+
+            /// Connection to the Redis Cluster.
+            sw::redis::RedisCluster& Connection;
+            /// Groups of operations in the order of their first operations.
+            std::vector<Group> Groups;
+            /// Indexes of groups by their hash tags.
+            std::unordered_map<std::string, std::size_t> GroupIndexes;
+
+            /// Record an operation on the given key.
+            void Record(std::string_view key, Operation operation)
+            {
+                auto hash_tag = std::string(GetHashTag(key));
+                auto [finder, inserted] = GroupIndexes.emplace(hash_tag, Groups.size());
+                if (inserted) Groups.push_back(Group{std::move(hash_tag), {}});
+                Groups[finder->second].Operations.push_back(std::move(operation));
+            }
+
+        public:
+            explicit ClusterBatch(sw::redis::RedisCluster& connection) : Connection(connection)
+            {}
+
+            void Set(std::string_view key, std::string_view value) override
+            {
+                Record(key, [key = std::string(key), value = std::string(value)](sw::redis::Pipeline& pipeline){
+                    pipeline.set(key, value);
+                });
+            }
+
+            void Delete(std::string_view key) override
+            {
+                Record(key, [key = std::string(key)](sw::redis::Pipeline& pipeline){
+                    pipeline.del(key);
+                });
+            }
+
+            void HashSet(std::string_view key, std::string_view field, std::string_view value) override
+            {
+                Record(key, [key = std::string(key), field = std::string(field), value = std::string(value)]
+                        (sw::redis::Pipeline& pipeline){
+                    pipeline.hset(key, field, value);
+                });
+            }
+
+            void HashDelete(std::string_view key, std::string_view field) override
+            {
+                Record(key, [key = std::string(key), field = std::string(field)](sw::redis::Pipeline& pipeline){
+                    pipeline.hdel(key, field);
+                });
+            }
+
+            void AddMember(std::string_view key, std::string_view member) override
+            {
+                Record(key, [key = std::string(key), member = std::string(member)](sw::redis::Pipeline& pipeline){
+                    pipeline.sadd(key, member);
+                });
+            }
+
+            void RemoveMember(std::string_view key, std::string_view member) override
+            {
+                Record(key, [key = std::string(key), member = std::string(member)](sw::redis::Pipeline& pipeline){
+                    pipeline.srem(key, member);
+                });
+            }
+
+            void AddScoredMember(std::string_view key, std::string_view member, long long score) override
+            {
+                Record(key, [key = std::string(key), member = std::string(member), score]
+                        (sw::redis::Pipeline& pipeline){
+                    pipeline.command("ZADD", key, std::to_string(score), member);
+                });
+            }
+
+            /// Messages are propagated to the whole cluster, so they are sent along with the unit of the channel.
+            void Publish(std::string_view channel, std::string_view message) override
+            {
+                Record(channel, [channel = std::string(channel), message = std::string(message)]
+                        (sw::redis::Pipeline& pipeline){
+                    pipeline.publish(channel, message);
+                });
+            }
+
+            void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                              std::string_view timestamp, std::size_t max_length, std::string_view min_id) override
+            {
+                Record(key, [key = std::string(key), id = std::string(id), value = std::string(value),
+                             timestamp = std::string(timestamp), max_length, min_id = std::string(min_id)]
+                        (sw::redis::Pipeline& pipeline){
+                    RedisBackend::QueueAppendStream(pipeline, key, id, value, timestamp, max_length, min_id);
+                });
+            }
+
+            void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                              const std::vector<std::string>& members) override
+            {
+                Record(generation_key, [generation_key = std::string(generation_key),
+                                        change_log_key = std::string(change_log_key), members]
+                        (sw::redis::Pipeline& pipeline){
+                    RedisBackend::QueueStampChanges(pipeline, generation_key, change_log_key, members);
+                });
+            }
+
+            /// Send the pipeline of each group, then throw the first error if any group failed.
+            std::size_t Execute() override
+            {
+                auto groups = std::move(Groups);
+                Groups.clear();
+                GroupIndexes.clear();
+                // Groups live on different nodes, so a failed group does not stop the others.
+                std::exception_ptr error;
+                std::size_t rejected_count = 0;
+                for (auto& group : groups)
+                {
+                    try
+                    {
+                        auto pipeline = Connection.pipeline(group.HashTag, false);
+                        for (auto& operation : group.Operations)
+                        {
+                            operation(pipeline);
+                        }
+                        auto replies = pipeline.exec();
+                        rejected_count += RedisBackend::CheckReplies(replies);
+                    }
+                    catch (...)
+                    {
+                        if (!error) error = std::current_exception();
+                    }
+                }
+                if (error) std::rethrow_exception(error);
+                return rejected_count;
+            }
+        };
+
+        /// Connection to the Redis Cluster.
+        const std::shared_ptr<sw::redis::RedisCluster> Connection;
+
+        /**
+         * @brief Group the indexes of the given keys by their hash tags.
+         * @return Indexes of keys of each hash tag, in the order of their first keys.
+         */
+        static std::vector<std::vector<std::size_t>> GroupByHashTag(const std::vector<std::string>& keys)
+        {
+            std::vector<std::vector<std::size_t>> groups;
+            std::unordered_map<std::string_view, std::size_t> group_indexes;
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                auto [finder, inserted] = group_indexes.emplace(GetHashTag(keys[index]), groups.size());
+                if (inserted) groups.emplace_back();
+                groups[finder->second].push_back(index);
+            }
+            return groups;
+        }
+
+    public:
+        /**
+         * @brief Use the given connection.
+         * @param connection Connection to the Redis Cluster.
+         * @throw std::runtime_error If the connection is null.
+         */
+        explicit RedisClusterBackend(std::shared_ptr<sw::redis::RedisCluster> connection) :
+            Connection(std::move(connection))
+        {
+            if (!Connection) throw std::runtime_error("Connection to Redis Cluster is null.");
+        }
+
+        /// Get the connection to the Redis Cluster.
+        [[nodiscard]] const std::shared_ptr<sw::redis::RedisCluster>& GetConnection() const noexcept
+        {
+            return Connection;
+        }
+
+        [[nodiscard]] bool IsClustered() const noexcept override
+        {
+            return true;
+        }
+
+        std::unique_ptr<StorageBatch> CreateBatch() override
+        {
+            return std::make_unique<ClusterBatch>(*Connection);
+        }
+
+        /// Check the version of the node which owns the slot of the empty hash tag, nodes are assumed to be uniform.
+        [[nodiscard]] bool SupportsTimedStreamIDs() override
+        {
+            return RedisBackend::IsVersionSupportingTimedStreamIDs(Connection->redis("", false).info("server"));
+        }
+
+        std::optional<std::string> Get(const std::string& key) override
+        {
+            return Connection->get(key);
+        }
+
+        /// Keys in different slots are read with one MGET per hash tag.
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::optional<std::string>> values(keys.size());
+            std::vector<std::string> group_keys;
+            std::vector<std::optional<std::string>> group_values;
+            for (const auto& group : GroupByHashTag(keys))
+            {
+                group_keys.clear();
+                group_values.clear();
+                for (auto index : group) group_keys.push_back(keys[index]);
+                Connection->mget(group_keys.begin(), group_keys.end(), std::back_inserter(group_values));
+                for (std::size_t index = 0; index < group.size() && index < group_values.size(); ++index)
+                {
+                    values[group[index]] = std::move(group_values[index]);
+                }
+            }
+            return values;
+        }
+
+        std::optional<std::string> HashGet(const std::string& key, const std::string& field) override
+        {
+            return Connection->hget(key, field);
+        }
+
+        std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                             const std::vector<std::string>& fields) override
+        {
+            std::vector<std::optional<std::string>> values;
+            if (fields.empty()) return values;
+            values.reserve(fields.size());
+            Connection->hmget(key, fields.begin(), fields.end(), std::back_inserter(values));
+            return values;
+        }
+
+        /// Hashes in different slots are read with one pipeline per hash tag.
+        std::vector<std::vector<std::optional<std::string>>> MultiHashMultiGet(
+                const std::vector<std::string>& keys, const std::vector<std::vector<std::string>>& fields) override
+        {
+            std::vector<std::vector<std::optional<std::string>>> values(keys.size());
+            for (const auto& group : GroupByHashTag(keys))
+            {
+                auto pipeline = Connection->pipeline(GetHashTag(keys[group.front()]), false);
+                std::vector<std::size_t> requested_indexes;
+                for (auto index : group)
+                {
+                    if (fields[index].empty()) continue;
+                    pipeline.hmget(keys[index], fields[index].begin(), fields[index].end());
+                    requested_indexes.push_back(index);
+                }
+                if (requested_indexes.empty()) continue;
+                auto replies = pipeline.exec();
+                for (std::size_t reply_index = 0; reply_index < requested_indexes.size(); ++reply_index)
+                {
+                    replies.get(reply_index, std::back_inserter(values[requested_indexes[reply_index]]));
+                }
+            }
+            return values;
+        }
+
+        std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) override
+        {
+            std::unordered_map<std::string, std::string> values;
+            Connection->hgetall(key, std::inserter(values, values.end()));
+            return values;
+        }
+
+        std::unordered_set<std::string> Members(const std::string& key) override
+        {
+            std::unordered_set<std::string> members;
+            Connection->smembers(key, std::inserter(members, members.end()));
+            return members;
+        }
+
+        /// Sets in different slots are read with one pipeline per hash tag.
+        std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) override
+        {
+            std::vector<std::unordered_set<std::string>> members(keys.size());
+            for (const auto& group : GroupByHashTag(keys))
+            {
+                auto pipeline = Connection->pipeline(GetHashTag(keys[group.front()]), false);
+                for (auto index : group)
+                {
+                    pipeline.smembers(keys[index]);
+                }
+                auto replies = pipeline.exec();
+                for (std::size_t index = 0; index < group.size(); ++index)
+                {
+                    members[group[index]] = replies.get<std::unordered_set<std::string>>(index);
+                }
+            }
+            return members;
+        }
+
+        long long ScanMembers(const std::string& key, long long cursor, std::size_t count,
+                              std::vector<std::string>& members) override
+        {
+            return Connection->sscan(key, cursor, static_cast<long long>(count), std::back_inserter(members));
+        }
+
+        std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                          long long min_score) override
+        {
+            // The key is the second argument, which Redis Cluster uses to route the command.
+            std::vector<std::string> arguments {"ZRANGEBYSCORE", key, "(" + std::to_string(min_score), "+inf",
+                                                "WITHSCORES"};
+            std::vector<std::string> replies;
+            Connection->command(arguments.begin(), arguments.end(), std::back_inserter(replies));
+            std::vector<std::pair<std::string, long long>> members;
+            members.reserve(replies.size() / 2);
+            for (std::size_t index = 0; index + 1 < replies.size(); index += 2)
+            {
+                members.emplace_back(std::move(replies[index]), std::stoll(replies[index + 1]));
+            }
+            return members;
+        }
+
+        void AddMembers(const std::string& key, const std::vector<std::string>& members) override
+        {
+            if (members.empty()) return;
+            Connection->sadd(key, members.begin(), members.end());
+        }
+
+        void RemoveMember(const std::string& key, const std::string& member) override
+        {
+            Connection->srem(key, member);
+        }
+
+        void Delete(const std::string& key) override
+        {
+            Connection->del(key);
+        }
+    };
+}
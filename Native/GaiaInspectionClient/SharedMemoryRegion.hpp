@@ -0,0 +1,495 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Memory-mapped region which carries the values of a unit to readers on the same host.
+     * @details
+     *  The region is made of fixed-size slots and an open-addressing name index.
+     *  Each slot holds the name and the value text of a variable, and its value is protected by a seqlock,
+     *  so readers never block the writer and read values without any system call.
+     *  Slots are never reused: removed variables are marked as removed and revived when they are written again.
+     *  Only the process which creates the region writes into it, and writes are serialized in that process.
+     *  The header carries the process ID and a heartbeat of the writer, so readers treat the region of a writer
+     *  which died without closing it as closed.
+     */
+    class SharedMemoryRegion
+    {
+    public:
+        /// State of a variable in the region.
+        enum class ValueState
+        {
+            /// The variable has never been written into the region.
+            Missing,
+            /// The variable holds a value.
+            Present,
+            /// The variable has been removed.
+            Removed,
+            /// The value is too long for a slot, it is only available in Redis.
+            Overflow,
+            /// The value kept being written during all read attempts, it should be read from Redis.
+            Busy
+        };
+
+        /// Max length of a variable name in the region.
+        static constexpr std::size_t NameCapacity = 120;
+        /// Age after which the heartbeat of the writer is expired, and its region is treated as closed.
+        static constexpr std::chrono::seconds HeartbeatTimeout {30};
+
+    private:
+        /// Magic number of a valid region, "GISM".
+        static constexpr std::uint32_t RegionMagic = 0x4753494D;
+        /// Version of the region layout.
+        static constexpr std::uint32_t RegionVersion = 2;
+        /// Value length which marks a removed variable.
+        static constexpr std::uint32_t RemovedLength = 0xFFFFFFFF;
+        /// Value length which marks an overflowed value.
+        static constexpr std::uint32_t OverflowLength = 0xFFFFFFFE;
+        /// Max count of attempts to read a consistent value, bounds the wait on a writer which died mid-write.
+        static constexpr std::size_t MaxReadAttempts = 64;
+        /// Min interval between two liveness checks of the writer by a reader, which cost a system call.
+        static constexpr std::chrono::seconds LivenessCheckInterval {1};
+
+        /// Header at the beginning of the region.
+        struct RegionHeader
+        {
+            /// Magic number, written after the other fields so readers never see a partial layout.
+            std::atomic<std::uint32_t> Magic;
+            std::uint32_t Version;
+            std::uint32_t SlotsCount;
+            std::uint32_t ValueCapacity;
+            std::uint32_t IndexSize;
+            std::uint32_t SlotStride;
+            /// Count of slots in use.
+            std::atomic<std::uint32_t> UsedSlots;
+            /// Set when the writer has closed the region, readers should map the new one.
+            std::atomic<std::uint32_t> Closed;
+            /// Process ID of the writer.
+            std::atomic<std::int32_t> OwnerProcess;
+            /// Time of the latest heartbeat of the writer, in nanoseconds of the system-wide monotonic clock.
+            std::atomic<std::int64_t> Heartbeat;
+        };
+
+        /// Header of a slot, followed by the value text.
+        struct alignas(64) SlotHeader
+        {
+            /// Sequence of the seqlock, odd while the value is being written.
+            std::atomic<std::uint64_t> Sequence;
+            /// Length of the value text, or one of the special lengths.
+            std::atomic<std::uint32_t> ValueLength;
+            /// Length of the name, written once before the slot is published in the index.
+            std::uint32_t NameLength;
+            /// Serial of the latest batch written into this slot, only used by the writer.
+            std::uint64_t WriteSerial;
+            /// Name of the variable.
+            char Name[NameCapacity];
+        };
+
+        /// Name of the shared memory object.
+        const std::string ObjectName;
+        /// Whether this process created the region and writes into it.
+        const bool Owner;
+        /// Mapped address.
+        void* Address {nullptr};
+        /// Mapped size.
+        std::size_t Size {0};
+        /// Inode of the created object, used to avoid removing a region which has replaced this one.
+        ino_t Inode {0};
+        /// Mutex which serializes writes in the owner process.
+        std::mutex WriteMutex;
+        /// Time of the latest liveness check of the writer, in nanoseconds of the monotonic clock.
+        mutable std::atomic<std::int64_t> LivenessCheckTime {0};
+
+        SharedMemoryRegion(std::string object_name, bool owner) :
+            ObjectName(std::move(object_name)), Owner(owner)
+        {}
+
+        /// Get the header of the region.
+        [[nodiscard]] RegionHeader* GetHeader() const noexcept
+        {
+            return static_cast<RegionHeader*>(Address);
+        }
+
+        /// Get the name index, whose entries are slot indexes plus 1, and 0 for empty entries.
+        [[nodiscard]] std::atomic<std::uint32_t>* GetIndex() const noexcept
+        {
+            return reinterpret_cast<std::atomic<std::uint32_t>*>(
+                    static_cast<char*>(Address) + GetIndexOffset());
+        }
+
+        /// Get the slot with the given index.
+        [[nodiscard]] SlotHeader* GetSlot(std::uint32_t index) const noexcept
+        {
+            const auto* header = GetHeader();
+            return reinterpret_cast<SlotHeader*>(static_cast<char*>(Address) + GetSlotsOffset(header->IndexSize) +
+                                                 static_cast<std::size_t>(header->SlotStride) * index);
+        }
+
+        /// Offset of the name index.
+        static constexpr std::size_t GetIndexOffset() noexcept
+        {
+            return (sizeof(RegionHeader) + 63) / 64 * 64;
+        }
+
+        /// Offset of the first slot.
+        static constexpr std::size_t GetSlotsOffset(std::uint32_t index_size) noexcept
+        {
+            return (GetIndexOffset() + sizeof(std::atomic<std::uint32_t>) * index_size + 63) / 64 * 64;
+        }
+
+        /// FNV-1a hash of a name, which is stable across processes.
+        static std::uint64_t HashName(std::string_view name) noexcept
+        {
+            std::uint64_t hash = 14695981039346656037ULL;
+            for (auto character : name)
+            {
+                hash ^= static_cast<unsigned char>(character);
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        /// Find the slot of the given name, and the index entry where it is or should be inserted.
+        SlotHeader* FindSlot(std::string_view name, std::atomic<std::uint32_t>** entry = nullptr) const noexcept
+        {
+            const auto* header = GetHeader();
+            auto* index = GetIndex();
+            auto mask = header->IndexSize - 1;
+            for (auto position = static_cast<std::uint32_t>(HashName(name)) & mask;;
+                 position = (position + 1) & mask)
+            {
+                auto slot_index = index[position].load(std::memory_order_acquire);
+                if (slot_index == 0 || slot_index > header->SlotsCount)
+                {
+                    if (entry) *entry = &index[position];
+                    return nullptr;
+                }
+                auto* slot = GetSlot(slot_index - 1);
+                if (std::string_view(slot->Name, slot->NameLength) == name) return slot;
+            }
+        }
+
+        /// Get the current time of the monotonic clock, which is system-wide on Linux, in nanoseconds.
+        static std::int64_t GetMonotonicTime() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// Check whether the writer process is alive and its heartbeat has not expired.
+        [[nodiscard]] bool IsOwnerAlive() const noexcept
+        {
+            const auto* header = GetHeader();
+            auto heartbeat_age = GetMonotonicTime() - header->Heartbeat.load(std::memory_order_relaxed);
+            if (heartbeat_age > std::chrono::duration_cast<std::chrono::nanoseconds>(HeartbeatTimeout).count())
+            {
+                return false;
+            }
+            // EPERM means the process exists but belongs to another user.
+            return kill(header->OwnerProcess.load(std::memory_order_relaxed), 0) == 0 || errno != ESRCH;
+        }
+
+        /// Find the slot of a name for writing, or take a free slot for it.
+        SlotHeader* AcquireSlot(std::string_view name)
+        {
+            auto* header = GetHeader();
+            std::atomic<std::uint32_t>* entry = nullptr;
+            auto* slot = FindSlot(name, &entry);
+            if (slot) return slot;
+            auto slot_index = header->UsedSlots.load(std::memory_order_relaxed);
+            if (slot_index >= header->SlotsCount) return nullptr;
+            slot = GetSlot(slot_index);
+            slot->NameLength = static_cast<std::uint32_t>(name.size());
+            std::memcpy(slot->Name, name.data(), name.size());
+            slot->ValueLength.store(RemovedLength, std::memory_order_relaxed);
+            header->UsedSlots.store(slot_index + 1, std::memory_order_release);
+            entry->store(slot_index + 1, std::memory_order_release);
+            return slot;
+        }
+
+        /// Write a value length and the value text into a slot under its seqlock.
+        static void WriteSlot(SlotHeader* slot, std::uint32_t length, std::string_view value) noexcept
+        {
+            auto sequence = slot->Sequence.load(std::memory_order_relaxed);
+            slot->Sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot->ValueLength.store(length, std::memory_order_relaxed);
+            if (!value.empty())
+            {
+                std::memcpy(reinterpret_cast<char*>(slot) + sizeof(SlotHeader), value.data(), value.size());
+            }
+            slot->Sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        /// Map an existing region without owning it, null will be returned if it is missing or invalid.
+        static std::unique_ptr<SharedMemoryRegion> Map(const std::string& object_name, bool writable)
+        {
+            std::unique_ptr<SharedMemoryRegion> region(new SharedMemoryRegion(object_name, false));
+            auto descriptor = shm_open(object_name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+            if (descriptor < 0) return nullptr;
+            struct stat status {};
+            if (fstat(descriptor, &status) != 0 || static_cast<std::size_t>(status.st_size) < GetSlotsOffset(0))
+            {
+                close(descriptor);
+                return nullptr;
+            }
+            auto size = static_cast<std::size_t>(status.st_size);
+            auto* address = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                                 descriptor, 0);
+            close(descriptor);
+            if (address == MAP_FAILED) return nullptr;
+            region->Address = address;
+            region->Size = size;
+
+            const auto* header = region->GetHeader();
+            if (header->Magic.load(std::memory_order_acquire) != RegionMagic || header->Version != RegionVersion ||
+                header->IndexSize == 0 || (header->IndexSize & (header->IndexSize - 1)) != 0 ||
+                GetSlotsOffset(header->IndexSize) +
+                static_cast<std::size_t>(header->SlotStride) * header->SlotsCount > size)
+            {
+                return nullptr;
+            }
+            region->LivenessCheckTime.store(GetMonotonicTime(), std::memory_order_relaxed);
+            return region;
+        }
+
+    public:
+        SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+        SharedMemoryRegion& operator=(const SharedMemoryRegion&) = delete;
+
+        /// Unmap the region, and remove it if this process is its owner.
+        ~SharedMemoryRegion()
+        {
+            if (!Address) return;
+            if (Owner)
+            {
+                GetHeader()->Closed.store(1, std::memory_order_release);
+                auto descriptor = shm_open(ObjectName.c_str(), O_RDONLY, 0);
+                if (descriptor >= 0)
+                {
+                    struct stat status {};
+                    if (fstat(descriptor, &status) == 0 && status.st_ino == Inode)
+                    {
+                        shm_unlink(ObjectName.c_str());
+                    }
+                    close(descriptor);
+                }
+            }
+            munmap(Address, Size);
+        }
+
+        /// Get the name of the shared memory object for the given unit.
+        static std::string MakeObjectName(const std::string& unit_name)
+        {
+            std::string name = "/gaia_inspection.";
+            for (auto character : unit_name)
+            {
+                name.push_back(character == '/' ? '.' : character);
+            }
+            return name;
+        }
+
+        /**
+         * @brief Create the region of a unit, the previous region of the same unit will be replaced.
+         * @param unit_name Name of the unit.
+         * @param slots_count Max count of variables in the region.
+         * @param value_capacity Max length of a value text, longer values are marked as overflowed.
+         * @return Region owned by this process.
+         * @throw std::runtime_error If the region can not be created or mapped.
+         */
+        static std::unique_ptr<SharedMemoryRegion> Create(const std::string& unit_name,
+                                                          std::size_t slots_count, std::size_t value_capacity)
+        {
+            if (slots_count == 0) slots_count = 1;
+            std::uint32_t index_size = 1;
+            while (index_size < slots_count * 2) index_size <<= 1;
+            auto slot_stride = (sizeof(SlotHeader) + value_capacity + 63) / 64 * 64;
+            auto size = GetSlotsOffset(index_size) + slot_stride * slots_count;
+
+            std::unique_ptr<SharedMemoryRegion> region(new SharedMemoryRegion(MakeObjectName(unit_name), true));
+            // Readers which still map the previous region will notice its closed flag and map this one.
+            if (auto previous = Map(region->ObjectName, true))
+            {
+                previous->GetHeader()->Closed.store(1, std::memory_order_release);
+            }
+            shm_unlink(region->ObjectName.c_str());
+            auto descriptor = shm_open(region->ObjectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (descriptor < 0) throw std::runtime_error("Failed to create shared memory " + region->ObjectName + ".");
+            struct stat status {};
+            if (fstat(descriptor, &status) != 0 || ftruncate(descriptor, static_cast<off_t>(size)) != 0)
+            {
+                close(descriptor);
+                shm_unlink(region->ObjectName.c_str());
+                throw std::runtime_error("Failed to resize shared memory " + region->ObjectName + ".");
+            }
+            auto* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (address == MAP_FAILED)
+            {
+                shm_unlink(region->ObjectName.c_str());
+                throw std::runtime_error("Failed to map shared memory " + region->ObjectName + ".");
+            }
+            region->Address = address;
+            region->Size = size;
+            region->Inode = status.st_ino;
+
+            // The object is zero-filled by ftruncate(...), so only the layout fields need to be written.
+            auto* header = region->GetHeader();
+            header->Version = RegionVersion;
+            header->SlotsCount = static_cast<std::uint32_t>(slots_count);
+            header->ValueCapacity = static_cast<std::uint32_t>(value_capacity);
+            header->IndexSize = index_size;
+            header->SlotStride = static_cast<std::uint32_t>(slot_stride);
+            header->OwnerProcess.store(static_cast<std::int32_t>(getpid()), std::memory_order_relaxed);
+            header->Heartbeat.store(GetMonotonicTime(), std::memory_order_relaxed);
+            header->Magic.store(RegionMagic, std::memory_order_release);
+            return region;
+        }
+
+        /**
+         * @brief Map the region of a unit for reading.
+         * @param unit_name Name of the unit.
+         * @return Mapped region, or null if the unit has no valid region or its writer is dead.
+         */
+        static std::unique_ptr<SharedMemoryRegion> Open(const std::string& unit_name)
+        {
+            auto region = Map(MakeObjectName(unit_name), false);
+            if (region && (region->GetHeader()->Closed.load(std::memory_order_acquire) != 0 ||
+                           !region->IsOwnerAlive()))
+            {
+                return nullptr;
+            }
+            return region;
+        }
+
+        /**
+         * @brief Check whether the writer has closed this region, or died without closing it.
+         * @details The liveness of the writer is checked at most once per LivenessCheckInterval.
+         */
+        [[nodiscard]] bool IsClosed() const noexcept
+        {
+            if (GetHeader()->Closed.load(std::memory_order_acquire) != 0) return true;
+            if (Owner) return false;
+            auto now = GetMonotonicTime();
+            auto check_time = LivenessCheckTime.load(std::memory_order_relaxed);
+            if (now - check_time < std::chrono::duration_cast<std::chrono::nanoseconds>(LivenessCheckInterval).count())
+            {
+                return false;
+            }
+            LivenessCheckTime.store(now, std::memory_order_relaxed);
+            return !IsOwnerAlive();
+        }
+
+        /// Refresh the heartbeat of the writer, it should be called more often than HeartbeatTimeout.
+        void Touch() noexcept
+        {
+            if (!Owner) return;
+            GetHeader()->Heartbeat.store(GetMonotonicTime(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Write the value of a variable.
+         * @param name Name of the variable.
+         * @param value Value text.
+         * @param serial Serial of the batch which wrote this value, older than the latest written one is ignored.
+         * @retval true The value has been written, marked as overflowed if it is too long, or superseded.
+         * @retval false The name is too long or there is no free slot.
+         */
+        bool Write(std::string_view name, std::string_view value, std::uint64_t serial)
+        {
+            if (!Owner || name.size() > NameCapacity) return false;
+            std::unique_lock lock(WriteMutex);
+            auto* slot = AcquireSlot(name);
+            if (!slot) return false;
+            if (slot->WriteSerial > serial) return true;
+            slot->WriteSerial = serial;
+            if (value.size() > GetHeader()->ValueCapacity)
+            {
+                WriteSlot(slot, OverflowLength, {});
+            }
+            else
+            {
+                WriteSlot(slot, static_cast<std::uint32_t>(value.size()), value);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Mark the variable with the given name as removed.
+         * @param name Name of the variable.
+         * @param serial Serial of the batch which removed the variable, older than the latest written one is ignored.
+         */
+        void Remove(std::string_view name, std::uint64_t serial)
+        {
+            if (!Owner) return;
+            std::unique_lock lock(WriteMutex);
+            auto* slot = FindSlot(name);
+            if (!slot || slot->WriteSerial > serial) return;
+            slot->WriteSerial = serial;
+            WriteSlot(slot, RemovedLength, {});
+        }
+
+        /**
+         * @brief Read the value of a variable.
+         * @param name Name of the variable.
+         * @param value String to store the value text, may hold a partial text unless the value is present.
+         * @return State of the variable, Busy if no consistent value could be read within a bounded count of attempts.
+         */
+        ValueState Read(std::string_view name, std::string& value) const
+        {
+            const auto* slot = FindSlot(name);
+            if (!slot) return ValueState::Missing;
+            auto capacity = GetHeader()->ValueCapacity;
+            const auto* text = reinterpret_cast<const char*>(slot) + sizeof(SlotHeader);
+            for (std::size_t attempt = 0; attempt < MaxReadAttempts; ++attempt)
+            {
+                auto sequence = slot->Sequence.load(std::memory_order_acquire);
+                if (sequence & 1)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto length = slot->ValueLength.load(std::memory_order_relaxed);
+                ValueState state = ValueState::Present;
+                if (length == RemovedLength) state = ValueState::Removed;
+                else if (length == OverflowLength) state = ValueState::Overflow;
+                else value.assign(text, length <= capacity ? length : capacity);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->Sequence.load(std::memory_order_relaxed) == sequence) return state;
+            }
+            return ValueState::Busy;
+        }
+
+        /// Get the names of all variables which have been written into the region.
+        [[nodiscard]] std::vector<std::string> ListNames() const
+        {
+            std::vector<std::string> names;
+            auto used_slots = GetHeader()->UsedSlots.load(std::memory_order_acquire);
+            names.reserve(used_slots);
+            for (std::uint32_t index = 0; index < used_slots; ++index)
+            {
+                const auto* slot = GetSlot(index);
+                names.emplace_back(slot->Name, slot->NameLength);
+            }
+            return names;
+        }
+    };
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Batch of write operations which are sent to the storage together.
+     * @details
+     *  Operations are only recorded until Execute() is called, and they are applied in the recorded order.
+     *  A batch should only be used by one thread.
+     */
+    class StorageBatch
+    {
+    public:
+        virtual ~StorageBatch() = default;
+
+        /// Set the value of a string key.
+        virtual void Set(std::string_view key, std::string_view value) = 0;
+        /// Delete a key of any type.
+        virtual void Delete(std::string_view key) = 0;
+        /// Set the value of a field in a hash.
+        virtual void HashSet(std::string_view key, std::string_view field, std::string_view value) = 0;
+        /// Delete a field from a hash.
+        virtual void HashDelete(std::string_view key, std::string_view field) = 0;
+        /// Add a member into a set.
+        virtual void AddMember(std::string_view key, std::string_view member) = 0;
+        /// Remove a member from a set.
+        virtual void RemoveMember(std::string_view key, std::string_view member) = 0;
+        /// Add a member into a sorted set with the given score, or update its score if it exists.
+        virtual void AddScoredMember(std::string_view key, std::string_view member, long long score) = 0;
+        /// Publish a message to a channel, ignored by backends without messaging.
+        virtual void Publish(std::string_view channel, std::string_view message) = 0;
+        /**
+         * @brief Append an entry with the fields "value" and "timestamp" to a capped stream.
+         * @param key Key of the stream.
+         * @param id ID of the entry, "*" for an ID from the storage time, or "<milliseconds>-*" for an ID
+         *           from the given time if SupportsTimedStreamIDs(); an entry whose ID is not greater than
+         *           the last one is rejected, and counted in the result of Execute().
+         * @param value Value field of the entry.
+         * @param timestamp Timestamp field of the entry.
+         * @param max_length Approximate max length of the stream, 0 means no limit.
+         * @param min_id Entries whose ID is smaller than it are approximately trimmed, empty means no limit.
+         * @details Ignored by backends without streams.
+         */
+        virtual void AppendStream(std::string_view key, std::string_view id, std::string_view value,
+                                  std::string_view timestamp, std::size_t max_length, std::string_view min_id) = 0;
+
+        /**
+         * @brief Increment the integer generation of a unit, and stamp the given members with the new generation.
+         * @param generation_key Key of the integer generation, which starts from 0 if it does not exist.
+         * @param change_log_key Key of the sorted set which maps the members to the generations they changed at.
+         * @param members Members to stamp.
+         * @details
+         *  Both keys are updated atomically by the storage, so writers of the same unit never share a generation,
+         *  and a reader which sees a generation also sees the members stamped with it.
+         */
+        virtual void StampChanges(std::string_view generation_key, std::string_view change_log_key,
+                                  const std::vector<std::string>& members) = 0;
+
+        /**
+         * @brief Apply the recorded operations.
+         * @return Count of stream entries rejected because their IDs were not greater than the last ones.
+         * @throw std::exception If the storage fails or rejects an operation other than a stream entry,
+         *                       the recorded operations may be partially applied.
+         */
+        virtual std::size_t Execute() = 0;
+    };
+
+    /**
+     * @brief Storage of inspection variables, which is shared by inspection clients and readers.
+     * @details
+     *  It covers the operations on string keys, hashes and sets which clients and readers use to store values,
+     *  so the same logic can run on Redis or in process. All functions should be thread-safe.
+     */
+    class StorageBackend
+    {
+    public:
+        virtual ~StorageBackend() = default;
+
+        /// Create a batch of write operations.
+        virtual std::unique_ptr<StorageBatch> CreateBatch() = 0;
+
+        /// Get the value of a string key.
+        virtual std::optional<std::string> Get(const std::string& key) = 0;
+        /// Get the values of string keys, in the same order of the given keys.
+        virtual std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys) = 0;
+        /// Get the value of a field in a hash.
+        virtual std::optional<std::string> HashGet(const std::string& key, const std::string& field) = 0;
+        /// Get the values of fields in a hash, in the same order of the given fields.
+        virtual std::vector<std::optional<std::string>> HashMultiGet(const std::string& key,
+                                                                     const std::vector<std::string>& fields) = 0;
+        /**
+         * @brief Get the values of fields in each of the given hashes.
+         * @param keys Keys of the hashes.
+         * @param fields Fields to get of each hash, in the same order of the keys.
+         * @return Values of the fields of each hash, in the same order of the keys and the fields.
+         * @details Backends with pipelines read all hashes in one round trip, or one per hash tag on a cluster.
+         */
+        virtual std::vector<std::vector<std::optional<std::string>>> MultiHashMultiGet(
+                const std::vector<std::string>& keys, const std::vector<std::vector<std::string>>& fields)
+        {
+            std::vector<std::vector<std::optional<std::string>>> values;
+            values.reserve(keys.size());
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                values.emplace_back(HashMultiGet(keys[index], fields[index]));
+            }
+            return values;
+        }
+        /// Get all fields and values in a hash.
+        virtual std::unordered_map<std::string, std::string> HashGetAll(const std::string& key) = 0;
+        /// Get all members of a set.
+        virtual std::unordered_set<std::string> Members(const std::string& key) = 0;
+        /// Get all members of each of the given sets, in the same order of the given keys.
+        virtual std::vector<std::unordered_set<std::string>> MultiMembers(const std::vector<std::string>& keys) = 0;
+        /**
+         * @brief Incrementally iterate the members of a set.
+         * @param key Key of the set.
+         * @param cursor Cursor returned by the previous call, 0 to start.
+         * @param count Hint of the count of members to return.
+         * @param members Container to append the members into.
+         * @return Cursor for the next call, 0 if the iteration has finished.
+         * @details Members which stay in the set during the whole iteration are returned at least once.
+         */
+        virtual long long ScanMembers(const std::string& key, long long cursor, std::size_t count,
+                                      std::vector<std::string>& members) = 0;
+        /// Get the members of a sorted set whose score is greater than the given one, along with their scores.
+        virtual std::vector<std::pair<std::string, long long>> ScoredMembersAbove(const std::string& key,
+                                                                                  long long min_score) = 0;
+
+        /// Add members into a set.
+        virtual void AddMembers(const std::string& key, const std::vector<std::string>& members) = 0;
+        /// Add a member into a set.
+        void AddMember(const std::string& key, const std::string& member)
+        {
+            AddMembers(key, {member});
+        }
+        /// Remove a member from a set.
+        virtual void RemoveMember(const std::string& key, const std::string& member) = 0;
+        /// Delete a key of any type.
+        virtual void Delete(const std::string& key) = 0;
+
+        /**
+         * @brief Check whether keys are distributed over the slots of a cluster.
+         * @details Keys of a unit carry a hash tag on clustered backends, so they share a slot and can be batched.
+         */
+        [[nodiscard]] virtual bool IsClustered() const noexcept
+        {
+            return false;
+        }
+
+        /**
+         * @brief Check whether stream entries can be appended with IDs from a given time, as "<milliseconds>-*".
+         * @details Redis supports them since 7.0; the check may query the server.
+         */
+        [[nodiscard]] virtual bool SupportsTimedStreamIDs()
+        {
+            return true;
+        }
+    };
+
+    /**
+     * @brief Get the tag of a unit used in its keys, such as "inspections/<tag>/<name>".
+     * @param unit_name Name of the unit.
+     * @param backend Backend which stores the keys, can be null.
+     * @return The unit name wrapped in braces as a hash tag on clustered backends, otherwise the unit name.
+     */
+    inline std::string MakeUnitTag(const std::string& unit_name, const StorageBackend* backend)
+    {
+        if (backend && backend->IsClustered()) return "{" + unit_name + "}";
+        return unit_name;
+    }
+}
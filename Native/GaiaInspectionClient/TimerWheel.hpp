@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Hashed timer wheel for periodic timers.
+     * @tparam PayloadType Type of the data carried by timers.
+     * @details
+     *  Scheduling and advancing cost O(1) per timer, regardless of how many timers are registered.
+     *  Timers whose period is longer than the wheel wait for several rounds in their slot.
+     *  This class is not thread-safe.
+     */
+    template <typename PayloadType>
+    class TimerWheel
+    {
+    private:
+        /// Periodic timer in a slot.
+        struct Timer
+        {
+            /// Data carried by this timer.
+            PayloadType Payload;
+            /// Period of this timer, in ticks.
+            std::size_t Period;
+            /// Count of rounds to wait before this timer is due.
+            std::size_t Rounds;
+        };
+
+        /// Slots of the wheel.
+        std::vector<std::vector<Timer>> Slots;
+        /// Index of the current slot.
+        std::size_t Cursor {0};
+        /// Timers which are due in the current tick, reused across ticks.
+        std::vector<Timer> DueTimers;
+
+        /// Put a timer into the slot which will be reached after its period.
+        void Insert(Timer timer)
+        {
+            if (timer.Period == 0) timer.Period = 1;
+            timer.Rounds = (timer.Period - 1) / Slots.size();
+            Slots[(Cursor + timer.Period) % Slots.size()].emplace_back(std::move(timer));
+        }
+
+    public:
+        /**
+         * @brief Allocate the slots.
+         * @param slots_count Count of slots, timers with a period not longer than it never wait for extra rounds.
+         */
+        explicit TimerWheel(std::size_t slots_count = 1024) : Slots(slots_count > 0 ? slots_count : 1)
+        {}
+
+        /**
+         * @brief Schedule a periodic timer.
+         * @param payload Data carried by the timer.
+         * @param period Period of the timer in ticks, 0 will be treated as 1.
+         */
+        void Schedule(PayloadType payload, std::size_t period)
+        {
+            Insert(Timer{std::move(payload), period, 0});
+        }
+
+        /**
+         * @brief Advance the wheel by one tick.
+         * @tparam Handler Callable type with the signature bool(PayloadType&).
+         * @param handler Handler to invoke for each due timer;
+         *                the timer will be rescheduled for its next period if the handler returns true,
+         *                otherwise it will be discarded.
+         */
+        template <typename Handler>
+        void Advance(Handler&& handler)
+        {
+            Cursor = (Cursor + 1) % Slots.size();
+            auto& slot = Slots[Cursor];
+            DueTimers.clear();
+            for (std::size_t index = 0; index < slot.size();)
+            {
+                if (slot[index].Rounds > 0)
+                {
+                    --slot[index].Rounds;
+                    ++index;
+                    continue;
+                }
+                DueTimers.emplace_back(std::move(slot[index]));
+                slot[index] = std::move(slot.back());
+                slot.pop_back();
+            }
+            for (auto& timer : DueTimers)
+            {
+                if (handler(timer.Payload))
+                {
+                    Insert(std::move(timer));
+                }
+            }
+        }
+    };
+}
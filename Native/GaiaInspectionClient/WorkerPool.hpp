@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Fixed-size pool of worker threads which execute tasks in submission order.
+     */
+    class WorkerPool
+    {
+    private:
+        /// Worker threads.
+        std::vector<std::thread> Workers;
+        /// Task and its cancellation hook, which is invoked instead of the task if the task is discarded.
+        struct Task
+        {
+            std::function<void()> Run;
+            std::function<void()> Cancel;
+        };
+        /// Tasks waiting for a worker.
+        std::deque<Task> Tasks;
+        /// Mutex for the task queue.
+        std::mutex TasksMutex;
+        /// Condition used to wake up idle workers.
+        std::condition_variable TasksCondition;
+        /// Whether workers should keep running.
+        bool Running {true};
+
+    public:
+        /**
+         * @brief Start the worker threads.
+         * @param threads_count Count of worker threads, at least 1 thread will be started.
+         */
+        explicit WorkerPool(std::size_t threads_count)
+        {
+            if (threads_count == 0) threads_count = 1;
+            Workers.reserve(threads_count);
+            for (std::size_t index = 0; index < threads_count; ++index)
+            {
+                Workers.emplace_back([this]{
+                    while (true)
+                    {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock lock(TasksMutex);
+                            TasksCondition.wait(lock, [this]{ return !Running || !Tasks.empty(); });
+                            if (!Running) return;
+                            task = std::move(Tasks.front().Run);
+                            Tasks.pop_front();
+                        }
+                        task();
+                    }
+                });
+            }
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /// Stop the worker threads, tasks not yet started will be discarded and their cancellation hooks invoked.
+        ~WorkerPool()
+        {
+            std::deque<Task> discarded_tasks;
+            {
+                std::unique_lock lock(TasksMutex);
+                Running = false;
+                discarded_tasks.swap(Tasks);
+            }
+            TasksCondition.notify_all();
+            for (auto& task : discarded_tasks)
+            {
+                if (task.Cancel) task.Cancel();
+            }
+            for (auto& worker : Workers)
+            {
+                worker.join();
+            }
+        }
+
+        /// Get the count of worker threads.
+        [[nodiscard]] std::size_t GetThreadsCount() const noexcept
+        {
+            return Workers.size();
+        }
+
+        /**
+         * @brief Submit a task to be executed by a worker.
+         * @param task Task to execute, it should not throw.
+         * @param cancel Hook invoked instead of the task if the pool is destroyed before the task starts,
+         *               it should not throw.
+         */
+        void Submit(std::function<void()> task, std::function<void()> cancel = nullptr)
+        {
+            {
+                std::unique_lock lock(TasksMutex);
+                Tasks.push_back(Task{std::move(task), std::move(cancel)});
+            }
+            TasksCondition.notify_one();
+        }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "InspectionReader.hpp"
+#include "ReaderHub.hpp"
 
 namespace Gaia::InspectionService
 {}
\ No newline at end of file
@@ -1,34 +1,294 @@
 #include "InspectionReader.hpp"
+#include <GaiaInspectionClient/SharedMemoryRegion.hpp>
 
 #include <utility>
-
-#include <utility>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <limits>
 
 namespace Gaia::InspectionService
 {
-    /// Establish a connection to the Redis server and bind the given name.
+    namespace
+    {
+        /// Interval between two lookups of a missing shared memory region.
+        constexpr std::chrono::seconds RegionRetryInterval {1};
+        /// Backoff of the subscriber thread before its first reconnection, which doubles on each failure.
+        constexpr std::chrono::milliseconds SubscriberMinBackoff {100};
+        /// Max backoff of the subscriber thread between two reconnections.
+        constexpr std::chrono::milliseconds SubscriberMaxBackoff {5000};
+
+        /// Entry of a stream returned by Redis.
+        using StreamItem = std::pair<std::string, std::optional<std::unordered_map<std::string, std::string>>>;
+
+        /// Convert entries of a history stream into history entries.
+        std::vector<InspectionReader::HistoryEntry> ParseHistory(std::vector<StreamItem>& items)
+        {
+            std::vector<InspectionReader::HistoryEntry> entries;
+            entries.reserve(items.size());
+            for (auto& [id, fields] : items)
+            {
+                if (!fields) continue;
+                InspectionReader::HistoryEntry entry;
+                entry.ID = std::move(id);
+                auto value_finder = fields->find("value");
+                if (value_finder != fields->end())
+                {
+                    entry.Value = std::move(value_finder->second);
+                }
+                auto timestamp_finder = fields->find("timestamp");
+                long long timestamp = 0;
+                if (timestamp_finder != fields->end() &&
+                    boost::conversion::try_lexical_convert(timestamp_finder->second, timestamp))
+                {
+                    entry.Timestamp = std::chrono::system_clock::time_point(
+                            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                    std::chrono::microseconds(timestamp)));
+                }
+                entries.emplace_back(std::move(entry));
+            }
+            return entries;
+        }
+
+        /// Convert a time point into the ID used in range queries of streams.
+        std::string ToStreamID(std::chrono::system_clock::time_point time)
+        {
+            return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time.time_since_epoch()).count());
+        }
+    }
+
+    /// Share the connection of this process to the Redis server and bind the given name.
     InspectionReader::InspectionReader(const std::string &unit_name, unsigned int port, const std::string &ip)
-        : InspectionReader(unit_name,
-                           std::make_shared<sw::redis::Redis>("tcp://" + ip + ":" + std::to_string(port)))
+        : InspectionReader(unit_name, ConnectionHub::GetInstance().AcquireConnection(ip, port))
     {}
 
     /// Reuse the connection to a Redis server and bind the given unit name.
     InspectionReader::InspectionReader(const std::string &unit_name, std::shared_ptr<sw::redis::Redis> connection)
-        : UnitName(unit_name), Connection(std::move(connection)), VariableNamePrefix("inspections/" + unit_name + "/")
+        : InspectionReader(unit_name, std::make_shared<RedisBackend>(std::move(connection)))
+    {}
+
+    /// Reuse the connection to a Redis Cluster and bind the given unit name.
+    InspectionReader::InspectionReader(const std::string &unit_name,
+                                       std::shared_ptr<sw::redis::RedisCluster> connection)
+        : InspectionReader(unit_name, std::make_shared<RedisClusterBackend>(std::move(connection)))
     {}
 
+    /// Read the variables from the given backend and bind the given unit name.
+    InspectionReader::InspectionReader(const std::string &unit_name, std::shared_ptr<StorageBackend> backend)
+        : Backend(std::move(backend)),
+          ControlChannel([this]{
+              std::stringstream channel;
+              channel << "inspection_readers/" << std::this_thread::get_id() << "/" << static_cast<void*>(this);
+              return channel.str();
+          }())
+    {
+        if (!Backend) throw std::runtime_error("Storage backend is null.");
+        // Keys depend on whether the backend is clustered, so they are built after the backend is set.
+        BindUnit(unit_name);
+        if (auto* redis_backend = dynamic_cast<RedisBackend*>(Backend.get()))
+        {
+            Connection = redis_backend->GetConnection();
+        }
+    }
+
+    /// Get the connection to Redis for the features which only Redis provides.
+    sw::redis::Redis& InspectionReader::RequireConnection()
+    {
+        if (!Connection) throw std::runtime_error("History and notifications require the Redis backend.");
+        return *Connection;
+    }
+
+    /// Stop the subscriber thread if it is running.
+    InspectionReader::~InspectionReader()
+    {
+        StopSubscriber();
+    }
+
+    /// Get the shared memory region of the bound unit, it will be remapped if the writer has replaced it.
+    SharedMemoryRegion* InspectionReader::AcquireRegion()
+    {
+        if (!SharedMemory || UnitName == "*") return nullptr;
+        if (!Region || Region->IsClosed())
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (!Region && now < RegionRetryTime) return nullptr;
+            Region = SharedMemoryRegion::Open(UnitName);
+            if (!Region) RegionRetryTime = now + RegionRetryInterval;
+        }
+        return Region.get();
+    }
+
     /// Query the value text of the variable with the given name.
     std::optional<std::string> InspectionReader::QueryText(const std::string &name)
     {
-        return Connection->get(VariableNamePrefix + name);
+        if (auto* region = AcquireRegion())
+        {
+            std::string value;
+            switch (region->Read(name, value))
+            {
+                case SharedMemoryRegion::ValueState::Present:
+                    return value;
+                case SharedMemoryRegion::ValueState::Removed:
+                    return std::nullopt;
+                default:
+                    // Missing and overflowed values are read from Redis.
+                    break;
+            }
+        }
+        if (Layout == StorageLayout::Hash)
+        {
+            return Backend->HashGet(ValueHashKey, name);
+        }
+        return Backend->Get(VariableNamePrefix + name);
+    }
+
+    /// Query the string values of variables with the given names.
+    std::vector<std::optional<std::string>> InspectionReader::QueryTexts(const std::vector<std::string> &names)
+    {
+        std::vector<std::optional<std::string>> values;
+        if (names.empty()) return values;
+        if (auto* region = AcquireRegion())
+        {
+            values.resize(names.size());
+            std::vector<std::string> remote_names;
+            std::vector<std::size_t> remote_indexes;
+            for (std::size_t index = 0; index < names.size(); ++index)
+            {
+                std::string value;
+                auto state = region->Read(names[index], value);
+                if (state == SharedMemoryRegion::ValueState::Present)
+                {
+                    values[index] = std::move(value);
+                }
+                else if (state != SharedMemoryRegion::ValueState::Removed)
+                {
+                    remote_names.push_back(names[index]);
+                    remote_indexes.push_back(index);
+                }
+            }
+            if (remote_names.empty()) return values;
+            // Only the values unavailable in the region are fetched from Redis, still in one round trip.
+            auto remote_values = QueryRemoteTexts(remote_names);
+            for (std::size_t index = 0; index < remote_indexes.size(); ++index)
+            {
+                values[remote_indexes[index]] = std::move(remote_values[index]);
+            }
+            return values;
+        }
+        return QueryRemoteTexts(names);
+    }
+
+    /// Query the string values of variables with the given names from Redis.
+    std::vector<std::optional<std::string>> InspectionReader::QueryRemoteTexts(const std::vector<std::string> &names)
+    {
+        if (Layout == StorageLayout::Hash)
+        {
+            return Backend->HashMultiGet(ValueHashKey, names);
+        }
+        std::vector<std::string> keys;
+        keys.reserve(names.size());
+        for (const auto& name : names)
+        {
+            keys.emplace_back(VariableNamePrefix + name);
+        }
+        return Backend->MultiGet(keys);
+    }
+
+    /// Query the string values of all variables of the bound unit.
+    std::unordered_map<std::string, std::string> InspectionReader::QuerySnapshot()
+    {
+        std::unordered_map<std::string, std::string> snapshot;
+        if (auto* region = AcquireRegion())
+        {
+            auto names = region->ListNames();
+            auto values = QueryTexts(names);
+            for (std::size_t index = 0; index < names.size(); ++index)
+            {
+                if (!values[index]) continue;
+                snapshot.emplace(std::move(names[index]), std::move(*values[index]));
+            }
+            return snapshot;
+        }
+        if (Layout == StorageLayout::Hash)
+        {
+            snapshot = Backend->HashGetAll(ValueHashKey);
+        }
+        else if (!Connection)
+        {
+            auto members = Backend->Members(VariableIndexKey);
+            std::vector<std::string> names(members.begin(), members.end());
+            auto values = QueryRemoteTexts(names);
+            for (std::size_t index = 0; index < names.size(); ++index)
+            {
+                if (!values[index]) continue;
+                snapshot.emplace(std::move(names[index]), std::move(*values[index]));
+            }
+        }
+        else
+        {
+            // SORT with GET patterns reads the names in the index set together with their values,
+            // so the whole unit is fetched in one round trip without knowing the names in advance.
+            std::vector<std::optional<std::string>> pairs;
+            Connection->command("SORT", VariableIndexKey, "BY", "nosort",
+                                "GET", "#", "GET", VariableNamePrefix + "*", std::back_inserter(pairs));
+            for (std::size_t index = 0; index + 1 < pairs.size(); index += 2)
+            {
+                if (!pairs[index] || !pairs[index + 1]) continue;
+                snapshot.emplace(std::move(*pairs[index]), std::move(*pairs[index + 1]));
+            }
+        }
+        return snapshot;
+    }
+
+    /// Query the change generation of the bound unit.
+    std::optional<long long> InspectionReader::QueryGeneration()
+    {
+        long long generation = 0;
+        auto text = Backend->Get(GenerationKey);
+        if (!text || !boost::conversion::try_lexical_convert(*text, generation)) return std::nullopt;
+        return generation;
+    }
+
+    /// Query the variables of the bound unit which changed after the given generation.
+    InspectionReader::ChangeSet InspectionReader::QueryChangedSince(long long generation)
+    {
+        ChangeSet changes;
+        // The generation is read before the change log, so changes stamped later are at worst returned twice.
+        auto current_generation = QueryGeneration();
+        changes.Generation = current_generation.value_or(0);
+        if (current_generation && *current_generation == generation && generation > 0) return changes;
+
+        if (!current_generation || generation <= 0 || *current_generation < generation)
+        {
+            changes.Complete = true;
+            for (auto& [name, value] : QuerySnapshot())
+            {
+                changes.Values.emplace(name, std::move(value));
+            }
+            return changes;
+        }
+
+        auto members = Backend->ScoredMembersAbove(ChangeLogKey, generation);
+        std::vector<std::string> names;
+        names.reserve(members.size());
+        for (auto& [name, score] : members)
+        {
+            names.emplace_back(std::move(name));
+        }
+        auto values = QueryTexts(names);
+        changes.Values.reserve(names.size());
+        for (std::size_t index = 0; index < names.size(); ++index)
+        {
+            changes.Values.emplace(std::move(names[index]), std::move(values[index]));
+        }
+        return changes;
     }
 
     /// Query all available units list.
     std::unordered_set<std::string> InspectionReader::QueryUnits()
     {
-        std::unordered_set<std::string> units;
-        Connection->smembers("inspections", std::inserter(units, units.end()));
-        return units;
+        return Backend->Members("inspections");
     }
 
     /// Query all available variables.
@@ -37,15 +297,65 @@ namespace Gaia::InspectionService
         std::unordered_set<std::string> items;
         if (UnitName != "*")
         {
-            Connection->smembers("inspections/" + UnitName, std::inserter(items, items.end()));
+            items = Backend->Members(VariableIndexKey);
         }
         else
         {
-            long long cursor = 0;
-            do
+            // The index sets of all units are read in one round trip, instead of scanning the whole keyspace.
+            auto units = Backend->Members("inspections");
+            std::vector<std::string> unit_names(units.begin(), units.end());
+            std::vector<std::string> index_keys;
+            index_keys.reserve(unit_names.size());
+            for (const auto& unit_name : unit_names)
             {
-                cursor = Connection->scan(cursor, "inspections/*", std::inserter(items, items.end()));
-            }while (cursor != 0);
+                index_keys.emplace_back("inspections/" + MakeUnitTag(unit_name, Backend.get()));
+            }
+            auto unit_variables = Backend->MultiMembers(index_keys);
+            for (std::size_t index = 0; index < unit_names.size(); ++index)
+            {
+                for (const auto& name : unit_variables[index])
+                {
+                    items.insert(unit_names[index] + "/" + name);
+                }
+            }
+        }
+        return items;
+    }
+
+    /// Query a page of the available variables.
+    std::vector<std::string> InspectionReader::QueryVariables(VariableCursor& cursor, std::size_t count)
+    {
+        if (!cursor.Started)
+        {
+            cursor.Started = true;
+            cursor.UnitIndex = 0;
+            cursor.MemberCursor = 0;
+            if (UnitName != "*")
+            {
+                cursor.Units = {UnitName};
+            }
+            else
+            {
+                auto units = Backend->Members("inspections");
+                cursor.Units.assign(units.begin(), units.end());
+                std::sort(cursor.Units.begin(), cursor.Units.end());
+            }
+        }
+        if (count == 0) count = 1;
+
+        std::vector<std::string> items;
+        std::vector<std::string> names;
+        while (items.size() < count && cursor.UnitIndex < cursor.Units.size())
+        {
+            const auto& unit_name = cursor.Units[cursor.UnitIndex];
+            names.clear();
+            cursor.MemberCursor = Backend->ScanMembers("inspections/" + MakeUnitTag(unit_name, Backend.get()),
+                                                       cursor.MemberCursor, count - items.size(), names);
+            for (auto& name : names)
+            {
+                items.emplace_back(UnitName == "*" ? unit_name + "/" + name : std::move(name));
+            }
+            if (cursor.MemberCursor == 0) ++cursor.UnitIndex;
         }
         return items;
     }
@@ -54,8 +364,227 @@ namespace Gaia::InspectionService
     void InspectionReader::BindUnit(const std::string &unit_name)
     {
         UnitName = unit_name;
-        VariableNamePrefix = "inspections/" + UnitName + "/";
+        auto unit_tag = MakeUnitTag(UnitName, Backend.get());
+        VariableIndexKey = "inspections/" + unit_tag;
+        VariableNamePrefix = VariableIndexKey + "/";
+        ValueHashKey = "inspection_values/" + unit_tag;
+        GenerationKey = "inspection_generation/" + unit_tag;
+        ChangeLogKey = "inspection_changelog/" + unit_tag;
+        HistoryKeyPrefix = "inspection_history/" + unit_tag + "/";
+        Region.reset();
+    }
+
+    /// Subscribe the change notifications of a variable in the bound unit.
+    std::size_t InspectionReader::Subscribe(const std::string &name, ChangeCallback callback)
+    {
+        RequireConnection();
+        auto subscription_callback = std::make_shared<SubscriptionCallback>();
+        subscription_callback->Callback = std::move(callback);
+        std::unique_lock lock(SubscriptionsMutex);
+        auto id = NextSubscriptionID++;
+        Subscriptions.emplace(id, Subscription{UnitName, name, std::move(subscription_callback)});
+        bool new_unit = SubscribedUnits.insert(UnitName).second;
+        lock.unlock();
+
+        if (new_unit || SubscriberExited.load())
+        {
+            RestartSubscriber();
+        }
+        return id;
+    }
+
+    /// Cancel a subscription.
+    void InspectionReader::Unsubscribe(std::size_t id)
+    {
+        std::shared_ptr<SubscriptionCallback> callback;
+        {
+            std::unique_lock lock(SubscriptionsMutex);
+            auto finder = Subscriptions.find(id);
+            if (finder == Subscriptions.end()) return;
+            callback = std::move(finder->second.Callback);
+            Subscriptions.erase(finder);
+        }
+        // Waits for the callback if the subscriber thread is invoking it.
+        std::unique_lock callback_lock(callback->Mutex);
+        callback->Active = false;
+    }
+
+    /// Restart the subscriber thread to listen to the channels of all subscribed units.
+    void InspectionReader::RestartSubscriber()
+    {
+        std::unique_lock lock(SubscriberMutex);
+        StopSubscriber();
+
+        std::unique_lock subscriptions_lock(SubscriptionsMutex);
+        std::vector<std::string> channels;
+        channels.reserve(SubscribedUnits.size() + 1);
+        channels.push_back(ControlChannel);
+        for (const auto& unit_name : SubscribedUnits)
+        {
+            channels.push_back("inspection_changes/" + unit_name);
+        }
+        subscriptions_lock.unlock();
+
+        SubscriberRunning = true;
+        SubscriberExited = false;
+        SubscriberThread = std::thread([this, channels = std::move(channels)]{
+            auto backoff = SubscriberMinBackoff;
+            while (SubscriberRunning)
+            {
+                try
+                {
+                    auto subscriber = Connection->subscriber();
+                    subscriber.on_message([this](const std::string& channel, const std::string& message){
+                        if (channel == ControlChannel) return;
+                        try
+                        {
+                            DispatchNotification(channel, message);
+                        }
+                        catch (...)
+                        {
+                            // A failed callback does not stop the notifications of the other subscriptions.
+                        }
+                    });
+                    subscriber.subscribe(channels.begin(), channels.end());
+                    backoff = SubscriberMinBackoff;
+                    while (SubscriberRunning)
+                    {
+                        try
+                        {
+                            subscriber.consume();
+                        }
+                        catch (const sw::redis::TimeoutError&)
+                        {}
+                    }
+                }
+                catch (const sw::redis::Error&)
+                {
+                    // The connection is broken, such as when Redis restarts, so it is rebuilt after a backoff.
+                    // Notifications published meanwhile are lost.
+                    std::unique_lock backoff_lock(SubscriberBackoffMutex);
+                    SubscriberBackoffCondition.wait_for(backoff_lock, backoff, [this]{ return !SubscriberRunning; });
+                    backoff = std::min(backoff * 2, SubscriberMaxBackoff);
+                }
+            }
+            SubscriberExited = true;
+        });
     }
 
+    /// Stop the subscriber thread if it is running.
+    void InspectionReader::StopSubscriber()
+    {
+        if (!SubscriberThread.joinable()) return;
+        {
+            std::unique_lock backoff_lock(SubscriberBackoffMutex);
+            SubscriberRunning = false;
+        }
+        SubscriberBackoffCondition.notify_all();
+        // The subscriber thread is blocked in consume(), so it is woken up by messages on the control channel.
+        // Messages are published repeatedly, in case the thread has not finished subscribing yet.
+        while (!SubscriberExited)
+        {
+            try
+            {
+                Connection->publish(ControlChannel, "");
+            }
+            catch (const sw::redis::Error&)
+            {
+                // Redis is unreachable, so the subscriber thread is woken up by the timeout of its connection.
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        SubscriberThread.join();
+    }
+
+    /// Dispatch a received notification to the matching subscriptions.
+    void InspectionReader::DispatchNotification(const std::string &channel, const std::string &message)
+    {
+        constexpr std::string_view channel_prefix = "inspection_changes/";
+        if (channel.size() < channel_prefix.size()) return;
+        auto unit_name = std::string_view(channel).substr(channel_prefix.size());
 
-}
\ No newline at end of file
+        // The name ends at the first unescaped line feed, which is followed by the value of a written variable.
+        std::string name;
+        std::optional<std::string> value;
+        for (std::size_t index = 0; index < message.size(); ++index)
+        {
+            auto character = message[index];
+            if (character == '\n')
+            {
+                value = message.substr(index + 1);
+                break;
+            }
+            if (character == '\\' && index + 1 < message.size())
+            {
+                character = message[++index] == 'n' ? '\n' : message[index];
+            }
+            name.push_back(character);
+        }
+
+        // Callbacks are invoked outside of the lock, so Subscribe and Unsubscribe on other threads do not wait.
+        std::vector<std::shared_ptr<SubscriptionCallback>> matched_callbacks;
+        {
+            std::unique_lock lock(SubscriptionsMutex);
+            for (const auto& [id, subscription] : Subscriptions)
+            {
+                if (subscription.UnitName != unit_name) continue;
+                if (subscription.VariableName != "*" && subscription.VariableName != name) continue;
+                matched_callbacks.push_back(subscription.Callback);
+            }
+        }
+        for (const auto& callback : matched_callbacks)
+        {
+            std::unique_lock callback_lock(callback->Mutex);
+            if (!callback->Active) continue;
+            callback->Callback(name, value);
+        }
+    }
+
+    /// Query the history of a variable within the given time range.
+    std::vector<InspectionReader::HistoryEntry>
+    InspectionReader::QueryHistory(const std::string &name, std::chrono::system_clock::time_point from,
+                                   std::chrono::system_clock::time_point to, std::size_t max_count)
+    {
+        std::vector<StreamItem> items;
+        if (max_count > 0)
+        {
+            RequireConnection().xrange(HistoryKeyPrefix + name, ToStreamID(from), ToStreamID(to),
+                               static_cast<long long>(max_count), std::back_inserter(items));
+        }
+        else
+        {
+            RequireConnection().xrange(HistoryKeyPrefix + name, ToStreamID(from), ToStreamID(to),
+                               std::back_inserter(items));
+        }
+        return ParseHistory(items);
+    }
+
+    /// Query the latest entries of the history of a variable.
+    std::vector<InspectionReader::HistoryEntry>
+    InspectionReader::QueryLatestHistory(const std::string &name, std::size_t max_count)
+    {
+        std::vector<StreamItem> items;
+        RequireConnection().xrevrange(HistoryKeyPrefix + name, "+", "-", static_cast<long long>(max_count),
+                              std::back_inserter(items));
+        std::reverse(items.begin(), items.end());
+        return ParseHistory(items);
+    }
+
+    /// Query the entries appended after the given cursor.
+    std::vector<InspectionReader::HistoryEntry>
+    InspectionReader::QueryHistorySince(const std::string &name, std::string &cursor, std::size_t max_count)
+    {
+        std::unordered_map<std::string, std::vector<StreamItem>> streams;
+        RequireConnection().xread(HistoryKeyPrefix + name, cursor,
+                          max_count > 0 ? static_cast<long long>(max_count) : std::numeric_limits<long long>::max(),
+                          std::inserter(streams, streams.end()));
+        if (streams.empty()) return {};
+        auto& items = streams.begin()->second;
+        if (!items.empty())
+        {
+            cursor = items.back().first;
+        }
+        return ParseHistory(items);
+    }
+}
@@ -4,22 +4,53 @@
 #include <memory>
 #include <sw/redis++/redis++.h>
 #include <unordered_set>
+#include <unordered_map>
+#include <vector>
 #include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <boost/lexical_cast.hpp>
+#include <GaiaInspectionClient/RedisBackend.hpp>
+#include <GaiaInspectionClient/RedisClusterBackend.hpp>
+#include <GaiaInspectionClient/MemoryBackend.hpp>
+#include <GaiaInspectionClient/ConnectionHub.hpp>
 
 namespace Gaia::InspectionService
 {
+    class SharedMemoryRegion;
+
     class InspectionReader
     {
     protected:
         /// Name prefix for variables in Redis.
         std::string VariableNamePrefix;
+        /// Key of the set which indexes the variable names of the bound unit.
+        std::string VariableIndexKey;
+        /// Key of the hash which holds the values of the bound unit in the hash layout.
+        std::string ValueHashKey;
+        /// Key of the change generation of the bound unit.
+        std::string GenerationKey;
+        /// Key of the sorted set which maps the variable names of the bound unit to the generation they last changed at.
+        std::string ChangeLogKey;
         /// Unit name of this client.
         std::string UnitName {"*"};
 
     public:
+        /// Layout of the variables stored in Redis.
+        enum class StorageLayout
+        {
+            /// Each variable is stored in its own string key "inspections/<unit>/<name>".
+            Keys,
+            /// Variables are stored as fields of the hash "inspection_values/<unit>".
+            Hash
+        };
+
         /**
-         * @brief Establish a connection to the Redis server and bind the given name.
+         * @brief Share the connection of this process to the Redis server and bind the given name.
          * @param unit_name Name for the unit, will effect the variables name prefix.
          * @param port Port of the Redis server.
          * @param ip IP address of the Redis server.
@@ -32,12 +63,175 @@ namespace Gaia::InspectionService
          * @param connection Connection to the Redis server.
          */
         InspectionReader(const std::string& unit_name, std::shared_ptr<sw::redis::Redis> connection);
+        /**
+         * @brief Reuse the connection to a Redis Cluster and bind the given unit name.
+         * @param unit_name Name for the unit, will effect the variables name prefix.
+         * @param connection Connection to the Redis Cluster.
+         * @details Keys of each unit carry its hash tag, so each unit lives in one slot.
+         *          History and notifications are not available on the cluster.
+         */
+        InspectionReader(const std::string& unit_name, std::shared_ptr<sw::redis::RedisCluster> connection);
+        /**
+         * @brief Read the variables from the given backend and bind the given unit name.
+         * @param unit_name Name for the unit, will effect the variables name prefix.
+         * @param backend Backend which stores the variables, it should be the same one used by the client.
+         * @details History and notifications are only available on the Redis backend.
+         */
+        InspectionReader(const std::string& unit_name, std::shared_ptr<StorageBackend> backend);
+
+        /// Stop the subscriber thread if it is running.
+        virtual ~InspectionReader();
+
+        /**
+         * @brief Callback of change notifications.
+         * @param name Name of the changed variable.
+         * @param value New value text of the variable, std::nullopt if the variable has been removed.
+         */
+        using ChangeCallback = std::function<void(const std::string& name, const std::optional<std::string>& value)>;
+
+        /// Variables changed since a generation.
+        struct ChangeSet
+        {
+            /// Generation which the returned values are up to date with, to pass to the next query.
+            long long Generation {0};
+            /// Whether all variables are returned instead of the changed ones.
+            bool Complete {false};
+            /// Values of the changed variables indexed by their names, std::nullopt for removed variables.
+            std::unordered_map<std::string, std::optional<std::string>> Values;
+        };
+
+        /// Entry of the history of a variable.
+        struct HistoryEntry
+        {
+            /// ID of this entry in the history stream, which can be used as the cursor of incremental reads.
+            std::string ID;
+            /// Source time when the value was written.
+            std::chrono::system_clock::time_point Timestamp;
+            /// Value text.
+            std::string Value;
+        };
 
     protected:
-        /// Connection to the Redis.
+        /// Backend which stores the variables.
+        std::shared_ptr<StorageBackend> Backend;
+        /// Connection to the Redis, null if the backend is not Redis.
         std::shared_ptr<sw::redis::Redis> Connection;
 
+        /**
+         * @brief Get the connection to Redis for the features which only Redis provides.
+         * @throw std::runtime_error If the backend is not Redis.
+         */
+        sw::redis::Redis& RequireConnection();
+
+        /// Name prefix for history streams of variables in Redis.
+        std::string HistoryKeyPrefix;
+
+        /// Callback of a subscription, shared with the subscriber thread which invokes it outside of the lock.
+        struct SubscriptionCallback
+        {
+            /// Held while the callback is invoked, so cancellations wait for a running callback.
+            /// It is recursive, so a callback can cancel its own subscription.
+            std::recursive_mutex Mutex;
+            /// Cleared when the subscription is cancelled, the callback is only invoked while it is set.
+            bool Active {true};
+            /// Callback to invoke when the variable changed.
+            ChangeCallback Callback;
+        };
+
+        /// Information of a subscription.
+        struct Subscription
+        {
+            /// Name of the unit of the subscribed variable.
+            std::string UnitName;
+            /// Name of the subscribed variable, "*" for all variables of the unit.
+            std::string VariableName;
+            /// Callback of this subscription.
+            std::shared_ptr<SubscriptionCallback> Callback;
+        };
+
+        /// Mutex for subscriptions, it is not held while the callbacks are being invoked.
+        std::mutex SubscriptionsMutex;
+        /// Subscriptions indexed by their ID.
+        std::unordered_map<std::size_t, Subscription> Subscriptions;
+        /// Units whose notification channel has been subscribed.
+        std::unordered_set<std::string> SubscribedUnits;
+        /// ID for the next subscription.
+        std::size_t NextSubscriptionID {0};
+
+        /// Mutex for starting and stopping the subscriber thread.
+        std::mutex SubscriberMutex;
+        /// Background thread which receives notifications.
+        std::thread SubscriberThread;
+        /// Whether the subscriber thread should keep running.
+        std::atomic<bool> SubscriberRunning {false};
+        /// Whether the subscriber thread has exited.
+        std::atomic<bool> SubscriberExited {true};
+        /// Mutex for the backoff of the subscriber thread between two reconnections.
+        std::mutex SubscriberBackoffMutex;
+        /// Condition used to wake up the subscriber thread from its backoff when it is stopped.
+        std::condition_variable SubscriberBackoffCondition;
+        /// Private channel used to wake up the subscriber thread.
+        const std::string ControlChannel;
+
+        /// Restart the subscriber thread to listen to the channels of all subscribed units.
+        void RestartSubscriber();
+        /// Stop the subscriber thread if it is running.
+        void StopSubscriber();
+        /// Dispatch a received notification to the matching subscriptions.
+        void DispatchNotification(const std::string& channel, const std::string& message);
+
+        /// Layout of the variables to read from.
+        StorageLayout Layout {StorageLayout::Keys};
+
+        /// Whether values are read from the shared memory region of the bound unit first.
+        bool SharedMemory {false};
+        /// Mapped shared memory region of the bound unit, null if it is not mapped yet.
+        std::unique_ptr<SharedMemoryRegion> Region;
+        /// Time after which a missing region is looked up again, so readers of units without one
+        /// do not open the shared memory object on every query.
+        std::chrono::steady_clock::time_point RegionRetryTime {};
+
+        /// Get the shared memory region of the bound unit, it will be remapped if the writer has replaced it.
+        SharedMemoryRegion* AcquireRegion();
+        /// Query the string values of variables with the given names from Redis in one round trip.
+        std::vector<std::optional<std::string>> QueryRemoteTexts(const std::vector<std::string>& names);
+
     public:
+        /**
+         * @brief Change the layout of the variables to read from.
+         * @param layout Layout used by the inspection client of the bound unit.
+         */
+        void SetStorageLayout(StorageLayout layout) noexcept
+        {
+            Layout = layout;
+        }
+
+        /// Get the layout of the variables to read from.
+        [[nodiscard]] StorageLayout GetStorageLayout() const noexcept
+        {
+            return Layout;
+        }
+
+        /**
+         * @brief Enable or disable reading values from the shared memory region of the bound unit.
+         * @param enable If true, values will be read from the region without any round trip to Redis.
+         * @details
+         *  It only works on the same host of the inspection client, which should enable shared memory.
+         *  Values are read from Redis with the storage layout when the region is unavailable,
+         *  or when a value is too long for the region.
+         */
+        void SetSharedMemory(bool enable)
+        {
+            SharedMemory = enable;
+            if (!enable) Region.reset();
+        }
+
+        /// Check whether values are read from the shared memory region of the bound unit first.
+        [[nodiscard]] bool IsSharedMemoryEnabled() const noexcept
+        {
+            return SharedMemory;
+        }
+
         /// Query all available units list.
         std::unordered_set<std::string> QueryUnits();
 
@@ -57,10 +251,43 @@ namespace Gaia::InspectionService
          * @brief Query all available variables.
          * @pre This reader is bound to a unit.
          * @details
-         *  If bound unit name is "*", then all variables will be listed in the format of "unit/item"
+         *  If bound unit name is "*", then all variables will be listed in the format of "unit/item",
+         *  which are read from the index sets of all units in one round trip.
          */
         std::unordered_set<std::string> QueryVariables();
 
+        /// Cursor of an incremental enumeration of variables.
+        struct VariableCursor
+        {
+            /// Units to enumerate, listed when the first page is queried.
+            std::vector<std::string> Units;
+            /// Index of the unit being enumerated.
+            std::size_t UnitIndex {0};
+            /// Cursor in the index set of the unit being enumerated.
+            long long MemberCursor {0};
+            /// Whether the first page has been queried.
+            bool Started {false};
+
+            /// Check whether all variables have been enumerated.
+            [[nodiscard]] bool IsFinished() const noexcept
+            {
+                return Started && UnitIndex >= Units.size();
+            }
+        };
+
+        /**
+         * @brief Query a page of the available variables.
+         * @param cursor Cursor of the enumeration, a default constructed one starts from the beginning;
+         *               it will be advanced to the next page.
+         * @param count Hint of the count of variables in a page, a page may contain a few more or less.
+         * @pre This reader is bound to a unit.
+         * @return Variables in this page, in the format of "unit/item" if the bound unit name is "*".
+         * @details
+         *  The index sets are iterated with SSCAN, so a unit with a huge count of variables never blocks Redis.
+         *  Variables which exist during the whole enumeration are returned at least once.
+         */
+        std::vector<std::string> QueryVariables(VariableCursor& cursor, std::size_t count = 100);
+
         /**
          * @brief Query the string value of a variable with the given name.
          * @param name Name of the variable to query.
@@ -69,6 +296,159 @@ namespace Gaia::InspectionService
          */
         std::optional<std::string> QueryText(const std::string& name);
 
+        /**
+         * @brief Query the string values of variables with the given names.
+         * @param names Names of the variables to query.
+         * @pre This reader is bound to a unit.
+         * @return Optional value texts in the same order of the given names.
+         * @details All values are fetched in one round trip, with MGET or HMGET according to the layout.
+         */
+        std::vector<std::optional<std::string>> QueryTexts(const std::vector<std::string>& names);
+
+        /**
+         * @brief Query the string values of all variables of the bound unit.
+         * @pre This reader is bound to a unit.
+         * @return Map of variable names and value texts.
+         * @details
+         *  The whole unit is fetched in one round trip,
+         *  with HGETALL in the hash layout, or SORT over the index set in the keys layout.
+         */
+        std::unordered_map<std::string, std::string> QuerySnapshot();
+
+        /**
+         * @brief Query the change generation of the bound unit.
+         * @pre This reader is bound to a unit.
+         * @return Generation of the latest change, std::nullopt if the client does not track changes.
+         */
+        std::optional<long long> QueryGeneration();
+
+        /**
+         * @brief Query the variables of the bound unit which changed after the given generation.
+         * @param generation Generation returned by the previous query, 0 for the first query.
+         * @pre This reader is bound to a unit.
+         * @return Changed values and the generation to pass to the next query.
+         * @details
+         *  When nothing has changed, it costs a single GET of the generation key.
+         *  All variables are returned with the Complete flag, when the given generation is 0,
+         *  when the client does not track changes, or when the stored generation went backwards,
+         *  such as after the unit has been removed. Variables changed during the query may be returned
+         *  again by the next query, but a change is never missed.
+         */
+        ChangeSet QueryChangedSince(long long generation);
+
+        /**
+         * @brief Query the values of variables with the given names in one round trip.
+         * @tparam ValueType Type of the values to convert to.
+         * @param names Names of the variables to query.
+         * @param values Container to store the values, in the same order of the given names.
+         * @pre This reader is bound to a unit.
+         * @details
+         *  The given container will be cleared before the values are stored, so it can be reused across queries.
+         *  Values which do not exist or can not be converted will be std::nullopt.
+         */
+        template <typename ValueType>
+        void QueryValues(const std::vector<std::string>& names, std::vector<std::optional<ValueType>>& values)
+        {
+            auto texts = QueryTexts(names);
+            values.clear();
+            values.reserve(texts.size());
+            for (const auto& text : texts)
+            {
+                ValueType value;
+                if (text && boost::conversion::try_lexical_convert(*text, value))
+                {
+                    values.emplace_back(std::move(value));
+                }
+                else
+                {
+                    values.emplace_back(std::nullopt);
+                }
+            }
+        }
+
+        /**
+         * @brief Query the values of all variables of the bound unit in one round trip.
+         * @tparam ValueType Type of the values to convert to.
+         * @param values Container to store the values, indexed by the variable names.
+         * @pre This reader is bound to a unit.
+         * @details
+         *  The given container will be cleared before the values are stored, so it can be reused across queries.
+         *  Values which can not be converted will be skipped.
+         */
+        template <typename ValueType>
+        void QuerySnapshot(std::unordered_map<std::string, ValueType>& values)
+        {
+            auto texts = QuerySnapshot();
+            values.clear();
+            values.reserve(texts.size());
+            for (auto& [name, text] : texts)
+            {
+                ValueType value;
+                if (boost::conversion::try_lexical_convert(text, value))
+                {
+                    values.emplace(name, std::move(value));
+                }
+            }
+        }
+
+        /**
+         * @brief Query the history of a variable within the given time range.
+         * @param name Name of the variable.
+         * @param from Start of the time range, inclusive.
+         * @param to End of the time range, inclusive.
+         * @param max_count Max count of entries to return, 0 means no limit.
+         * @pre This reader is bound to a unit, and the client of this unit has enabled the history of this variable.
+         * @return Entries in ascending order of time.
+         * @details
+         *  The range is matched against the IDs of the entries in milliseconds, which are their source time
+         *  on Redis 7.0 or later, otherwise the time when Redis received them.
+         */
+        std::vector<HistoryEntry> QueryHistory(const std::string& name,
+                                               std::chrono::system_clock::time_point from,
+                                               std::chrono::system_clock::time_point to,
+                                               std::size_t max_count = 0);
+
+        /**
+         * @brief Query the latest entries of the history of a variable.
+         * @param name Name of the variable.
+         * @param max_count Max count of entries to return.
+         * @pre This reader is bound to a unit, and the client of this unit has enabled the history of this variable.
+         * @return Entries in ascending order of time.
+         */
+        std::vector<HistoryEntry> QueryLatestHistory(const std::string& name, std::size_t max_count);
+
+        /**
+         * @brief Query the entries appended after the given cursor.
+         * @param name Name of the variable.
+         * @param cursor ID of the last read entry, "0" to read from the beginning;
+         *               it will be moved to the ID of the last returned entry.
+         * @param max_count Max count of entries to return, 0 means no limit.
+         * @pre This reader is bound to a unit, and the client of this unit has enabled the history of this variable.
+         * @return Entries in ascending order of time.
+         */
+        std::vector<HistoryEntry> QueryHistorySince(const std::string& name, std::string& cursor,
+                                                    std::size_t max_count = 0);
+
+        /**
+         * @brief Subscribe the change notifications of a variable in the bound unit.
+         * @param name Name of the variable, "*" for all variables of the bound unit.
+         * @param callback Callback to invoke with the new value.
+         * @pre This reader is bound to a unit, and the client of this unit has enabled notifications.
+         * @return ID of this subscription, used to unsubscribe.
+         * @details
+         *  Callbacks are invoked on a background thread, exceptions thrown by them are ignored.
+         *  The thread reconnects with a backoff if the connection breaks, notifications published meanwhile are lost.
+         *  Unsubscribe(...) can be called inside a callback, but Subscribe(...) can not.
+         */
+        std::size_t Subscribe(const std::string& name, ChangeCallback callback);
+
+        /**
+         * @brief Cancel a subscription.
+         * @param id ID of the subscription.
+         * @details The callback of this subscription will not be invoked after this function returns.
+         */
+        void Unsubscribe(std::size_t id);
+
         /**
          * @brief Query the value of an inspected variable with the given name.
          * @tparam ValueType Type of the value to convert to.
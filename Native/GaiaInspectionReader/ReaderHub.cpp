@@ -0,0 +1,307 @@
+#include "ReaderHub.hpp"
+#include <GaiaInspectionClient/SharedMemoryRegion.hpp>
+
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Gaia::InspectionService
+{
+    namespace
+    {
+        /// Interval between two lookups of a missing shared memory region.
+        constexpr std::chrono::seconds RegionRetryInterval {1};
+    }
+
+    /// Share the connection of this process to the Redis server.
+    ReaderHub::ReaderHub(unsigned int port, const std::string &ip) :
+        ReaderHub(std::make_shared<RedisBackend>(ConnectionHub::GetInstance().AcquireConnection(ip, port)))
+    {}
+
+    /// Read the variables from the given backend.
+    ReaderHub::ReaderHub(std::shared_ptr<StorageBackend> backend, std::chrono::steady_clock::duration tick) :
+        Backend(std::move(backend)),
+        Tick(tick > std::chrono::steady_clock::duration::zero() ? tick : std::chrono::milliseconds(10))
+    {
+        if (!Backend) throw std::runtime_error("Storage backend is null.");
+    }
+
+    /// Stop the poller thread.
+    ReaderHub::~ReaderHub()
+    {
+        {
+            std::unique_lock lock(PollerMutex);
+            if (!PollerThread.joinable()) return;
+            PollerRunning = false;
+        }
+        PollerCondition.notify_all();
+        PollerThread.join();
+    }
+
+    /// Subscribe the values of a variable at the given frequency.
+    std::size_t ReaderHub::Subscribe(const std::string &unit_name, const std::string &variable_name,
+                                     double frequency, SampleCallback callback)
+    {
+        return AddSubscription({{unit_name, variable_name}}, frequency, std::move(callback), nullptr);
+    }
+
+    /// Subscribe the values of a group of variables, which are always sampled in the same fetch.
+    std::size_t ReaderHub::SubscribeGroup(std::vector<std::pair<std::string, std::string>> variables,
+                                          double frequency, GroupSampleCallback callback)
+    {
+        return AddSubscription(std::move(variables), frequency, nullptr, std::move(callback));
+    }
+
+    /// Add a subscription and start the poller thread if it is not running.
+    std::size_t ReaderHub::AddSubscription(std::vector<std::pair<std::string, std::string>> variables,
+                                           double frequency, SampleCallback callback,
+                                           GroupSampleCallback group_callback)
+    {
+        if (!std::isfinite(frequency) || frequency <= 0.0) frequency = 1.0;
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / frequency));
+        auto callbacks = std::make_shared<SubscriptionCallbacks>();
+        callbacks->Callback = std::move(callback);
+        callbacks->GroupCallback = std::move(group_callback);
+        std::size_t id;
+        {
+            std::unique_lock lock(SubscriptionsMutex);
+            id = NextSubscriptionID++;
+            Subscriptions.emplace(id, Subscription{std::move(variables), std::max(interval, Tick),
+                                                   std::chrono::steady_clock::now(), std::move(callbacks)});
+        }
+        StartPoller();
+        return id;
+    }
+
+    /// Cancel a subscription.
+    void ReaderHub::Unsubscribe(std::size_t id)
+    {
+        std::shared_ptr<SubscriptionCallbacks> callbacks;
+        {
+            std::unique_lock lock(SubscriptionsMutex);
+            auto finder = Subscriptions.find(id);
+            if (finder == Subscriptions.end()) return;
+            callbacks = std::move(finder->second.Callbacks);
+            Subscriptions.erase(finder);
+        }
+        // Waits for the callback if the poller thread is invoking it.
+        std::unique_lock callback_lock(callbacks->Mutex);
+        callbacks->Active = false;
+    }
+
+    /// Start the poller thread if it is not running.
+    void ReaderHub::StartPoller()
+    {
+        std::unique_lock lock(PollerMutex);
+        if (PollerThread.joinable()) return;
+        PollerRunning = true;
+        PollerThread = std::thread([this]{
+            auto deadline = std::chrono::steady_clock::now();
+            std::unique_lock poller_lock(PollerMutex);
+            while (PollerRunning)
+            {
+                deadline += Tick;
+                if (PollerCondition.wait_until(poller_lock, deadline, [this]{ return !PollerRunning; }))
+                    break;
+                // Missed ticks are not caught up, because a burst of stale samples is useless to the views.
+                auto now = std::chrono::steady_clock::now();
+                if (now - deadline > Tick) deadline = now;
+
+                poller_lock.unlock();
+                try
+                {
+                    Poll(now);
+                }
+                catch (const std::exception&)
+                {
+                    // Subscriptions will be sampled again in the next period.
+                }
+                poller_lock.lock();
+            }
+        });
+    }
+
+    /// Fetch the variables due at the given time, and invoke the callbacks of their subscriptions.
+    void ReaderHub::Poll(std::chrono::steady_clock::time_point now)
+    {
+        std::vector<std::pair<std::string, std::string>> variables;
+        // Callbacks of due subscriptions, the offsets of their variable indexes and their counts of variables.
+        struct DueSubscription
+        {
+            std::shared_ptr<SubscriptionCallbacks> Callbacks;
+            std::size_t Offset;
+            std::size_t VariablesCount;
+        };
+        std::vector<DueSubscription> due_subscriptions;
+        std::vector<std::size_t> variable_index_list;
+        {
+            std::unique_lock lock(SubscriptionsMutex);
+            // Subscriptions of the same variable share one fetched value.
+            std::map<std::pair<std::string_view, std::string_view>, std::size_t> variable_indexes;
+            for (auto& [id, subscription] : Subscriptions)
+            {
+                if (subscription.NextTime > now) continue;
+                subscription.NextTime += subscription.Interval;
+                if (subscription.NextTime <= now) subscription.NextTime = now + subscription.Interval;
+
+                due_subscriptions.push_back({subscription.Callbacks, variable_index_list.size(),
+                                             subscription.Variables.size()});
+                for (const auto& [unit_name, variable_name] : subscription.Variables)
+                {
+                    auto [finder, inserted] = variable_indexes.emplace(
+                            std::make_pair(std::string_view(unit_name), std::string_view(variable_name)),
+                            variables.size());
+                    if (inserted) variables.emplace_back(unit_name, variable_name);
+                    variable_index_list.push_back(finder->second);
+                }
+            }
+        }
+        if (variables.empty()) return;
+
+        auto values = Fetch(variables);
+
+        // Callbacks are invoked without the subscriptions mutex, so they can not block subscribing threads.
+        std::vector<std::optional<std::string>> group_values;
+        for (const auto& due_subscription : due_subscriptions)
+        {
+            auto& callbacks = *due_subscription.Callbacks;
+            std::unique_lock callback_lock(callbacks.Mutex);
+            // Subscriptions may have been cancelled during the fetch, or by previous callbacks.
+            if (!callbacks.Active) continue;
+            if (callbacks.GroupCallback)
+            {
+                group_values.clear();
+                for (std::size_t index = 0; index < due_subscription.VariablesCount; ++index)
+                {
+                    group_values.push_back(values[variable_index_list[due_subscription.Offset + index]]);
+                }
+                callbacks.GroupCallback(group_values);
+            }
+            else if (callbacks.Callback)
+            {
+                callbacks.Callback(values[variable_index_list[due_subscription.Offset]]);
+            }
+        }
+    }
+
+    /// Query the values of variables of any units on the calling thread, without a subscription.
+    std::vector<std::optional<std::string>> ReaderHub::QueryTexts(
+            const std::vector<std::pair<std::string, std::string>> &variables)
+    {
+        if (variables.empty()) return {};
+        return Fetch(variables);
+    }
+
+    /// Count the round trips of a fetch of the given variables, one per unit on a cluster and one otherwise.
+    std::size_t ReaderHub::CountRoundTrips(const std::vector<std::pair<std::string, std::string>>& variables,
+                                           const std::vector<std::size_t>& indexes) const
+    {
+        if (indexes.empty()) return 0;
+        if (!Backend->IsClustered()) return 1;
+        std::unordered_set<std::string_view> unit_names;
+        for (auto index : indexes)
+        {
+            unit_names.insert(variables[index].first);
+        }
+        return unit_names.size();
+    }
+
+    /// Fetch the values of the given variables.
+    std::vector<std::optional<std::string>> ReaderHub::Fetch(
+            const std::vector<std::pair<std::string, std::string>> &variables)
+    {
+        std::unique_lock lock(FetchMutex);
+        std::vector<std::optional<std::string>> values(variables.size());
+        std::vector<std::size_t> remote_indexes;
+        remote_indexes.reserve(variables.size());
+
+        if (SharedMemory.load(std::memory_order_relaxed))
+        {
+            std::string value;
+            auto now = std::chrono::steady_clock::now();
+            for (std::size_t index = 0; index < variables.size(); ++index)
+            {
+                const auto& [unit_name, variable_name] = variables[index];
+                auto& region = Regions[unit_name];
+                if (region ? region->IsClosed() : now >= RegionRetryTimes[unit_name])
+                {
+                    region = SharedMemoryRegion::Open(unit_name);
+                    // Units without a region are only looked up again after the retry interval.
+                    if (!region) RegionRetryTimes[unit_name] = now + RegionRetryInterval;
+                }
+                auto state = region ? region->Read(variable_name, value) : SharedMemoryRegion::ValueState::Missing;
+                if (state == SharedMemoryRegion::ValueState::Present)
+                {
+                    values[index] = value;
+                }
+                else if (state != SharedMemoryRegion::ValueState::Removed)
+                {
+                    remote_indexes.push_back(index);
+                }
+            }
+            if (remote_indexes.empty()) return values;
+        }
+        else
+        {
+            Regions.clear();
+            RegionRetryTimes.clear();
+            for (std::size_t index = 0; index < variables.size(); ++index)
+            {
+                remote_indexes.push_back(index);
+            }
+        }
+
+        if (Layout.load(std::memory_order_relaxed) == InspectionReader::StorageLayout::Keys)
+        {
+            // Keys of all units are read in one MGET, or one MGET per unit on a cluster.
+            std::vector<std::string> keys;
+            keys.reserve(remote_indexes.size());
+            for (auto index : remote_indexes)
+            {
+                keys.emplace_back("inspections/" + MakeUnitTag(variables[index].first, Backend.get()) + "/" +
+                                  variables[index].second);
+            }
+            auto remote_values = Backend->MultiGet(keys);
+            FetchCount.fetch_add(CountRoundTrips(variables, remote_indexes), std::memory_order_relaxed);
+            for (std::size_t index = 0; index < remote_indexes.size(); ++index)
+            {
+                values[remote_indexes[index]] = std::move(remote_values[index]);
+            }
+            return values;
+        }
+
+        // Values of a unit are fields of its own hash, the HMGETs of all units are sent in one pipeline,
+        // or one pipeline per hash tag on a cluster.
+        std::unordered_map<std::string_view, std::size_t> unit_positions;
+        std::vector<std::string> keys;
+        std::vector<std::vector<std::string>> fields;
+        std::vector<std::vector<std::size_t>> unit_indexes;
+        for (auto index : remote_indexes)
+        {
+            const auto& unit_name = variables[index].first;
+            auto [position, inserted] = unit_positions.try_emplace(unit_name, keys.size());
+            if (inserted)
+            {
+                keys.emplace_back("inspection_values/" + MakeUnitTag(unit_name, Backend.get()));
+                fields.emplace_back();
+                unit_indexes.emplace_back();
+            }
+            fields[position->second].push_back(variables[index].second);
+            unit_indexes[position->second].push_back(index);
+        }
+        auto remote_values = Backend->MultiHashMultiGet(keys, fields);
+        FetchCount.fetch_add(CountRoundTrips(variables, remote_indexes), std::memory_order_relaxed);
+        for (std::size_t unit_index = 0; unit_index < unit_indexes.size(); ++unit_index)
+        {
+            const auto& indexes = unit_indexes[unit_index];
+            auto& unit_values = remote_values[unit_index];
+            for (std::size_t index = 0; index < indexes.size() && index < unit_values.size(); ++index)
+            {
+                values[indexes[index]] = std::move(unit_values[index]);
+            }
+        }
+        return values;
+    }
+}
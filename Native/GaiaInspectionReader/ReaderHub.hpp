@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "InspectionReader.hpp"
+
+namespace Gaia::InspectionService
+{
+    /**
+     * @brief Poller shared by many views in a process, which merges their reads into one fetch per tick.
+     * @details
+     *  Views subscribe to (unit, variable, frequency) triples instead of polling with their own readers.
+     *  In each tick, the variables due in any subscription are fetched once, with one MGET for all units
+     *  in the keys layout, or with the HMGETs of all units in one pipeline in the hash layout (one pipeline
+     *  per hash tag on a cluster), and the values are fanned out to all subscriptions of the same variable.
+     *  Callbacks are invoked on the poller thread.
+     */
+    class ReaderHub
+    {
+    public:
+        /**
+         * @brief Callback of a polled value.
+         * @param value Value text of the variable, std::nullopt if the variable does not exist.
+         */
+        using SampleCallback = std::function<void(const std::optional<std::string>& value)>;
+        /**
+         * @brief Callback of the values of a group of variables polled together.
+         * @param values Value texts in the order of the subscribed variables, std::nullopt for missing ones.
+         */
+        using GroupSampleCallback = std::function<void(const std::vector<std::optional<std::string>>& values)>;
+
+        /**
+         * @brief Share the connection of this process to the Redis server.
+         * @param port Port of the Redis server.
+         * @param ip IP address of the Redis server.
+         */
+        explicit ReaderHub(unsigned int port = 6379, const std::string& ip = "127.0.0.1");
+        /**
+         * @brief Read the variables from the given backend.
+         * @param backend Backend which stores the variables, it should be the same one used by the clients.
+         * @param tick Length of a tick, frequencies of subscriptions will be rounded to ticks.
+         */
+        explicit ReaderHub(std::shared_ptr<StorageBackend> backend,
+                           std::chrono::steady_clock::duration tick = std::chrono::milliseconds(10));
+
+        /// Stop the poller thread.
+        virtual ~ReaderHub();
+
+        ReaderHub(const ReaderHub&) = delete;
+        ReaderHub& operator=(const ReaderHub&) = delete;
+
+    protected:
+        /// Backend which stores the variables.
+        std::shared_ptr<StorageBackend> Backend;
+        /// Length of a tick.
+        const std::chrono::steady_clock::duration Tick;
+        /// Layout of the variables to read from.
+        std::atomic<InspectionReader::StorageLayout> Layout {InspectionReader::StorageLayout::Keys};
+        /// Whether values are read from the shared memory regions of the units first.
+        std::atomic<bool> SharedMemory {false};
+        /// Mutex for fetches, which share the mapped regions.
+        std::mutex FetchMutex;
+        /// Mapped shared memory regions indexed by unit names, only accessed under the fetch mutex.
+        std::unordered_map<std::string, std::unique_ptr<SharedMemoryRegion>> Regions;
+        /// Times after which the missing regions are looked up again, only accessed under the fetch mutex.
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> RegionRetryTimes;
+
+        /// Callbacks of a subscription, shared with the poller thread which invokes them outside of the lock.
+        struct SubscriptionCallbacks
+        {
+            /// Held while the callbacks are invoked, so cancellations wait for a running callback.
+            /// It is recursive, so a callback can cancel its own subscription.
+            std::recursive_mutex Mutex;
+            /// Cleared when the subscription is cancelled, callbacks are only invoked while it is set.
+            bool Active {true};
+            /// Callback to invoke with the sampled value of a single variable.
+            SampleCallback Callback;
+            /// Callback to invoke with the sampled values of a group, used instead of the single one if set.
+            GroupSampleCallback GroupCallback;
+        };
+
+        /// Information of a subscription.
+        struct Subscription
+        {
+            /// Pairs of unit names and variable names of the subscribed variables.
+            std::vector<std::pair<std::string, std::string>> Variables;
+            /// Interval between two samples.
+            std::chrono::steady_clock::duration Interval;
+            /// Time when the next sample is due.
+            std::chrono::steady_clock::time_point NextTime;
+            /// Callbacks of this subscription.
+            std::shared_ptr<SubscriptionCallbacks> Callbacks;
+        };
+
+        /// Mutex for subscriptions, it is not held while the callbacks are being invoked.
+        std::mutex SubscriptionsMutex;
+        /// Subscriptions indexed by their ID.
+        std::unordered_map<std::size_t, Subscription> Subscriptions;
+        /// ID for the next subscription.
+        std::size_t NextSubscriptionID {0};
+
+        /// Mutex for the poller thread.
+        std::mutex PollerMutex;
+        /// Condition used to notify the poller thread to stop.
+        std::condition_variable PollerCondition;
+        /// Thread which polls the subscribed variables.
+        std::thread PollerThread;
+        /// Whether the poller thread should keep running.
+        std::atomic<bool> PollerRunning {false};
+        /// Count of round trips to the backend made by fetches.
+        std::atomic<std::size_t> FetchCount {0};
+
+        /// Count the round trips of a fetch of the given variables, one per unit on a cluster and one otherwise.
+        std::size_t CountRoundTrips(const std::vector<std::pair<std::string, std::string>>& variables,
+                                    const std::vector<std::size_t>& indexes) const;
+
+        /// Add a subscription and start the poller thread if it is not running.
+        std::size_t AddSubscription(std::vector<std::pair<std::string, std::string>> variables, double frequency,
+                                    SampleCallback callback, GroupSampleCallback group_callback);
+        /// Start the poller thread if it is not running.
+        void StartPoller();
+        /// Fetch the variables due at the given time, and invoke the callbacks of their subscriptions.
+        void Poll(std::chrono::steady_clock::time_point now);
+        /**
+         * @brief Fetch the values of the given variables.
+         * @param variables Pairs of unit names and variable names.
+         * @return Values in the same order of the given variables.
+         */
+        std::vector<std::optional<std::string>> Fetch(
+                const std::vector<std::pair<std::string, std::string>>& variables);
+
+    public:
+        /**
+         * @brief Change the layout of the variables to read from.
+         * @param layout Layout used by the inspection clients.
+         */
+        void SetStorageLayout(InspectionReader::StorageLayout layout) noexcept
+        {
+            Layout.store(layout, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Enable or disable reading values from the shared memory regions of the units.
+         * @param enable If true, values will be read from the regions first, and only the others are fetched.
+         */
+        void SetSharedMemory(bool enable) noexcept
+        {
+            SharedMemory.store(enable, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Subscribe the values of a variable at the given frequency.
+         * @param unit_name Name of the unit of the variable.
+         * @param variable_name Name of the variable.
+         * @param frequency Count of samples per second.
+         * @param callback Callback to invoke with the sampled values on the poller thread.
+         * @return ID of this subscription, used to unsubscribe.
+         * @details Unsubscribe(...) can be called inside a callback.
+         */
+        std::size_t Subscribe(const std::string& unit_name, const std::string& variable_name,
+                              double frequency, SampleCallback callback);
+
+        /**
+         * @brief Subscribe the values of a group of variables, which are always sampled in the same fetch.
+         * @param variables Pairs of unit names and variable names, the units can differ.
+         * @param frequency Count of samples per second.
+         * @param callback Callback to invoke with the values of all variables on the poller thread.
+         * @return ID of this subscription, used to unsubscribe.
+         * @details
+         *  Values passed to one invocation were read in one round trip, so they can be compared with each other,
+         *  while separate subscriptions may be sampled in different ticks.
+         */
+        std::size_t SubscribeGroup(std::vector<std::pair<std::string, std::string>> variables,
+                                   double frequency, GroupSampleCallback callback);
+
+        /**
+         * @brief Query the values of variables of any units on the calling thread, without a subscription.
+         * @param variables Pairs of unit names and variable names.
+         * @return Values in the same order of the given variables.
+         * @details
+         *  All values are read in one round trip, with one MGET in the keys layout, or with the HMGETs of all
+         *  units in one pipeline in the hash layout, which takes one round trip per hash tag on a cluster.
+         *  So callers which pace themselves can sample many variables per tick.
+         */
+        std::vector<std::optional<std::string>> QueryTexts(
+                const std::vector<std::pair<std::string, std::string>>& variables);
+
+        /**
+         * @brief Cancel a subscription.
+         * @param id ID of the subscription.
+         * @details The callback of this subscription will not be invoked after this function returns.
+         */
+        void Unsubscribe(std::size_t id);
+
+        /// Get the count of round trips made by fetches, one per tick with due subscriptions, one per unit on clusters.
+        [[nodiscard]] std::size_t GetFetchCount() const noexcept
+        {
+            return FetchCount.load(std::memory_order_relaxed);
+        }
+    };
+}
@@ -0,0 +1,161 @@
+#include "DashboardWindow.hpp"
+
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QScrollArea>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fnmatch.h>
+#include "TileStyle.hpp"
+
+namespace Gaia::InspectionTile
+{
+    /// Build the tile.
+    DashboardTile::DashboardTile(const QString& title, QWidget* parent) : QFrame(parent)
+    {
+        setFrameShape(QFrame::StyledPanel);
+        setStyleSheet("background-color: rgb(46, 52, 54);");
+
+        auto* layout = new QHBoxLayout(this);
+        QFont font;
+        font.setPointSize(20);
+
+        auto* label_name = new QLabel(title, this);
+        label_name->setFont(font);
+        label_name->setStyleSheet("color: rgb(238, 238, 236);");
+        layout->addWidget(label_name);
+
+        LabelValue = new QLabel("Value", this);
+        LabelValue->setFont(font);
+        LabelValue->setAlignment(Qt::AlignCenter);
+        LabelValue->setStyleSheet("color: rgb(136, 138, 133);");
+        layout->addWidget(LabelValue);
+    }
+
+    /// Display the given value text if it differs from the displayed one.
+    bool DashboardTile::DisplayValue(const std::optional<std::string>& value)
+    {
+        if (DisplayedValue && *DisplayedValue == value) return false;
+        DisplayedValue = value;
+        auto [text, style] = GetValueStyle(value);
+        LabelValue->setText(text);
+        if (style != DisplayedStyle)
+        {
+            LabelValue->setStyleSheet(style);
+            DisplayedStyle = std::move(style);
+        }
+        return true;
+    }
+
+    /// Build the tiles and subscribe their variables.
+    DashboardWindow::DashboardWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                                     std::vector<DashboardEntry> entries,
+                                     unsigned int update_frequency, unsigned int columns_count, QWidget* parent) :
+        QMainWindow(parent), Hub(std::move(hub))
+    {
+        setWindowTitle("Gaia Inspection - Dashboard");
+        setStyleSheet("background-color: rgb(32, 36, 38);");
+        if (columns_count == 0) columns_count = 1;
+        if (update_frequency == 0) update_frequency = 1;
+
+        auto* grid_widget = new QWidget();
+        auto* grid = new QGridLayout(grid_widget);
+        std::vector<std::pair<std::string, std::string>> variables;
+        variables.reserve(entries.size());
+        Tiles.reserve(entries.size());
+        for (std::size_t index = 0; index < entries.size(); ++index)
+        {
+            const auto& entry = entries[index];
+            auto* tile = new DashboardTile(QString::fromStdString(
+                    entry.Title.empty() ? entry.UnitName + "/" + entry.VariableName : entry.Title), grid_widget);
+            grid->addWidget(tile, static_cast<int>(index / columns_count), static_cast<int>(index % columns_count));
+            Tiles.push_back(tile);
+            variables.emplace_back(entry.UnitName, entry.VariableName);
+        }
+
+        auto* scroll_area = new QScrollArea(this);
+        scroll_area->setWidgetResizable(true);
+        scroll_area->setWidget(grid_widget);
+        setCentralWidget(scroll_area);
+
+        if (!Hub || variables.empty()) return;
+        HubSubscriptionID = Hub->SubscribeGroup(std::move(variables), update_frequency,
+            [this](const std::vector<std::optional<std::string>>& values){
+                // Values arrive on the poller thread of the hub, so the tiles are updated in the GUI thread.
+                QMetaObject::invokeMethod(this, [this, values]{ DisplayValues(values); }, Qt::QueuedConnection);
+            });
+    }
+
+    /// Cancel the subscription.
+    DashboardWindow::~DashboardWindow()
+    {
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+        }
+    }
+
+    /// Display the values polled in one tick, in the order of the tiles.
+    void DashboardWindow::DisplayValues(const std::vector<std::optional<std::string>>& values)
+    {
+        auto count = std::min(values.size(), Tiles.size());
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            Tiles[index]->DisplayValue(values[index]);
+        }
+    }
+
+    /// Load the entries from a layout file.
+    std::vector<DashboardEntry> DashboardWindow::LoadLayout(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file) throw std::runtime_error("Can not open the layout file " + path + ".");
+
+        std::vector<DashboardEntry> entries;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream stream(line);
+            std::string full_name;
+            if (!(stream >> full_name) || full_name.front() == '#') continue;
+            auto separator = full_name.find('/');
+            if (separator == std::string::npos) continue;
+
+            DashboardEntry entry {full_name.substr(0, separator), full_name.substr(separator + 1), {}};
+            std::getline(stream >> std::ws, entry.Title);
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    }
+
+    /// Find the variables whose full names match a glob pattern.
+    std::vector<DashboardEntry> DashboardWindow::MatchVariables(InspectionService::InspectionReader& reader,
+                                                                const std::string& pattern)
+    {
+        std::vector<std::string> full_names;
+        InspectionService::InspectionReader::VariableCursor cursor;
+        do
+        {
+            for (auto& full_name : reader.QueryVariables(cursor))
+            {
+                if (fnmatch(pattern.c_str(), full_name.c_str(), 0) == 0)
+                {
+                    full_names.push_back(std::move(full_name));
+                }
+            }
+        }while (!cursor.IsFinished());
+        std::sort(full_names.begin(), full_names.end());
+
+        std::vector<DashboardEntry> entries;
+        entries.reserve(full_names.size());
+        for (const auto& full_name : full_names)
+        {
+            auto separator = full_name.find('/');
+            if (separator == std::string::npos) continue;
+            entries.push_back({full_name.substr(0, separator), full_name.substr(separator + 1), {}});
+        }
+        return entries;
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QMainWindow>
+#include <QFrame>
+#include <QLabel>
+#include <string>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+
+namespace Gaia::InspectionTile
+{
+    /// Variable shown in a tile of the dashboard.
+    struct DashboardEntry
+    {
+        /// Name of the unit of the variable.
+        std::string UnitName;
+        /// Name of the variable.
+        std::string VariableName;
+        /// Title displayed in the tile, "<unit>/<variable>" is displayed if it is empty.
+        std::string Title;
+    };
+
+    /**
+     * @brief Tile of a dashboard, which displays the name and the value of a variable.
+     * @details Labels are only touched when the value or its style changes, so unchanged tiles are not repainted.
+     */
+    class DashboardTile : public QFrame
+    {
+    public:
+        /**
+         * @brief Build the tile.
+         * @param title Title to display.
+         * @param parent Parent widget.
+         */
+        explicit DashboardTile(const QString& title, QWidget* parent = nullptr);
+
+        /**
+         * @brief Display the given value text if it differs from the displayed one.
+         * @return True if the tile changed and will be repainted.
+         */
+        bool DisplayValue(const std::optional<std::string>& value);
+
+    private:
+        /// Label of the value.
+        QLabel* LabelValue {nullptr};
+        /// Displayed value, used to skip unchanged values.
+        std::optional<std::optional<std::string>> DisplayedValue;
+        /// Applied style sheet of the value label, which is expensive to set.
+        QString DisplayedStyle;
+    };
+
+    /**
+     * @brief Window which lays out many tiles in a grid, refreshed by one batched query per tick.
+     * @details
+     *  All variables are polled by one group subscription of the hub, so each tick costs one MGET in the keys
+     *  layout, or one pipeline of HMGETs in the hash layout (one per hash tag on a cluster),
+     *  no matter how many tiles are shown.
+     */
+    class DashboardWindow : public QMainWindow
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Build the tiles and subscribe their variables.
+         * @param hub Hub which polls the variables.
+         * @param entries Variables to display, in the order of the tiles.
+         * @param update_frequency Count of polls per second.
+         * @param columns_count Count of tiles in a row.
+         * @param parent Parent widget.
+         */
+        DashboardWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                        std::vector<DashboardEntry> entries,
+                        unsigned int update_frequency = 30, unsigned int columns_count = 4,
+                        QWidget* parent = nullptr);
+
+        /// Cancel the subscription.
+        ~DashboardWindow() override;
+
+        /**
+         * @brief Load the entries from a layout file.
+         * @param path Path of the layout file.
+         * @return Entries in the order of the file.
+         * @throw std::runtime_error If the file can not be opened.
+         * @details
+         *  Each line is "<unit>/<variable>", optionally followed by whitespace and a title.
+         *  Empty lines and lines starting with '#' are ignored.
+         */
+        static std::vector<DashboardEntry> LoadLayout(const std::string& path);
+
+        /**
+         * @brief Find the variables whose full names match a glob pattern.
+         * @param reader Reader bound to all units, whose variables are listed.
+         * @param pattern Glob pattern of "<unit>/<variable>", such as "plant/motor_*".
+         * @return Entries of the matched variables, sorted by their full names.
+         */
+        static std::vector<DashboardEntry> MatchVariables(InspectionService::InspectionReader& reader,
+                                                          const std::string& pattern);
+
+    protected:
+        /// Display the values polled in one tick, in the order of the tiles.
+        void DisplayValues(const std::vector<std::optional<std::string>>& values);
+
+    private:
+        /// Hub which polls the variables.
+        std::shared_ptr<InspectionService::ReaderHub> Hub;
+        /// ID of the group subscription in the hub.
+        std::optional<std::size_t> HubSubscriptionID;
+        /// Tiles in the order of the entries.
+        std::vector<DashboardTile*> Tiles;
+    };
+}
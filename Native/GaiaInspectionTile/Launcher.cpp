@@ -1,10 +1,12 @@
 #include <iostream>
 #include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <GaiaInspectionReader/GaiaInspectionReader.hpp>
 
 #include <QApplication>
 #include "TileWindow.hpp"
+#include "DashboardWindow.hpp"
 
 int main(int arguments_count, char** arguments)
 {
@@ -22,9 +24,18 @@ int main(int arguments_count, char** arguments)
              "Port of the Redis server.")
             ("unit,u", value<std::string>(),
              "name of the unit to watch")
-            ("variable,v", value<std::string>(), "name of the variable to watch.")
+            ("variable,v", value<std::vector<std::string>>()->multitoken(),
+             "names of the variables to watch, each one is shown in its own tile.")
             ("frequency,f", value<unsigned int>(), "query frequency, aka. query times per second.")
-            ("list,l", "list all inspection variables.");
+            ("list,l", "list all inspection variables.")
+            ("layout", value<std::string>(),
+             "show a dashboard of the variables in the layout file, one \"<unit>/<variable> [title]\" per line.")
+            ("glob,g", value<std::string>(),
+             "show a dashboard of the variables whose \"<unit>/<variable>\" names match the glob pattern.")
+            ("columns,c", value<unsigned int>()->default_value(4), "count of tiles in a row of the dashboard.")
+            ("hash", "read variables stored in the hash layout.")
+            ("shm", "read values from shared memory when the client runs on this host.")
+            ("push", "receive change notifications instead of polling, the client should enable notifications.");
 
     variables_map variables;
     store(parse_command_line(arguments_count, arguments, options), variables);
@@ -36,8 +47,24 @@ int main(int arguments_count, char** arguments)
         return 0;
     }
 
-    auto reader = std::make_unique<InspectionReader>("*", variables["port"].as<unsigned int>(),
-                            variables["host"].as<std::string>());
+    // All tiles share one connection, and their polls are merged by the hub.
+    auto connection = std::make_shared<sw::redis::Redis>(
+            "tcp://" + variables["host"].as<std::string>() + ":" +
+            std::to_string(variables["port"].as<unsigned int>()));
+    auto reader = std::make_shared<InspectionReader>("*", connection);
+    auto hub = std::make_shared<ReaderHub>(std::make_shared<RedisBackend>(connection));
+
+    if (variables.count("hash"))
+    {
+        reader->SetStorageLayout(InspectionReader::StorageLayout::Hash);
+        hub->SetStorageLayout(InspectionReader::StorageLayout::Hash);
+    }
+
+    if (variables.count("shm"))
+    {
+        reader->SetSharedMemory(true);
+        hub->SetSharedMemory(true);
+    }
 
     if (variables.count("list"))
     {
@@ -50,6 +77,38 @@ int main(int arguments_count, char** arguments)
         return 0;
     }
 
+    if (variables.count("layout") || variables.count("glob"))
+    {
+        // All tiles of the dashboard are refreshed by one group subscription, instead of one window per variable.
+        std::vector<DashboardEntry> entries;
+        if (variables.count("layout"))
+        {
+            entries = DashboardWindow::LoadLayout(variables["layout"].as<std::string>());
+        }
+        if (variables.count("glob"))
+        {
+            auto pattern = variables["glob"].as<std::string>();
+            if (pattern.find('/') == std::string::npos && variables.count("unit"))
+            {
+                pattern = variables["unit"].as<std::string>() + "/" + pattern;
+            }
+            auto matched_entries = DashboardWindow::MatchVariables(*reader, pattern);
+            entries.insert(entries.end(), matched_entries.begin(), matched_entries.end());
+        }
+        if (entries.empty())
+        {
+            std::cout << "No variable to show." << std::endl;
+            return 1;
+        }
+
+        QApplication application(arguments_count, arguments);
+        DashboardWindow window(hub, std::move(entries),
+                               variables.count("frequency") ? variables["frequency"].as<unsigned int>() : 30,
+                               variables["columns"].as<unsigned int>());
+        window.show();
+        return QApplication::exec();
+    }
+
     std::string unit_name;
     if (!variables.count("unit"))
     {
@@ -60,15 +119,17 @@ int main(int arguments_count, char** arguments)
     {
         unit_name = variables["unit"].as<std::string>();
     }
-    std::string variable_name;
+    std::vector<std::string> variable_names;
     if (!variables.count("variable"))
     {
+        std::string variable_name;
         std::cout << "Input variable name: ";
         std::cin >> variable_name;
+        variable_names.push_back(variable_name);
     }
     else
     {
-        variable_name = variables["variable"].as<std::string>();
+        variable_names = variables["variable"].as<std::vector<std::string>>();
     }
 
     unsigned int frequency = 1;
@@ -81,8 +142,17 @@ int main(int arguments_count, char** arguments)
 
     QApplication application(arguments_count, arguments);
 
-    TileWindow window(std::move(reader), variable_name, frequency);
-    window.show();
+    std::vector<std::unique_ptr<TileWindow>> windows;
+    for (const auto& variable_name : variable_names)
+    {
+        auto window = std::make_unique<TileWindow>(hub, reader, variable_name, frequency);
+        if (variables.count("push"))
+        {
+            window->SubscribeChanges();
+        }
+        window->show();
+        windows.push_back(std::move(window));
+    }
 
     return QApplication::exec();
 }
\ No newline at end of file
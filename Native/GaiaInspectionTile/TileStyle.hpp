@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QString>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace Gaia::InspectionTile
+{
+    /**
+     * @brief Get the displayed text and the style sheet of a value, shared by tile windows and dashboard tiles.
+     * @param value Value text of the variable, std::nullopt if the variable does not exist.
+     * @return Pair of the displayed text and the style sheet of the value label.
+     */
+    inline std::pair<QString, QString> GetValueStyle(const std::optional<std::string>& value)
+    {
+        if (!value) return {"EMPTY", "color: rgb(136, 138, 133);"};
+        if (*value == "true") return {"TRUE", "color: rgb(138, 226, 52);"};
+        if (*value == "false") return {"FALSE", "color: rgb(239, 41, 41);"};
+        return {QString::fromStdString(*value), "color: rgb(114, 159, 207);"};
+    }
+}
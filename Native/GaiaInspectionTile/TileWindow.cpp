@@ -8,19 +8,22 @@
 
 #include <utility>
 #include <QMessageBox>
+#include "TileStyle.hpp"
 // Generated from ChartWindow.ui with QtUIC
 #include "ui_TileWindow.h"
 
 namespace Gaia::InspectionTile
 {
     /// Constructor which will bind the inspection variables reader.
-    TileWindow::TileWindow(std::unique_ptr<InspectionService::InspectionReader> &&reader,
+    TileWindow::TileWindow(std::shared_ptr<InspectionService::ReaderHub> hub,
+                           std::shared_ptr<InspectionService::InspectionReader> reader,
                            std::string variable_name, unsigned int update_frequency, QWidget *parent) :
-        Reader(std::move(reader)), VariableName(std::move(variable_name)), ui(new Ui::TileWindow)
+        QMainWindow(parent), Hub(std::move(hub)), Reader(std::move(reader)),
+        VariableName(std::move(variable_name)), ui(new Ui::TileWindow)
     {
         ui->setupUi(this);
 
-        if (!Reader)
+        if (!Hub || !Reader)
         {
             QMessageBox::critical(this, "Error", "Can not connect to the inspected variable.");
             QApplication::exit(1);
@@ -30,44 +33,56 @@ namespace Gaia::InspectionTile
 
         ui->labelName->setText(QString::fromStdString(VariableName));
 
-        UpdateTimer = new QTimer(this);
-        if (update_frequency < 0) update_frequency = 1;
-        UpdateTimer->setInterval(static_cast<int>(1000 / update_frequency));
-
-        connect(UpdateTimer, SIGNAL(timeout()), this, SLOT(OnUpdate()));
-
-        UpdateTimer->start();
+        if (update_frequency == 0) update_frequency = 1;
+        // Tiles of the same process share the polls of the hub, instead of polling with their own timers.
+        HubSubscriptionID = Hub->Subscribe(Reader->GetUnitName(), VariableName, update_frequency,
+            [this](const std::optional<std::string>& value){
+                QMetaObject::invokeMethod(this, [this, value]{ DisplayValue(value); }, Qt::QueuedConnection);
+            });
     }
 
     /// Destructor which will release resources.
     TileWindow::~TileWindow()
     {
-        UpdateTimer->stop();
+        if (HubSubscriptionID)
+        {
+            Hub->Unsubscribe(*HubSubscriptionID);
+        }
+        if (SubscriptionID)
+        {
+            Reader->Unsubscribe(*SubscriptionID);
+        }
         delete ui;
     }
 
-    /// Update displayed value.
-    void TileWindow::OnUpdate()
+    /// Switch from timer polling to change notifications.
+    void TileWindow::SubscribeChanges()
     {
-        auto result = Reader->QueryText(VariableName);
-        if (!result)
-        {
-            ui->labelValue->setText("EMPTY");
-            ui->labelValue->setStyleSheet("color: rgb(136, 138, 133);");
-            return;
-        }
-        else
+        if (SubscriptionID) return;
+        if (HubSubscriptionID)
         {
-            ui->labelValue->setText(QString::fromStdString(*result));
-            ui->labelValue->setStyleSheet("color: rgb(114, 159, 207);");
-        }
-        if (*result == "true"){
-            ui->labelValue->setText("TRUE");
-            ui->labelValue->setStyleSheet("color: rgb(138, 226, 52);");
-        }
-        else if (*result == "false"){
-            ui->labelValue->setText("FALSE");
-            ui->labelValue->setStyleSheet("color: rgb(239, 41, 41);");
+            Hub->Unsubscribe(*HubSubscriptionID);
+            HubSubscriptionID.reset();
         }
+        OnUpdate();
+        SubscriptionID = Reader->Subscribe(VariableName,
+            [this](const std::string&, const std::optional<std::string>& value){
+                // Notifications arrive on the subscriber thread, so the display is updated in the GUI thread.
+                QMetaObject::invokeMethod(this, [this, value]{ DisplayValue(value); }, Qt::QueuedConnection);
+            });
+    }
+
+    /// Update displayed value.
+    void TileWindow::OnUpdate()
+    {
+        DisplayValue(Reader->QueryText(VariableName));
+    }
+
+    /// Display the given value text.
+    void TileWindow::DisplayValue(const std::optional<std::string>& result)
+    {
+        auto [text, style] = GetValueStyle(result);
+        ui->labelValue->setText(text);
+        ui->labelValue->setStyleSheet(style);
     }
 }
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <QMainWindow>
-#include <QTimer>
 #include <string>
 #include <memory>
+#include <optional>
 #include <GaiaInspectionReader/GaiaInspectionReader.hpp>
 
 namespace Gaia::InspectionTile
@@ -17,22 +17,42 @@ namespace Gaia::InspectionTile
     Q_OBJECT
 
     public:
-        /// Constructor which will bind the inspection variables reader.
+        /**
+         * @brief Constructor which will bind the inspection variables reader.
+         * @param hub Hub which polls the variable, shared by all tiles of this process.
+         * @param reader Reader bound to the unit of the variable, used to receive change notifications.
+         * @param variable_name Name of the variable to inspect.
+         * @param update_frequency Count of polls per second.
+         * @param parent Parent widget.
+         */
         TileWindow(
-                std::unique_ptr<InspectionService::InspectionReader>&& reader,
+                std::shared_ptr<InspectionService::ReaderHub> hub,
+                std::shared_ptr<InspectionService::InspectionReader> reader,
                 std::string  variable_name,
                 unsigned int update_frequency = 30,
                 QWidget *parent = nullptr);
         /// Destructor which will release resources.
         ~TileWindow() override;
 
+        /**
+         * @brief Switch from timer polling to change notifications.
+         * @details The displayed value will only be updated when the inspection client publishes a change.
+         */
+        void SubscribeChanges();
+
     protected slots:
         /// Update displayed value.
         void OnUpdate();
 
+    protected:
+        /// Display the given value text.
+        void DisplayValue(const std::optional<std::string>& result);
+
     private:
+        /// Hub which polls the inspected variable.
+        std::shared_ptr<InspectionService::ReaderHub> Hub;
         /// Reader for inspected variables.
-        std::unique_ptr<InspectionService::InspectionReader> Reader;
+        std::shared_ptr<InspectionService::InspectionReader> Reader;
 
         /// Name of the variable to inspect.
         std::string VariableName;
@@ -40,7 +60,10 @@ namespace Gaia::InspectionTile
         /// Point to UI object.
         Ui::TileWindow *ui;
 
-        /// Timer for auto update.
-        QTimer* UpdateTimer {nullptr};
+        /// ID of the polling subscription in the hub, only valid when polling.
+        std::optional<std::size_t> HubSubscriptionID;
+
+        /// ID of the change subscription, only valid when subscribed.
+        std::optional<std::size_t> SubscriptionID;
     };
 }
\ No newline at end of file
@@ -0,0 +1,382 @@
+#include "CaptureFile.hpp"
+
+#include <stdexcept>
+#include <string_view>
+#include <zlib.h>
+
+namespace Gaia::InspectionWatcher
+{
+    namespace
+    {
+        /// Magic text at the beginning of capture files.
+        constexpr char FileMagic[] = {'G', 'I', 'C', 'A', 'P', '1'};
+        /// Magic number at the beginning of blocks.
+        constexpr std::uint32_t BlockMagic = 0x4B4C4247; // "GBLK"
+        /// Magic number at the end of the index trailer.
+        constexpr std::uint32_t IndexMagic = 0x58444947; // "GIDX"
+        /// Flag of blocks compressed with zlib.
+        constexpr std::uint32_t CompressedFlag = 1;
+        /// Size of a block header: magic, flags, records count, raw size, stored size, first and last time.
+        constexpr std::size_t BlockHeaderSize = 4 * 5 + 8 * 2;
+        /// Size of the index trailer: index offset, blocks count and magic.
+        constexpr std::size_t IndexTrailerSize = 8 + 4 + 4;
+
+        /// Append a little-endian integer to the buffer.
+        template <typename Integer>
+        void PutInteger(std::string& buffer, Integer value)
+        {
+            auto bits = static_cast<std::make_unsigned_t<Integer>>(value);
+            for (std::size_t index = 0; index < sizeof(Integer); ++index)
+            {
+                buffer.push_back(static_cast<char>(bits & 0xFF));
+                bits >>= 8;
+            }
+        }
+
+        /// Read a little-endian integer from the buffer at the given position.
+        template <typename Integer>
+        Integer GetInteger(const char* buffer)
+        {
+            std::make_unsigned_t<Integer> bits = 0;
+            for (std::size_t index = sizeof(Integer); index > 0; --index)
+            {
+                bits = (bits << 8) | static_cast<unsigned char>(buffer[index - 1]);
+            }
+            return static_cast<Integer>(bits);
+        }
+
+        /// Append a LEB128 varint to the buffer.
+        void PutVarint(std::string& buffer, std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        /// Read a LEB128 varint from the buffer and advance the position.
+        std::uint64_t GetVarint(const std::string& buffer, std::size_t& position)
+        {
+            std::uint64_t value = 0;
+            for (unsigned int shift = 0; shift < 64; shift += 7)
+            {
+                if (position >= buffer.size()) break;
+                auto byte = static_cast<unsigned char>(buffer[position++]);
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) return value;
+            }
+            throw std::runtime_error("Corrupted varint in the capture file.");
+        }
+
+        /// Convert a time point into nanoseconds since the epoch.
+        std::int64_t ToNanoseconds(std::chrono::system_clock::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+
+        /// Convert nanoseconds since the epoch into a time point.
+        std::chrono::system_clock::time_point FromNanoseconds(std::int64_t nanoseconds)
+        {
+            return std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::nanoseconds(nanoseconds)));
+        }
+    }
+
+    /// Create a capture file.
+    CaptureWriter::CaptureWriter(const std::string& path, const std::vector<std::string>& variable_names,
+                                 bool compression, std::size_t block_size) :
+        File(path, std::ios::binary | std::ios::trunc), Compression(compression),
+        BlockSize(block_size > 0 ? block_size : 1)
+    {
+        if (!File) throw std::runtime_error("Can not create the capture file " + path + ".");
+
+        std::string header(FileMagic, sizeof(FileMagic));
+        PutInteger<std::uint32_t>(header, static_cast<std::uint32_t>(variable_names.size()));
+        for (const auto& name : variable_names)
+        {
+            PutInteger<std::uint16_t>(header, static_cast<std::uint16_t>(name.size()));
+            header.append(name, 0, static_cast<std::uint16_t>(name.size()));
+        }
+        File.write(header.data(), static_cast<std::streamsize>(header.size()));
+        WrittenBytes += header.size();
+        Block.reserve(BlockSize + 64);
+    }
+
+    /// Close the file if it is still open.
+    CaptureWriter::~CaptureWriter()
+    {
+        try
+        {
+            Close();
+        }
+        catch (std::exception&)
+        {}
+    }
+
+    /// Append a record, it is written when its block is full or the writer is flushed.
+    void CaptureWriter::Append(std::chrono::system_clock::time_point time, std::uint32_t variable_index,
+                               const std::optional<std::string>& value)
+    {
+        auto nanoseconds = ToNanoseconds(time);
+        if (BlockRecordsCount == 0)
+        {
+            BlockFirstTime = nanoseconds;
+            LastTime = nanoseconds;
+        }
+        // Deltas are zigzag encoded, so a system clock stepping backwards does not break the file.
+        auto delta = nanoseconds - LastTime;
+        PutVarint(Block, (static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63));
+        PutVarint(Block, variable_index);
+        if (value)
+        {
+            PutVarint(Block, value->size() + 1);
+            Block.append(*value);
+        }
+        else
+        {
+            PutVarint(Block, 0);
+        }
+        LastTime = nanoseconds;
+        ++BlockRecordsCount;
+        ++RecordsCount;
+
+        if (Block.size() >= BlockSize) WriteBlock();
+    }
+
+    /// Write the current block into the file.
+    void CaptureWriter::WriteBlock()
+    {
+        if (BlockRecordsCount == 0 || !File.is_open()) return;
+
+        std::uint32_t flags = 0;
+        std::string compressed;
+        const std::string* payload = &Block;
+        if (Compression)
+        {
+            auto compressed_size = compressBound(static_cast<uLong>(Block.size()));
+            compressed.resize(compressed_size);
+            // Blocks which do not shrink are stored as they are.
+            if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size,
+                          reinterpret_cast<const Bytef*>(Block.data()), static_cast<uLong>(Block.size()),
+                          Z_BEST_SPEED) == Z_OK && compressed_size < Block.size())
+            {
+                compressed.resize(compressed_size);
+                payload = &compressed;
+                flags |= CompressedFlag;
+            }
+        }
+
+        std::string header;
+        header.reserve(BlockHeaderSize);
+        PutInteger<std::uint32_t>(header, BlockMagic);
+        PutInteger<std::uint32_t>(header, flags);
+        PutInteger<std::uint32_t>(header, BlockRecordsCount);
+        PutInteger<std::uint32_t>(header, static_cast<std::uint32_t>(Block.size()));
+        PutInteger<std::uint32_t>(header, static_cast<std::uint32_t>(payload->size()));
+        PutInteger<std::int64_t>(header, BlockFirstTime);
+        PutInteger<std::int64_t>(header, LastTime);
+
+        BlockEntries.push_back({BlockFirstTime, LastTime, WrittenBytes});
+        File.write(header.data(), static_cast<std::streamsize>(header.size()));
+        File.write(payload->data(), static_cast<std::streamsize>(payload->size()));
+        if (!File) throw std::runtime_error("Failed to write the capture file.");
+        WrittenBytes += header.size() + payload->size();
+
+        Block.clear();
+        BlockRecordsCount = 0;
+    }
+
+    /// Write the current block, so the records appended so far survive a crash.
+    void CaptureWriter::Flush()
+    {
+        WriteBlock();
+        File.flush();
+    }
+
+    /// Write the current block and the index, then close the file.
+    void CaptureWriter::Close()
+    {
+        if (!File.is_open()) return;
+        WriteBlock();
+
+        std::string index;
+        index.reserve(BlockEntries.size() * 24 + IndexTrailerSize);
+        for (const auto& entry : BlockEntries)
+        {
+            PutInteger<std::int64_t>(index, entry.FirstTime);
+            PutInteger<std::int64_t>(index, entry.LastTime);
+            PutInteger<std::uint64_t>(index, entry.Offset);
+        }
+        PutInteger<std::uint64_t>(index, WrittenBytes);
+        PutInteger<std::uint32_t>(index, static_cast<std::uint32_t>(BlockEntries.size()));
+        PutInteger<std::uint32_t>(index, IndexMagic);
+        File.write(index.data(), static_cast<std::streamsize>(index.size()));
+        WrittenBytes += index.size();
+        File.close();
+    }
+
+    /// Open a capture file.
+    CaptureReader::CaptureReader(const std::string& path) : File(path, std::ios::binary)
+    {
+        if (!File) throw std::runtime_error("Can not open the capture file " + path + ".");
+
+        char buffer[BlockHeaderSize];
+        if (!File.read(buffer, sizeof(FileMagic) + 4) ||
+            std::string_view(buffer, sizeof(FileMagic)) != std::string_view(FileMagic, sizeof(FileMagic)))
+        {
+            throw std::runtime_error(path + " is not a capture file.");
+        }
+        auto variables_count = GetInteger<std::uint32_t>(buffer + sizeof(FileMagic));
+        VariableNames.reserve(variables_count);
+        for (std::uint32_t index = 0; index < variables_count; ++index)
+        {
+            if (!File.read(buffer, 2)) throw std::runtime_error("Truncated header of the capture file.");
+            std::string name(GetInteger<std::uint16_t>(buffer), '\0');
+            if (!File.read(name.data(), static_cast<std::streamsize>(name.size())))
+            {
+                throw std::runtime_error("Truncated header of the capture file.");
+            }
+            VariableNames.push_back(std::move(name));
+        }
+        auto data_offset = static_cast<std::uint64_t>(File.tellg());
+
+        File.seekg(0, std::ios::end);
+        auto file_size = static_cast<std::uint64_t>(File.tellg());
+        // Load the index written on close.
+        if (file_size >= data_offset + IndexTrailerSize)
+        {
+            File.seekg(static_cast<std::streamoff>(file_size - IndexTrailerSize));
+            File.read(buffer, IndexTrailerSize);
+            auto index_offset = GetInteger<std::uint64_t>(buffer);
+            auto blocks_count = GetInteger<std::uint32_t>(buffer + 8);
+            if (File && GetInteger<std::uint32_t>(buffer + 12) == IndexMagic && index_offset >= data_offset &&
+                index_offset + blocks_count * 24ull + IndexTrailerSize == file_size)
+            {
+                File.seekg(static_cast<std::streamoff>(index_offset));
+                BlockEntries.reserve(blocks_count);
+                for (std::uint32_t index = 0; index < blocks_count && File.read(buffer, 24); ++index)
+                {
+                    BlockEntries.push_back({GetInteger<std::int64_t>(buffer), GetInteger<std::int64_t>(buffer + 8),
+                                            GetInteger<std::uint64_t>(buffer + 16)});
+                }
+                if (BlockEntries.size() != blocks_count) BlockEntries.clear();
+            }
+        }
+        // Without a valid index, such as a file of a crashed capture, the complete blocks are scanned.
+        if (BlockEntries.empty())
+        {
+            File.clear();
+            auto offset = data_offset;
+            while (offset + BlockHeaderSize <= file_size)
+            {
+                File.seekg(static_cast<std::streamoff>(offset));
+                if (!File.read(buffer, BlockHeaderSize) || GetInteger<std::uint32_t>(buffer) != BlockMagic) break;
+                auto stored_size = GetInteger<std::uint32_t>(buffer + 16);
+                if (offset + BlockHeaderSize + stored_size > file_size) break;
+                BlockEntries.push_back({GetInteger<std::int64_t>(buffer + 20), GetInteger<std::int64_t>(buffer + 28),
+                                        offset});
+                offset += BlockHeaderSize + stored_size;
+            }
+        }
+        File.clear();
+    }
+
+    /// Get the time of the first record, or the epoch if the file has no record.
+    std::chrono::system_clock::time_point CaptureReader::GetBeginTime() const noexcept
+    {
+        if (BlockEntries.empty()) return {};
+        return FromNanoseconds(BlockEntries.front().FirstTime);
+    }
+
+    /// Get the time of the last record, or the epoch if the file has no record.
+    std::chrono::system_clock::time_point CaptureReader::GetEndTime() const noexcept
+    {
+        if (BlockEntries.empty()) return {};
+        return FromNanoseconds(BlockEntries.back().LastTime);
+    }
+
+    /// Move to the first block which may hold records at or after the given time.
+    void CaptureReader::Seek(std::chrono::system_clock::time_point time)
+    {
+        auto nanoseconds = ToNanoseconds(time);
+        NextBlockIndex = 0;
+        while (NextBlockIndex < BlockEntries.size() && BlockEntries[NextBlockIndex].LastTime < nanoseconds)
+        {
+            ++NextBlockIndex;
+        }
+        Block.clear();
+        BlockPosition = 0;
+    }
+
+    /// Load the next block, returns false if there is none.
+    bool CaptureReader::LoadBlock()
+    {
+        if (NextBlockIndex >= BlockEntries.size()) return false;
+        const auto& entry = BlockEntries[NextBlockIndex++];
+
+        char header[BlockHeaderSize];
+        File.seekg(static_cast<std::streamoff>(entry.Offset));
+        if (!File.read(header, BlockHeaderSize) || GetInteger<std::uint32_t>(header) != BlockMagic)
+        {
+            throw std::runtime_error("Corrupted block header in the capture file.");
+        }
+        auto flags = GetInteger<std::uint32_t>(header + 4);
+        auto raw_size = GetInteger<std::uint32_t>(header + 12);
+        auto stored_size = GetInteger<std::uint32_t>(header + 16);
+
+        std::string payload(stored_size, '\0');
+        if (!File.read(payload.data(), stored_size))
+        {
+            throw std::runtime_error("Truncated block in the capture file.");
+        }
+        if (flags & CompressedFlag)
+        {
+            Block.resize(raw_size);
+            uLongf decompressed_size = raw_size;
+            if (uncompress(reinterpret_cast<Bytef*>(Block.data()), &decompressed_size,
+                           reinterpret_cast<const Bytef*>(payload.data()), stored_size) != Z_OK ||
+                decompressed_size != raw_size)
+            {
+                throw std::runtime_error("Corrupted compressed block in the capture file.");
+            }
+        }
+        else
+        {
+            Block = std::move(payload);
+        }
+        BlockPosition = 0;
+        LastTime = entry.FirstTime;
+        return true;
+    }
+
+    /// Read the next record.
+    bool CaptureReader::Next(CaptureRecord& record)
+    {
+        while (BlockPosition >= Block.size())
+        {
+            if (!LoadBlock()) return false;
+        }
+
+        auto encoded_delta = GetVarint(Block, BlockPosition);
+        LastTime += static_cast<std::int64_t>((encoded_delta >> 1) ^ (~(encoded_delta & 1) + 1));
+        record.Time = FromNanoseconds(LastTime);
+        record.VariableIndex = static_cast<std::uint32_t>(GetVarint(Block, BlockPosition));
+        auto length = GetVarint(Block, BlockPosition);
+        if (length == 0)
+        {
+            record.Value.reset();
+            return true;
+        }
+        --length;
+        if (length > Block.size() - BlockPosition)
+        {
+            throw std::runtime_error("Corrupted record in the capture file.");
+        }
+        record.Value.emplace(Block, BlockPosition, length);
+        BlockPosition += length;
+        return true;
+    }
+}
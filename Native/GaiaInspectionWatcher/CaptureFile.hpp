@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Gaia::InspectionWatcher
+{
+    /**
+     * @brief Record of a capture file, which is a sampled value of a variable.
+     */
+    struct CaptureRecord
+    {
+        /// Time when the value was sampled.
+        std::chrono::system_clock::time_point Time;
+        /// Index of the variable in the variable names of the file.
+        std::uint32_t VariableIndex {0};
+        /// Value text, std::nullopt if the variable did not exist.
+        std::optional<std::string> Value;
+    };
+
+    /**
+     * @brief Writer of append-only capture files.
+     * @details
+     *  A capture file starts with a header holding the names of the captured variables, followed by blocks of
+     *  records. Records store the time as a varint delta from the previous record, so a record of a short value
+     *  costs a few bytes, and each block can be compressed with zlib on its own. Blocks are self-contained,
+     *  so a file truncated by a crash stays readable up to its last complete block.
+     *  An index of the block offsets and time ranges is appended when the writer is closed, used to seek by time.
+     *  Writers of changed values should append all values at the start of a block, so a seek restores all of them.
+     */
+    class CaptureWriter
+    {
+    private:
+        /// Output file.
+        std::ofstream File;
+        /// Whether blocks are compressed.
+        const bool Compression;
+        /// Raw size which triggers writing the current block.
+        const std::size_t BlockSize;
+
+        /// Encoded records of the current block.
+        std::string Block;
+        /// Count of records in the current block.
+        std::uint32_t BlockRecordsCount {0};
+        /// Time of the first record in the current block, in nanoseconds since the epoch.
+        std::int64_t BlockFirstTime {0};
+        /// Time of the last appended record, in nanoseconds since the epoch.
+        std::int64_t LastTime {0};
+
+        /// Index entry of a written block.
+        struct BlockEntry
+        {
+            std::int64_t FirstTime;
+            std::int64_t LastTime;
+            std::uint64_t Offset;
+        };
+        /// Index entries of the written blocks.
+        std::vector<BlockEntry> BlockEntries;
+        /// Count of appended records.
+        std::uint64_t RecordsCount {0};
+        /// Count of bytes written into the file.
+        std::uint64_t WrittenBytes {0};
+
+        /// Write the current block into the file.
+        void WriteBlock();
+
+    public:
+        /**
+         * @brief Create a capture file.
+         * @param path Path of the file, an existing file will be replaced.
+         * @param variable_names Full names of the captured variables, as "<unit>/<variable>".
+         * @param compression Whether to compress the blocks with zlib.
+         * @param block_size Raw size of records which triggers writing a block.
+         * @throw std::runtime_error If the file can not be created.
+         */
+        CaptureWriter(const std::string& path, const std::vector<std::string>& variable_names,
+                      bool compression = true, std::size_t block_size = 64 * 1024);
+        /// Close the file if it is still open.
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        /**
+         * @brief Append a record, it is written when its block is full or the writer is flushed.
+         * @param time Time when the value was sampled.
+         * @param variable_index Index of the variable in the variable names.
+         * @param value Value text, std::nullopt if the variable did not exist.
+         */
+        void Append(std::chrono::system_clock::time_point time, std::uint32_t variable_index,
+                    const std::optional<std::string>& value);
+
+        /// Write the current block, so the records appended so far survive a crash.
+        void Flush();
+
+        /// Write the current block and the index, then close the file.
+        void Close();
+
+        /// Check whether the current block has no record, so the next appended record starts a new block.
+        [[nodiscard]] bool IsBlockEmpty() const noexcept
+        {
+            return BlockRecordsCount == 0;
+        }
+
+        /// Get the count of appended records.
+        [[nodiscard]] std::uint64_t GetRecordsCount() const noexcept
+        {
+            return RecordsCount;
+        }
+
+        /// Get the count of bytes written into the file.
+        [[nodiscard]] std::uint64_t GetWrittenBytes() const noexcept
+        {
+            return WrittenBytes;
+        }
+    };
+
+    /**
+     * @brief Reader of capture files, which reads records in the order they were appended.
+     * @details The index is used to seek if the file was closed properly, otherwise the blocks are scanned.
+     */
+    class CaptureReader
+    {
+    private:
+        /// Input file.
+        std::ifstream File;
+        /// Full names of the captured variables.
+        std::vector<std::string> VariableNames;
+
+        /// Position and time range of a block.
+        struct BlockEntry
+        {
+            std::int64_t FirstTime;
+            std::int64_t LastTime;
+            std::uint64_t Offset;
+        };
+        /// Blocks of the file in order.
+        std::vector<BlockEntry> BlockEntries;
+        /// Index of the next block to load.
+        std::size_t NextBlockIndex {0};
+
+        /// Decoded records of the current block.
+        std::string Block;
+        /// Read position in the current block.
+        std::size_t BlockPosition {0};
+        /// Time of the last read record, in nanoseconds since the epoch.
+        std::int64_t LastTime {0};
+
+        /// Load the next block, returns false if there is none.
+        bool LoadBlock();
+
+    public:
+        /**
+         * @brief Open a capture file.
+         * @param path Path of the file.
+         * @throw std::runtime_error If the file can not be opened or it is not a capture file.
+         */
+        explicit CaptureReader(const std::string& path);
+
+        /// Get the full names of the captured variables, as "<unit>/<variable>".
+        [[nodiscard]] const std::vector<std::string>& GetVariableNames() const noexcept
+        {
+            return VariableNames;
+        }
+
+        /// Get the time of the first record, or the epoch if the file has no record.
+        [[nodiscard]] std::chrono::system_clock::time_point GetBeginTime() const noexcept;
+        /// Get the time of the last record, or the epoch if the file has no record.
+        [[nodiscard]] std::chrono::system_clock::time_point GetEndTime() const noexcept;
+
+        /**
+         * @brief Move to the first block which may hold records at or after the given time.
+         * @details Records before the given time in that block are still read, callers can skip them.
+         */
+        void Seek(std::chrono::system_clock::time_point time);
+
+        /**
+         * @brief Read the next record.
+         * @param record Record to fill.
+         * @return False if there are no more records.
+         * @throw std::runtime_error If a block is corrupted.
+         */
+        bool Next(CaptureRecord& record);
+    };
+}
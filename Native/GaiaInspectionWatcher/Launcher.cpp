@@ -1,11 +1,245 @@
 #include <iostream>
 #include <thread>
+#include <memory>
+#include <atomic>
+#include <csignal>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include <fnmatch.h>
 #include <boost/program_options.hpp>
+#include <GaiaInspectionClient/InspectionClient.hpp>
 #include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+#include "CaptureFile.hpp"
+#include "SampleWriter.hpp"
 
-int main(int arguments_count, char** arguments)
+namespace
 {
     using namespace Gaia::InspectionService;
+    using namespace Gaia::InspectionWatcher;
+
+    /// Whether the watcher is requested to stop, set by signals or by the end of a replay.
+    std::atomic_bool StopRequested {false};
+
+    /// Request the watcher to stop.
+    void RequestStop(int)
+    {
+        StopRequested.store(true);
+    }
+
+    /// Sleep until the given time or until the watcher is requested to stop.
+    void SleepUntil(std::chrono::steady_clock::time_point time)
+    {
+        // Sleeps are sliced, so long gaps of a replay do not delay the exit.
+        while (!StopRequested.load())
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= time) return;
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    time - now, std::chrono::milliseconds(100)));
+        }
+    }
+
+    /// Split a full variable name "<unit>/<variable>", using the default unit if the name has no unit.
+    std::pair<std::string, std::string> SplitVariableName(const std::string& name, const std::string& default_unit)
+    {
+        auto separator = name.find('/');
+        if (separator == std::string::npos)
+        {
+            if (default_unit.empty()) throw std::runtime_error("Variable " + name + " has no unit.");
+            return {default_unit, name};
+        }
+        return {name.substr(0, separator), name.substr(separator + 1)};
+    }
+
+    /**
+     * @brief Resolve the names of the given variables into pairs of unit names and variable names.
+     * @param reader Reader bound to all units, used to list the variables matched by glob patterns.
+     * @param names Names as "<unit>/<variable>" or names of variables in the default unit,
+     *              which can be glob patterns such as "plant/motor_*".
+     * @param default_unit Unit of the names without a unit.
+     */
+    std::vector<std::pair<std::string, std::string>> ResolveVariables(
+            InspectionReader& reader, const std::vector<std::string>& names, const std::string& default_unit)
+    {
+        std::vector<std::pair<std::string, std::string>> targets;
+        std::vector<std::string> inspected_variables;
+        bool listed = false;
+        for (const auto& name : names)
+        {
+            auto full_name = name.find('/') == std::string::npos && !default_unit.empty() ?
+                    default_unit + "/" + name : name;
+            if (full_name.find_first_of("*?[") == std::string::npos)
+            {
+                targets.push_back(SplitVariableName(full_name, default_unit));
+                continue;
+            }
+            // Variables are only listed once, and only if some names are patterns.
+            if (!listed)
+            {
+                InspectionReader::VariableCursor cursor;
+                do
+                {
+                    for (auto& inspected_variable : reader.QueryVariables(cursor))
+                    {
+                        inspected_variables.push_back(std::move(inspected_variable));
+                    }
+                }while (!cursor.IsFinished());
+                std::sort(inspected_variables.begin(), inspected_variables.end());
+                listed = true;
+            }
+            for (const auto& inspected_variable : inspected_variables)
+            {
+                if (fnmatch(full_name.c_str(), inspected_variable.c_str(), 0) != 0) continue;
+                targets.push_back(SplitVariableName(inspected_variable, default_unit));
+            }
+        }
+        return targets;
+    }
+
+    /**
+     * @brief Record the changes of the given variables into a capture file until the watcher is stopped.
+     * @details The first sample of each block records all values, the others only record changed values.
+     */
+    void Capture(const std::shared_ptr<StorageBackend>& backend, bool hash_layout, bool shared_memory,
+                 std::vector<std::pair<std::string, std::string>> targets, unsigned int frequency,
+                 const std::string& path, bool compression, double duration)
+    {
+        std::vector<std::string> names;
+        names.reserve(targets.size());
+        for (const auto& [unit_name, variable_name] : targets)
+        {
+            names.push_back(unit_name + "/" + variable_name);
+        }
+        CaptureWriter writer(path, names, compression);
+
+        // Frequencies are rounded to ticks of the hub, so the tick is shortened for high rates.
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / frequency));
+        ReaderHub hub(backend, std::min<std::chrono::steady_clock::duration>(period, std::chrono::milliseconds(10)));
+        if (hash_layout) hub.SetStorageLayout(InspectionReader::StorageLayout::Hash);
+        hub.SetSharedMemory(shared_memory);
+
+        std::vector<std::optional<std::string>> last_values(targets.size());
+        auto flush_time = std::chrono::steady_clock::now();
+        auto subscription_id = hub.SubscribeGroup(std::move(targets), frequency,
+            [&](const std::vector<std::optional<std::string>>& values){
+                auto time = std::chrono::system_clock::now();
+                try
+                {
+                    auto full_sample = writer.IsBlockEmpty();
+                    for (std::size_t index = 0; index < values.size(); ++index)
+                    {
+                        if (!full_sample && values[index] == last_values[index]) continue;
+                        writer.Append(time, static_cast<std::uint32_t>(index), values[index]);
+                        last_values[index] = values[index];
+                    }
+                    // Records are flushed at least once per second, so a crash loses little of the capture.
+                    auto now = std::chrono::steady_clock::now();
+                    if (now - flush_time >= std::chrono::seconds(1))
+                    {
+                        writer.Flush();
+                        flush_time = now;
+                    }
+                }
+                catch (const std::exception& error)
+                {
+                    std::cerr << error.what() << std::endl;
+                    StopRequested.store(true);
+                }
+            });
+
+        auto stop_time = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(duration));
+        while (!StopRequested.load() && (duration <= 0 || std::chrono::steady_clock::now() < stop_time))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        hub.Unsubscribe(subscription_id);
+        writer.Close();
+        std::cerr << "Captured " << writer.GetRecordsCount() << " records into "
+                  << writer.GetWrittenBytes() << " bytes." << std::endl;
+    }
+
+    /**
+     * @brief Replay a capture file into the backend through clients of the recorded units.
+     * @details
+     *  Records up to the start offset are applied at once, and the others are applied in a background thread
+     *  at their recorded pace divided by the speed, or as fast as possible if the speed is not positive.
+     *  Clients remove their variables when destroyed, so the given map keeps them until the watcher exits.
+     */
+    std::thread Replay(const std::shared_ptr<StorageBackend>& backend, const std::string& path,
+                       double speed, double start_offset,
+                       std::unordered_map<std::string, std::shared_ptr<InspectionClient>>& clients)
+    {
+        auto reader = std::make_shared<CaptureReader>(path);
+
+        std::vector<std::pair<std::shared_ptr<InspectionClient>, std::string>> targets;
+        for (const auto& name : reader->GetVariableNames())
+        {
+            auto [unit_name, variable_name] = SplitVariableName(name, "*");
+            auto& client = clients[unit_name];
+            if (!client) client = std::make_shared<InspectionClient>(unit_name, backend);
+            targets.emplace_back(client, std::move(variable_name));
+        }
+
+        auto apply = [targets](const CaptureRecord& record){
+            if (record.VariableIndex >= targets.size()) return;
+            const auto& [client, variable_name] = targets[record.VariableIndex];
+            if (record.Value)
+            {
+                client->UpdateValue(variable_name, *record.Value);
+            }
+            else
+            {
+                client->RemoveValue(variable_name);
+            }
+        };
+
+        auto start_time = reader->GetBeginTime() + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::duration<double>(start_offset));
+        reader->Seek(start_time);
+        CaptureRecord record;
+        bool pending = false;
+        while ((pending = reader->Next(record)) && record.Time <= start_time)
+        {
+            apply(record);
+        }
+        std::cerr << "Replaying " << path << " with " << reader->GetVariableNames().size() << " variables, "
+                  << std::chrono::duration<double>(reader->GetEndTime() - reader->GetBeginTime()).count()
+                  << " seconds long." << std::endl;
+
+        return std::thread([reader, apply, record, pending, speed, start_time]() mutable {
+            auto wall_start_time = std::chrono::steady_clock::now();
+            try
+            {
+                while (pending && !StopRequested.load())
+                {
+                    if (speed > 0)
+                    {
+                        SleepUntil(wall_start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(record.Time - start_time) / speed));
+                        if (StopRequested.load()) break;
+                    }
+                    apply(record);
+                    pending = reader->Next(record);
+                }
+                std::cerr << "Replay finished." << std::endl;
+            }
+            catch (const std::exception& error)
+            {
+                // Corrupted blocks end the replay, the records before them have been applied.
+                std::cerr << "Replay stopped: " << error.what() << std::endl;
+            }
+            StopRequested.store(true);
+        });
+    }
+}
+
+int main(int arguments_count, char** arguments)
+{
     using namespace boost::program_options;
 
     options_description options("Options");
@@ -17,10 +251,28 @@ int main(int arguments_count, char** arguments)
             ("port,p", value<unsigned int>()->default_value(6379),
              "Port of the Redis server.")
             ("unit,u", value<std::string>(),
-             "name of the unit to watch")
-            ("variable,v", value<std::string>(), "name of the variable to watch.")
-            ("frequency,f", value<unsigned int>(), "query frequency, aka. query times per second.")
-            ("list,l", "list all inspection variables.");
+             "name of the default unit of variables")
+            ("variable,v", value<std::vector<std::string>>()->multitoken(),
+             "names of the variables to watch, as \"<unit>/<variable>\" or in the default unit, "
+             "glob patterns such as \"plant/motor_*\" are allowed.")
+            ("frequency,f", value<unsigned int>(),
+             "query frequency, aka. query times per second, 0 queries as fast as possible.")
+            ("format", value<std::string>()->default_value("text"),
+             "output format of the watched values: text, csv or json.")
+            ("list,l", "list all inspection variables.")
+            ("hash", "read variables stored in the hash layout.")
+            ("cluster", "connect to a Redis Cluster through the given node, history and push are unavailable.")
+            ("shm", "read values from shared memory when the client runs on this host.")
+            ("push", "receive change notifications instead of polling, the client should enable notifications.")
+            ("capture,c", value<std::string>(),
+             "record the changes of the variables into the given file, 100 samples per second by default.")
+            ("compress", "compress the blocks of the capture file.")
+            ("duration,d", value<double>()->default_value(0),
+             "seconds to capture, captures run until interrupted if it is 0.")
+            ("replay,r", value<std::string>(), "replay the given capture file instead of connecting to Redis.")
+            ("speed", value<double>()->default_value(1.0),
+             "replay speed factor, records are replayed as fast as possible if it is 0.")
+            ("from", value<double>()->default_value(0), "seconds to skip from the beginning of the replay.");
 
     variables_map variables;
     store(parse_command_line(arguments_count, arguments, options), variables);
@@ -32,65 +284,225 @@ int main(int arguments_count, char** arguments)
         return 0;
     }
 
-    InspectionReader reader("*", variables["port"].as<unsigned int>(),
-            variables["host"].as<std::string>());
+    SampleWriter::Format format;
+    auto format_name = variables["format"].as<std::string>();
+    if (format_name == "text") format = SampleWriter::Format::Text;
+    else if (format_name == "csv") format = SampleWriter::Format::Csv;
+    else if (format_name == "json") format = SampleWriter::Format::JsonLines;
+    else
+    {
+        std::cerr << "Unknown output format " << format_name << "." << std::endl;
+        return 1;
+    }
+
+    if (variables.count("push") && (variables.count("replay") || variables.count("cluster")))
+    {
+        std::cerr << "Push mode is unavailable with --replay or --cluster." << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+
+    std::shared_ptr<StorageBackend> backend;
+    std::unordered_map<std::string, std::shared_ptr<InspectionClient>> replay_clients;
+    std::thread replay_thread;
+    if (variables.count("replay"))
+    {
+        backend = std::make_shared<MemoryBackend>();
+        try
+        {
+            replay_thread = Replay(backend, variables["replay"].as<std::string>(),
+                                   variables["speed"].as<double>(), variables["from"].as<double>(), replay_clients);
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << "Failed to replay " << variables["replay"].as<std::string>() << ": " << error.what()
+                      << std::endl;
+            return 1;
+        }
+    }
+    else if (variables.count("cluster"))
+    {
+        backend = std::make_shared<RedisClusterBackend>(std::make_shared<sw::redis::RedisCluster>(
+                "tcp://" + variables["host"].as<std::string>() + ":" +
+                std::to_string(variables["port"].as<unsigned int>())));
+    }
+    else
+    {
+        backend = std::make_shared<RedisBackend>(ConnectionHub::GetInstance().AcquireConnection(
+                variables["host"].as<std::string>(), variables["port"].as<unsigned int>()));
+    }
+    auto join_replay = [&replay_thread]{
+        StopRequested.store(true);
+        if (replay_thread.joinable()) replay_thread.join();
+    };
+
+    InspectionReader reader("*", backend);
+
+    // Replays are stored in the keys layout by their clients.
+    auto hash_layout = variables.count("hash") && !variables.count("replay");
+    if (hash_layout)
+    {
+        reader.SetStorageLayout(InspectionReader::StorageLayout::Hash);
+    }
+
+    if (variables.count("shm"))
+    {
+        reader.SetSharedMemory(true);
+    }
 
     if (variables.count("list"))
     {
         std::cout << "All inspected variables:" << std::endl;
-        auto inspected_variables = reader.QueryVariables();
-        for (const auto& inspected_variable : inspected_variables)
+        // Variables are printed page by page, so the output starts before large units are fully enumerated.
+        InspectionReader::VariableCursor cursor;
+        do
         {
-            std::cout << "\t" << inspected_variable << std::endl;
-        }
+            for (const auto& inspected_variable : reader.QueryVariables(cursor))
+            {
+                std::cout << "\t" << inspected_variable << "\n";
+            }
+        }while (!cursor.IsFinished());
+        std::cout << std::flush;
+        join_replay();
         return 0;
     }
 
     std::string unit_name;
-    if (!variables.count("unit"))
+    if (variables.count("unit"))
     {
-        std::cout << "Input unit name: ";
-        std::cin >> unit_name;
+        unit_name = variables["unit"].as<std::string>();
     }
-    else
+    std::vector<std::string> variable_names;
+    if (variables.count("variable"))
     {
-        unit_name = variables["unit"].as<std::string>();
+        variable_names = variables["variable"].as<std::vector<std::string>>();
     }
-    std::string variable_name;
-    if (!variables.count("variable"))
+    else
     {
+        if (unit_name.empty())
+        {
+            std::cout << "Input unit name: ";
+            std::cin >> unit_name;
+        }
         std::cout << "Input variable name: ";
-        std::cin >> variable_name;
+        std::cin >> variable_names.emplace_back();
     }
-    else
+
+    std::vector<std::pair<std::string, std::string>> targets;
+    try
     {
-        variable_name = variables["variable"].as<std::string>();
+        targets = ResolveVariables(reader, variable_names, unit_name);
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        join_replay();
+        return 1;
+    }
+    if (targets.empty())
+    {
+        std::cerr << "No variable matches the given names." << std::endl;
+        join_replay();
+        return 1;
     }
 
-    unsigned int frequency = 1;
-    if (variables.count("frequency"))
+    if (variables.count("capture"))
     {
-        frequency = variables["frequency"].as<unsigned int>();
+        auto frequency = variables.count("frequency") ? variables["frequency"].as<unsigned int>() : 100u;
+        if (frequency == 0) frequency = 1;
+
+        Capture(backend, hash_layout, variables.count("shm") > 0,
+                std::move(targets), frequency, variables["capture"].as<std::string>(),
+                variables.count("compress") > 0, variables["duration"].as<double>());
+        join_replay();
+        return 0;
+    }
+
+    std::vector<std::string> full_names;
+    full_names.reserve(targets.size());
+    for (const auto& [target_unit, target_variable] : targets)
+    {
+        full_names.push_back(target_unit + "/" + target_variable);
     }
+    SampleWriter writer(stdout, format, full_names);
 
-    reader.BindUnit(unit_name);
+    // All variables are fetched in one round trip per tick, whichever units they belong to.
+    ReaderHub hub(backend);
+    if (hash_layout) hub.SetStorageLayout(InspectionReader::StorageLayout::Hash);
+    hub.SetSharedMemory(variables.count("shm") > 0);
 
     unsigned long long index = 0;
 
-    while (true)
+    if (variables.count("push"))
     {
-        auto result = reader.QueryText(variable_name);
-        std::cout << "#" << index << "\t";
-        ++index;
-        if (result)
+        std::mutex writer_mutex;
+        auto latest_values = hub.QueryTexts(targets);
+        writer.Write(index++, std::chrono::system_clock::now(), latest_values);
+
+        // Notifications are subscribed per unit, and each one writes a row with the latest values of all variables.
+        std::unordered_map<std::string, std::unique_ptr<InspectionReader>> unit_readers;
+        for (std::size_t target_index = 0; target_index < targets.size(); ++target_index)
+        {
+            const auto& [target_unit, target_variable] = targets[target_index];
+            auto& unit_reader = unit_readers[target_unit];
+            if (!unit_reader) unit_reader = std::make_unique<InspectionReader>(target_unit, backend);
+            unit_reader->Subscribe(target_variable,
+                [&, target_index](const std::string&, const std::optional<std::string>& value){
+                    std::unique_lock lock(writer_mutex);
+                    latest_values[target_index] = value;
+                    writer.Write(index++, std::chrono::system_clock::now(), latest_values);
+                });
+        }
+        while (!StopRequested.load())
         {
-            std::cout << *result;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::unique_lock lock(writer_mutex);
+            writer.Flush();
         }
-        else
+        // Subscriptions are stopped before the writer and the values they use.
+        unit_readers.clear();
+        writer.Flush();
+        join_replay();
+        return 0;
+    }
+
+    unsigned int frequency = 1;
+    if (variables.count("frequency"))
+    {
+        frequency = variables["frequency"].as<unsigned int>();
+    }
+    auto period = frequency > 0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / frequency)) : std::chrono::steady_clock::duration::zero();
+
+    // Deadlines are absolute, so the latency of queries delays a sample but does not accumulate into drift.
+    auto start_time = std::chrono::steady_clock::now();
+    long long tick = 0;
+    long long skipped_ticks = 0;
+    // The first sample is always written, even if a fast replay has already finished.
+    do
+    {
+        auto sample_time = std::chrono::system_clock::now();
+        writer.Write(index++, sample_time, hub.QueryTexts(targets));
+        if (period == std::chrono::steady_clock::duration::zero()) continue;
+
+        ++tick;
+        auto now = std::chrono::steady_clock::now();
+        // Ticks missed by a whole period are skipped, because a burst of stale samples is useless.
+        if (now - (start_time + period * tick) >= period)
         {
-            std::cout << "(empty)";
+            auto current_tick = static_cast<long long>((now - start_time) / period);
+            skipped_ticks += current_tick - tick;
+            tick = current_tick;
         }
-        std::cout << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / frequency));
+        SleepUntil(start_time + period * tick);
+    }while (!StopRequested.load());
+    writer.Flush();
+    if (skipped_ticks > 0)
+    {
+        std::cerr << "Skipped " << skipped_ticks << " ticks which were missed by slow queries." << std::endl;
     }
-}
\ No newline at end of file
+    join_replay();
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "SampleWriter.hpp"
+
+namespace Gaia::InspectionWatcher
+{
+    /// Write the header of the given format.
+    SampleWriter::SampleWriter(std::FILE* stream, Format format, std::vector<std::string> variable_names,
+                               std::size_t capacity, std::chrono::steady_clock::duration flush_interval) :
+        Stream(stream), RowFormat(format), VariableNames(std::move(variable_names)), Capacity(capacity),
+        FlushInterval(flush_interval), FlushTime(std::chrono::steady_clock::now())
+    {
+        Buffer.reserve(Capacity + 1024);
+        if (RowFormat != Format::Csv) return;
+        Buffer.append("time");
+        for (const auto& name : VariableNames)
+        {
+            Buffer.push_back(',');
+            AppendCsvField(name);
+        }
+        Buffer.push_back('\n');
+        Flush();
+    }
+
+    /// Flush the buffered rows.
+    SampleWriter::~SampleWriter()
+    {
+        Flush();
+    }
+
+    /// Append the text quoted for a CSV field if necessary.
+    void SampleWriter::AppendCsvField(const std::string& text)
+    {
+        if (text.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            Buffer.append(text);
+            return;
+        }
+        Buffer.push_back('"');
+        for (auto character : text)
+        {
+            if (character == '"') Buffer.push_back('"');
+            Buffer.push_back(character);
+        }
+        Buffer.push_back('"');
+    }
+
+    /// Append the text as a JSON string.
+    void SampleWriter::AppendJsonString(const std::string& text)
+    {
+        Buffer.push_back('"');
+        for (auto character : text)
+        {
+            switch (character)
+            {
+                case '"': Buffer.append("\\\""); break;
+                case '\\': Buffer.append("\\\\"); break;
+                case '\n': Buffer.append("\\n"); break;
+                case '\r': Buffer.append("\\r"); break;
+                case '\t': Buffer.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(character) < 0x20)
+                    {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(character));
+                        Buffer.append(escaped);
+                    }
+                    else
+                    {
+                        Buffer.push_back(character);
+                    }
+            }
+        }
+        Buffer.push_back('"');
+    }
+
+    /// Write a row of sampled values.
+    void SampleWriter::Write(unsigned long long index, std::chrono::system_clock::time_point time,
+                             const std::vector<std::optional<std::string>>& values)
+    {
+        char number[32];
+        switch (RowFormat)
+        {
+            case Format::Text:
+                std::snprintf(number, sizeof(number), "#%llu", index);
+                Buffer.append(number);
+                for (const auto& value : values)
+                {
+                    Buffer.push_back('\t');
+                    Buffer.append(value ? *value : "(empty)");
+                }
+                break;
+            case Format::Csv:
+            case Format::JsonLines:
+            {
+                auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                        time.time_since_epoch()).count();
+                std::snprintf(number, sizeof(number), "%lld.%06lld", static_cast<long long>(microseconds / 1000000),
+                              static_cast<long long>(microseconds % 1000000));
+                if (RowFormat == Format::Csv)
+                {
+                    Buffer.append(number);
+                    // Missing values are empty fields.
+                    for (const auto& value : values)
+                    {
+                        Buffer.push_back(',');
+                        if (value) AppendCsvField(*value);
+                    }
+                    break;
+                }
+                Buffer.append("{\"time\":");
+                Buffer.append(number);
+                std::snprintf(number, sizeof(number), "%llu", index);
+                Buffer.append(",\"index\":");
+                Buffer.append(number);
+                Buffer.append(",\"values\":{");
+                for (std::size_t value_index = 0; value_index < values.size(); ++value_index)
+                {
+                    if (value_index > 0) Buffer.push_back(',');
+                    AppendJsonString(value_index < VariableNames.size() ? VariableNames[value_index] : "");
+                    Buffer.push_back(':');
+                    if (values[value_index])
+                    {
+                        AppendJsonString(*values[value_index]);
+                    }
+                    else
+                    {
+                        Buffer.append("null");
+                    }
+                }
+                Buffer.append("}}");
+                break;
+            }
+        }
+        Buffer.push_back('\n');
+
+        if (Buffer.size() >= Capacity || std::chrono::steady_clock::now() - FlushTime >= FlushInterval)
+        {
+            Flush();
+        }
+    }
+
+    /// Write the buffered rows into the stream.
+    void SampleWriter::Flush()
+    {
+        FlushTime = std::chrono::steady_clock::now();
+        if (Buffer.empty()) return;
+        std::fwrite(Buffer.data(), 1, Buffer.size(), Stream);
+        std::fflush(Stream);
+        Buffer.clear();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Gaia::InspectionWatcher
+{
+    /**
+     * @brief Writer of sampled rows, which buffers the output and flushes it in large writes.
+     * @details
+     *  Rows are flushed when the buffer is full or when the flush interval elapsed since the last flush,
+     *  so sampling at kHz into a pipe costs a few writes per second, while slow samples still show up promptly.
+     */
+    class SampleWriter
+    {
+    public:
+        /// Format of the written rows.
+        enum class Format
+        {
+            /// "#<index>\t<value>\t..." rows for humans.
+            Text,
+            /// Comma separated values with a header row, the first column is the time in seconds since the epoch.
+            Csv,
+            /// One JSON object per line, with the time, the index and the values of the variables.
+            JsonLines
+        };
+
+    private:
+        /// Stream to write into.
+        std::FILE* const Stream;
+        /// Format of the written rows.
+        const Format RowFormat;
+        /// Full names of the sampled variables, as "<unit>/<variable>".
+        const std::vector<std::string> VariableNames;
+        /// Buffered text.
+        std::string Buffer;
+        /// Size of the buffer which triggers a flush.
+        const std::size_t Capacity;
+        /// Longest time to keep a row in the buffer.
+        const std::chrono::steady_clock::duration FlushInterval;
+        /// Time of the last flush.
+        std::chrono::steady_clock::time_point FlushTime;
+
+        /// Append the text quoted for a CSV field if necessary.
+        void AppendCsvField(const std::string& text);
+        /// Append the text as a JSON string.
+        void AppendJsonString(const std::string& text);
+
+    public:
+        /**
+         * @brief Write the header of the given format.
+         * @param stream Stream to write into, such as stdout.
+         * @param format Format of the rows.
+         * @param variable_names Full names of the sampled variables, as "<unit>/<variable>".
+         * @param capacity Size of the buffer which triggers a flush.
+         * @param flush_interval Longest time to keep a row in the buffer.
+         */
+        SampleWriter(std::FILE* stream, Format format, std::vector<std::string> variable_names,
+                     std::size_t capacity = 64 * 1024,
+                     std::chrono::steady_clock::duration flush_interval = std::chrono::milliseconds(100));
+        /// Flush the buffered rows.
+        ~SampleWriter();
+
+        SampleWriter(const SampleWriter&) = delete;
+        SampleWriter& operator=(const SampleWriter&) = delete;
+
+        /**
+         * @brief Write a row of sampled values.
+         * @param index Index of the sample.
+         * @param time Time when the values were sampled.
+         * @param values Values in the order of the variable names, std::nullopt for missing variables.
+         */
+        void Write(unsigned long long index, std::chrono::system_clock::time_point time,
+                   const std::vector<std::optional<std::string>>& values);
+
+        /// Write the buffered rows into the stream.
+        void Flush();
+    };
+}
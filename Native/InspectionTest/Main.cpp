@@ -1,15 +1,31 @@
 #include <GaiaInspectionClient/GaiaInspectionClient.hpp>
 
 #include <thread>
+#include <string>
 
-int main()
+int main(int arguments_count, char** arguments)
 {
     using namespace Gaia;
 
     int increased_value = 0;
     int decreased_value = 0;
 
-    InspectionService::InspectionClient client("inspect_test");
+    // "--memory" runs the test on the in-process backend, without a Redis server.
+    std::shared_ptr<InspectionService::StorageBackend> backend;
+    if (arguments_count > 1 && std::string(arguments[1]) == "--memory")
+    {
+        backend = std::make_shared<InspectionService::MemoryBackend>();
+    }
+    else
+    {
+        backend = std::make_shared<InspectionService::RedisBackend>(
+                std::make_shared<sw::redis::Redis>("tcp://127.0.0.1:6379"));
+    }
+
+    InspectionService::InspectionClient client("inspect_test", backend);
+    client.SetNotification(true);
+    client.EnableHistory(TEXT(increased_value));
+    client.SetCounterPublishing();
 
     client.AddProbe(TEXT(increased_value),
                     [&increased_value]{return std::to_string(increased_value);});
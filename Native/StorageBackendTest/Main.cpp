@@ -0,0 +1,184 @@
+#include <GaiaInspectionClient/GaiaInspectionClient.hpp>
+#include <GaiaInspectionReader/GaiaInspectionReader.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace Gaia::InspectionService;
+
+    /// Count of failed checks.
+    int FailuresCount = 0;
+
+    /// Report a failed check, the test continues so all failures are listed.
+    void Check(bool condition, const char* description)
+    {
+        if (condition) return;
+        ++FailuresCount;
+        std::cerr << "Failed: " << description << std::endl;
+    }
+
+    /// Batches apply the operations of each type through the storage backend interface.
+    void TestBatchOperations(StorageBackend& backend)
+    {
+        auto batch = backend.CreateBatch();
+        batch->Set("string", "1");
+        batch->HashSet("hash", "field", "2");
+        batch->AddMember("set", "member");
+        batch->AddScoredMember("sorted", "late", 20);
+        batch->AddScoredMember("sorted", "early", 10);
+        Check(!backend.Get("string"), "operations are only applied when the batch is executed");
+        batch->Execute();
+
+        Check(backend.Get("string") == "1", "Set writes a string key");
+        Check(backend.MultiGet({"string", "missing"}) == std::vector<std::optional<std::string>>{"1", std::nullopt},
+              "MultiGet keeps the order of the keys");
+        Check(backend.HashGet("hash", "field") == "2", "HashSet writes a hash field");
+        Check(backend.Members("set").count("member") == 1, "AddMember adds a set member");
+        auto scored_members = backend.ScoredMembersAbove("sorted", 10);
+        Check(scored_members.size() == 1 && scored_members[0].first == "late",
+              "ScoredMembersAbove excludes the members at the given score");
+
+        batch->HashDelete("hash", "field");
+        batch->RemoveMember("set", "member");
+        batch->Delete("string");
+        batch->Execute();
+        Check(backend.HashGetAll("hash").empty(), "HashDelete removes the hash field");
+        Check(backend.Members("set").empty(), "RemoveMember removes the set member");
+        Check(!backend.Get("string"), "Delete removes the key");
+
+        batch->StampChanges("generation", "change_log", {"first"});
+        batch->StampChanges("generation", "change_log", {"second", "third"});
+        batch->Execute();
+        Check(backend.Get("generation") == "2", "StampChanges increments the generation");
+        auto changes = backend.ScoredMembersAbove("change_log", 1);
+        Check(changes.size() == 2 && changes[0].second == 2, "StampChanges stamps the members with the generation");
+    }
+
+    /// Published messages are delivered to the subscribed handlers after the batch is executed.
+    void TestMessages(MemoryBackend& backend)
+    {
+        std::vector<std::string> messages;
+        auto subscription = backend.Subscribe("channel", [&messages](const std::string&, const std::string& message){
+            messages.push_back(message);
+        });
+        auto batch = backend.CreateBatch();
+        batch->Publish("channel", "first");
+        batch->Publish("other", "ignored");
+        Check(messages.empty(), "messages are only delivered when the batch is executed");
+        batch->Execute();
+        Check(messages == std::vector<std::string>{"first"}, "messages are delivered to the channel handlers");
+
+        backend.Unsubscribe(subscription);
+        batch->Publish("channel", "second");
+        batch->Execute();
+        Check(messages.size() == 1, "unsubscribed handlers receive no message");
+    }
+
+    /// Streams keep the appended entries in order, capped by their max length and their min ID.
+    void TestStreams(MemoryBackend& backend)
+    {
+        auto batch = backend.CreateBatch();
+        for (int index = 0; index < 5; ++index)
+        {
+            batch->AppendStream("stream", "*", std::to_string(index), "0", 3, {});
+        }
+        batch->Execute();
+        auto entries = backend.StreamRange("stream", "-", "+");
+        Check(entries.size() == 3, "streams are capped by their max length");
+        Check(!entries.empty() && entries.front().Value == "2" && entries.back().Value == "4",
+              "the oldest entries are removed first");
+        for (std::size_t index = 1; index < entries.size(); ++index)
+        {
+            Check(entries[index - 1].ID != entries[index].ID, "stream IDs are unique");
+        }
+
+        batch->AppendStream("timed", "1000-*", "first", "0", 0, {});
+        batch->AppendStream("timed", "1000-*", "second", "0", 0, {});
+        batch->AppendStream("timed", "999-*", "late", "0", 0, {});
+        Check(batch->Execute() == 1, "entries older than the last one are counted as rejected");
+        entries = backend.StreamRange("timed", "1000", "1000");
+        Check(entries.size() == 2 && entries[0].ID == "1000-0" && entries[1].ID == "1000-1",
+              "entries with the same time get increasing sequences");
+        Check(backend.StreamRange("timed", "-", "+").size() == 2, "entries older than the last one are rejected");
+
+        batch->AppendStream("timed", "2000-*", "third", "0", 0, "1500");
+        batch->Execute();
+        entries = backend.StreamRange("timed", "-", "+");
+        Check(entries.size() == 1 && entries[0].Value == "third", "entries before the min ID are trimmed");
+    }
+
+    /// A client and a reader share the variables through the backend, in both storage layouts.
+    void TestClientAndReader(const std::shared_ptr<MemoryBackend>& backend)
+    {
+        for (auto layout : {InspectionClient::StorageLayout::Keys, InspectionClient::StorageLayout::Hash})
+        {
+            InspectionClient client("backend_test", backend);
+            client.SetStorageLayout(layout);
+            InspectionReader reader("backend_test", backend);
+            reader.SetStorageLayout(layout == InspectionClient::StorageLayout::Hash ?
+                                    InspectionReader::StorageLayout::Hash : InspectionReader::StorageLayout::Keys);
+
+            int probe_value = 7;
+            client.AddProbe("probe", [&probe_value]{ return std::to_string(probe_value); });
+            client.UpdateValue("value", std::string("text"));
+            client.Update();
+            Check(reader.QueryText("probe") == "7", "probe values are readable");
+            Check(reader.QueryText("value") == "text", "updated values are readable");
+            Check(reader.QueryVariables() == std::unordered_set<std::string>{"probe", "value"},
+                  "variables are indexed");
+
+            client.RemoveValue("value");
+            Check(!reader.QueryText("value"), "removed values are deleted");
+            Check(reader.QueryVariables() == std::unordered_set<std::string>{"probe"},
+                  "removed values are unindexed");
+        }
+        Check(!backend->Get("inspections/backend_test/probe"), "destroyed clients delete their variables");
+    }
+
+    /// Notifications and history of a client go through the backend.
+    void TestClientMessagesAndHistory(const std::shared_ptr<MemoryBackend>& backend)
+    {
+        InspectionClient client("backend_test", backend);
+        client.SetNotification(true);
+        client.EnableHistory("value", InspectionClient::HistoryRetention{2, std::chrono::milliseconds(0)});
+
+        std::vector<std::string> messages;
+        auto subscription = backend->Subscribe("inspection_changes/backend_test",
+                                               [&messages](const std::string&, const std::string& message){
+            messages.push_back(message);
+        });
+        for (int index = 0; index < 3; ++index)
+        {
+            client.UpdateValue("value", std::to_string(index));
+        }
+        client.UpdateValue("line\nbreak", std::string("text"));
+        backend->Unsubscribe(subscription);
+
+        Check(messages.size() == 4, "each update publishes a notification");
+        Check(messages.size() == 4 && messages[2] == "value\n2", "notifications carry the variable name");
+        Check(messages.size() == 4 && messages[3] == "line\\nbreak\ntext", "line feeds in names are escaped");
+        auto entries = backend->StreamRange("inspection_history/backend_test/value", "-", "+");
+        Check(entries.size() == 2 && entries.back().Value == "2", "history keeps the latest values");
+    }
+}
+
+int main()
+{
+    auto backend = std::make_shared<MemoryBackend>();
+    TestBatchOperations(*backend);
+    TestMessages(*backend);
+    TestStreams(*backend);
+    TestClientAndReader(backend);
+    TestClientMessagesAndHistory(backend);
+
+    if (FailuresCount > 0)
+    {
+        std::cerr << FailuresCount << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}